@@ -30,6 +30,8 @@
 
 #include "static_raycaster.h"
 
+#include "core/object/class_db.h"
+
 StaticRaycaster *(*StaticRaycaster::create_function)() = nullptr;
 
 Ref<StaticRaycaster> StaticRaycaster::create() {
@@ -38,3 +40,60 @@ Ref<StaticRaycaster> StaticRaycaster::create() {
 	}
 	return Ref<StaticRaycaster>();
 }
+
+Dictionary StaticRaycaster::intersect_rays(const PackedVector3Array &p_origins, const PackedVector3Array &p_directions, float p_max_distance) {
+	ERR_FAIL_COND_V_MSG(p_origins.size() != p_directions.size(), Dictionary(), "The number of ray origins and directions must be the same.");
+
+	int ray_count = p_origins.size();
+	Vector<Ray> rays;
+	rays.resize(ray_count);
+	{
+		const Vector3 *origins = p_origins.ptr();
+		const Vector3 *directions = p_directions.ptr();
+		Ray *rays_w = rays.ptrw();
+		for (int i = 0; i < ray_count; i++) {
+			rays_w[i] = Ray(origins[i], directions[i], 0.0f, p_max_distance);
+			rays_w[i].id = i;
+		}
+	}
+
+	intersect(rays);
+
+	PackedFloat32Array distances;
+	PackedInt32Array primitive_ids;
+	PackedInt32Array geometry_ids;
+	distances.resize(ray_count);
+	primitive_ids.resize(ray_count);
+	geometry_ids.resize(ray_count);
+	{
+		const Ray *rays_r = rays.ptr();
+		float *distances_w = distances.ptrw();
+		int32_t *primitive_ids_w = primitive_ids.ptrw();
+		int32_t *geometry_ids_w = geometry_ids.ptrw();
+		for (int i = 0; i < ray_count; i++) {
+			const Ray &ray = rays_r[i];
+			if (ray) {
+				distances_w[i] = ray.tfar;
+				primitive_ids_w[i] = ray.primID;
+				geometry_ids_w[i] = ray.geomID;
+			} else {
+				distances_w[i] = -1.0f;
+				primitive_ids_w[i] = -1;
+				geometry_ids_w[i] = -1;
+			}
+		}
+	}
+
+	Dictionary result;
+	result["distances"] = distances;
+	result["primitive_ids"] = primitive_ids;
+	result["geometry_ids"] = geometry_ids;
+	return result;
+}
+
+void StaticRaycaster::_bind_methods() {
+	ClassDB::bind_static_method("StaticRaycaster", D_METHOD("create"), &StaticRaycaster::create);
+	ClassDB::bind_method(D_METHOD("add_mesh", "vertices", "indices", "id"), &StaticRaycaster::add_mesh);
+	ClassDB::bind_method(D_METHOD("commit"), &StaticRaycaster::commit);
+	ClassDB::bind_method(D_METHOD("intersect_rays", "origins", "directions", "max_distance"), &StaticRaycaster::intersect_rays, DEFVAL(1e20));
+}
@@ -48,6 +48,8 @@ class StaticRaycaster : public RefCounted {
 protected:
 	static StaticRaycaster *(*create_function)();
 
+	static void _bind_methods();
+
 public:
 	// Compatible with embree4 rays.
 	struct __aligned(16) Ray {
@@ -105,6 +107,8 @@ public:
 	virtual void set_mesh_filter(const HashSet<int> &p_mesh_ids) = 0;
 	virtual void clear_mesh_filter() = 0;
 
+	Dictionary intersect_rays(const PackedVector3Array &p_origins, const PackedVector3Array &p_directions, float p_max_distance = 1e20);
+
 	static Ref<StaticRaycaster> create();
 };
 
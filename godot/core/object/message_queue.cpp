@@ -58,6 +58,223 @@
 		mutex.unlock();                           \
 	}
 
+thread_local CallQueue::ThreadBufferHolder CallQueue::thread_buffer_holder;
+SafeNumeric<uint64_t> CallQueue::last_queue_serial;
+
+CallQueue::ThreadBufferHolder::~ThreadBufferHolder() {
+	// If the queue is still alive, it frees the buffer after merging it at its next flush.
+	if (buffer && buffer->refcount.unref()) {
+		memdelete(buffer);
+	}
+}
+
+CallQueue::ThreadBuffer *CallQueue::_get_thread_buffer() {
+	ThreadBuffer *buffer = thread_buffer_holder.buffer;
+	if (likely(buffer && buffer->queue_serial == queue_serial)) {
+		return buffer;
+	}
+
+	if (buffer && buffer->refcount.unref()) {
+		// Left over from a queue that no longer exists.
+		memdelete(buffer);
+	}
+
+	buffer = memnew(ThreadBuffer);
+	buffer->refcount.init(2);
+	buffer->queue_serial = queue_serial;
+	thread_buffer_holder.buffer = buffer;
+
+	LOCK_MUTEX;
+	thread_buffers.push_back(buffer);
+	UNLOCK_MUTEX;
+
+	return buffer;
+}
+
+// Both the queue mutex and the buffer lock must be held.
+bool CallQueue::_merge_thread_buffer(ThreadBuffer *p_buffer) {
+	bool merged = false;
+	for (uint32_t i = 0; i < p_buffer->pages_used; i++) {
+		if (p_buffer->page_bytes[i] == 0) {
+			continue;
+		}
+
+		// Reuse the last page only if it's empty, so messages already in it stay first.
+		uint32_t slot = (pages_used > 0 && page_bytes[pages_used - 1] == 0) ? pages_used - 1 : pages_used;
+		if (slot == max_pages) {
+			// Each buffer only keeps itself under the limit, so the merged total can still go over it.
+			// The rest of the buffer is taken out, to be dropped once the buffer lock is released.
+			for (uint32_t j = i; j < p_buffer->pages_used; j++) {
+				dropped_pages.push_back(p_buffer->pages[j]);
+				dropped_page_bytes.push_back(p_buffer->page_bytes[j]);
+			}
+			for (uint32_t j = p_buffer->pages_used; j < p_buffer->pages.size(); j++) {
+				allocator->free(p_buffer->pages[j]);
+			}
+			p_buffer->pages.resize(i);
+			p_buffer->page_bytes.resize(i);
+			break;
+		}
+		if (slot == pages.size()) {
+			pages.push_back(allocator->alloc());
+			page_bytes.push_back(0);
+		}
+
+		// Trade the filled page for an empty one, instead of copying the messages over.
+		SWAP(pages[slot], p_buffer->pages[i]);
+		page_bytes[slot] = p_buffer->page_bytes[i];
+		p_buffer->page_bytes[i] = 0;
+		pages_used = slot + 1;
+		merged = true;
+	}
+	p_buffer->pages_used = p_buffer->pages.is_empty() ? 0 : 1;
+	return merged;
+}
+
+// The queue mutex must be held, but not the lock of any thread buffer.
+void CallQueue::_drop_overflow_pages() {
+	if (dropped_pages.is_empty()) {
+		return;
+	}
+
+	fprintf(stderr, "Failed to merge thread calls. Message queue out of memory. %s\n", error_text.utf8().get_data());
+	statistics();
+
+	for (uint32_t i = 0; i < dropped_pages.size(); i++) {
+		uint32_t offset = 0;
+		while (offset < dropped_page_bytes[i]) {
+			Message *message = (Message *)&dropped_pages[i]->data[offset];
+			offset += _get_message_size(message);
+			_destroy_message(message);
+		}
+		allocator->free(dropped_pages[i]);
+	}
+	dropped_pages.clear();
+	dropped_page_bytes.clear();
+}
+
+// The queue mutex must be held.
+bool CallQueue::_merge_thread_buffers() {
+	bool merged = false;
+	for (uint32_t i = 0; i < thread_buffers.size(); i++) {
+		ThreadBuffer *buffer = thread_buffers[i];
+		// Checked before merging, so an exiting thread can't push anything after that.
+		bool thread_exited = buffer->refcount.get() == 1;
+
+		buffer->lock.lock();
+		merged |= _merge_thread_buffer(buffer);
+		buffer->lock.unlock();
+
+		if (thread_exited) {
+			// This is the last reference.
+			for (Page *page : buffer->pages) {
+				allocator->free(page);
+			}
+			thread_buffers.remove_at_unordered(i);
+			i--;
+			if (buffer->refcount.unref()) {
+				memdelete(buffer);
+			}
+		}
+	}
+	_drop_overflow_pages();
+	return merged;
+}
+
+// The queue mutex must be held.
+void CallQueue::_merge_current_thread_buffer() {
+	ThreadBuffer *buffer = thread_buffer_holder.buffer;
+	if (!use_thread_buffers || !buffer || buffer->queue_serial != queue_serial) {
+		return;
+	}
+	buffer->lock.lock();
+	_merge_thread_buffer(buffer);
+	buffer->lock.unlock();
+	_drop_overflow_pages();
+}
+
+uint8_t *CallQueue::_reserve_typed_call(uint32_t p_room_needed, ThreadBuffer *&r_buffer) {
+	if (use_thread_buffers) {
+		ThreadBuffer *buffer = _get_thread_buffer();
+		buffer->lock.lock();
+
+		if (buffer->pages_used == 0 || (buffer->page_bytes[buffer->pages_used - 1] + p_room_needed) > uint32_t(PAGE_SIZE_BYTES)) {
+			if (buffer->pages_used == max_pages) {
+				buffer->lock.unlock();
+				fprintf(stderr, "Failed typed call. Message queue out of memory. %s\n", error_text.utf8().get_data());
+				return nullptr;
+			}
+			if (buffer->pages_used == buffer->pages.size()) {
+				buffer->pages.push_back(allocator->alloc());
+				buffer->page_bytes.push_back(0);
+			}
+			buffer->page_bytes[buffer->pages_used] = 0;
+			buffer->pages_used++;
+		}
+
+		r_buffer = buffer;
+		return &buffer->pages[buffer->pages_used - 1]->data[buffer->page_bytes[buffer->pages_used - 1]];
+	}
+
+	r_buffer = nullptr;
+
+	LOCK_MUTEX;
+
+	_ensure_first_page();
+
+	if ((page_bytes[pages_used - 1] + p_room_needed) > uint32_t(PAGE_SIZE_BYTES)) {
+		if (pages_used == max_pages) {
+			fprintf(stderr, "Failed typed call. Message queue out of memory. %s\n", error_text.utf8().get_data());
+			statistics();
+			UNLOCK_MUTEX;
+			return nullptr;
+		}
+		_add_page();
+	}
+
+	return &pages[pages_used - 1]->data[page_bytes[pages_used - 1]];
+}
+
+void CallQueue::_commit_typed_call(uint32_t p_room_needed, ThreadBuffer *p_buffer) {
+	if (p_buffer) {
+		p_buffer->page_bytes[p_buffer->pages_used - 1] += p_room_needed;
+		p_buffer->lock.unlock();
+	} else {
+		page_bytes[pages_used - 1] += p_room_needed;
+		UNLOCK_MUTEX;
+	}
+}
+
+uint32_t CallQueue::_get_message_size(const Message *p_message) {
+	switch (p_message->type & FLAG_MASK) {
+		case TYPE_NOTIFICATION:
+			return sizeof(Message);
+		case TYPE_TYPED_CALL:
+			return sizeof(Message) + p_message->args;
+		default:
+			return sizeof(Message) + sizeof(Variant) * p_message->args;
+	}
+}
+
+void CallQueue::_destroy_message(Message *p_message) {
+	switch (p_message->type & FLAG_MASK) {
+		case TYPE_NOTIFICATION: {
+		} break;
+		case TYPE_TYPED_CALL: {
+			TypedCallBase *typed_call = (TypedCallBase *)(p_message + 1);
+			typed_call->~TypedCallBase();
+		} break;
+		default: {
+			Variant *args = (Variant *)(p_message + 1);
+			for (int k = 0; k < p_message->args; k++) {
+				args[k].~Variant();
+			}
+		} break;
+	}
+
+	p_message->~Message();
+}
+
 void CallQueue::_add_page() {
 	if (pages_used == page_bytes.size()) {
 		pages.push_back(allocator->alloc());
@@ -90,6 +307,7 @@ Error CallQueue::push_callablep(const Callable &p_callable, const Variant **p_ar
 
 	LOCK_MUTEX;
 
+	_merge_current_thread_buffer();
 	_ensure_first_page();
 
 	if ((page_bytes[pages_used - 1] + room_needed) > uint32_t(PAGE_SIZE_BYTES)) {
@@ -137,6 +355,7 @@ Error CallQueue::push_set(ObjectID p_id, const StringName &p_prop, const Variant
 	LOCK_MUTEX;
 	uint32_t room_needed = sizeof(Message) + sizeof(Variant);
 
+	_merge_current_thread_buffer();
 	_ensure_first_page();
 
 	if ((page_bytes[pages_used - 1] + room_needed) > uint32_t(PAGE_SIZE_BYTES)) {
@@ -178,6 +397,7 @@ Error CallQueue::push_notification(ObjectID p_id, int p_notification) {
 	LOCK_MUTEX;
 	uint32_t room_needed = sizeof(Message);
 
+	_merge_current_thread_buffer();
 	_ensure_first_page();
 
 	if ((page_bytes[pages_used - 1] + room_needed) > uint32_t(PAGE_SIZE_BYTES)) {
@@ -226,6 +446,10 @@ void CallQueue::_call_function(const Callable &p_callable, const Variant *p_args
 Error CallQueue::flush() {
 	LOCK_MUTEX;
 
+	if (use_thread_buffers && !flushing) {
+		_merge_thread_buffers();
+	}
+
 	if (pages.size() == 0) {
 		// Never allocated
 		UNLOCK_MUTEX;
@@ -242,58 +466,62 @@ Error CallQueue::flush() {
 	uint32_t i = 0;
 	uint32_t offset = 0;
 
-	while (i < pages_used && offset < page_bytes[i]) {
-		Page *page = pages[i];
+	while (true) {
+		while (i < pages_used && offset < page_bytes[i]) {
+			Page *page = pages[i];
 
-		//lock on each iteration, so a call can re-add itself to the message queue
+			//lock on each iteration, so a call can re-add itself to the message queue
 
-		Message *message = (Message *)&page->data[offset];
+			Message *message = (Message *)&page->data[offset];
 
-		uint32_t advance = sizeof(Message);
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			advance += sizeof(Variant) * message->args;
-		}
+			uint32_t advance = _get_message_size(message);
 
-		//pre-advance so this function is reentrant
-		offset += advance;
+			//pre-advance so this function is reentrant
+			offset += advance;
 
-		Object *target = message->callable.get_object();
+			Object *target = message->callable.get_object();
 
-		UNLOCK_MUTEX;
+			UNLOCK_MUTEX;
 
-		switch (message->type & FLAG_MASK) {
-			case TYPE_CALL: {
-				if (target || (message->type & FLAG_NULL_IS_OK)) {
-					Variant *args = (Variant *)(message + 1);
-					_call_function(message->callable, args, message->args, message->type & FLAG_SHOW_ERROR);
-				}
-			} break;
-			case TYPE_NOTIFICATION: {
-				if (target) {
-					target->notification(message->notification);
-				}
-			} break;
-			case TYPE_SET: {
-				if (target) {
-					Variant *arg = (Variant *)(message + 1);
-					target->set(message->callable.get_method(), *arg);
-				}
-			} break;
-		}
+			switch (message->type & FLAG_MASK) {
+				case TYPE_CALL: {
+					if (target || (message->type & FLAG_NULL_IS_OK)) {
+						Variant *args = (Variant *)(message + 1);
+						_call_function(message->callable, args, message->args, message->type & FLAG_SHOW_ERROR);
+					}
+				} break;
+				case TYPE_NOTIFICATION: {
+					if (target) {
+						target->notification(message->notification);
+					}
+				} break;
+				case TYPE_SET: {
+					if (target) {
+						Variant *arg = (Variant *)(message + 1);
+						target->set(message->callable.get_method(), *arg);
+					}
+				} break;
+				case TYPE_TYPED_CALL: {
+					TypedCallBase *typed_call = (TypedCallBase *)(message + 1);
+					Object *typed_target = ObjectDB::get_instance(typed_call->object_id);
+					if (typed_target) {
+						typed_call->call(typed_target);
+					}
+				} break;
+			}
 
-		if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-			Variant *args = (Variant *)(message + 1);
-			for (int k = 0; k < message->args; k++) {
-				args[k].~Variant();
+			_destroy_message(message);
+
+			LOCK_MUTEX;
+			if (offset == page_bytes[i]) {
+				i++;
+				offset = 0;
 			}
 		}
 
-		message->~Message();
-
-		LOCK_MUTEX;
-		if (offset == page_bytes[i]) {
-			i++;
-			offset = 0;
+		// Typed calls may have been pushed to thread buffers meanwhile.
+		if (!use_thread_buffers || !_merge_thread_buffers()) {
+			break;
 		}
 	}
 
@@ -308,6 +536,10 @@ Error CallQueue::flush() {
 void CallQueue::clear() {
 	LOCK_MUTEX;
 
+	if (use_thread_buffers) {
+		_merge_thread_buffers();
+	}
+
 	if (pages.size() == 0) {
 		UNLOCK_MUTEX;
 		return; // Nothing to clear.
@@ -322,21 +554,11 @@ void CallQueue::clear() {
 
 			Message *message = (Message *)&page->data[offset];
 
-			uint32_t advance = sizeof(Message);
-			if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-				advance += sizeof(Variant) * message->args;
-			}
+			uint32_t advance = _get_message_size(message);
 
 			offset += advance;
 
-			if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-				Variant *args = (Variant *)(message + 1);
-				for (int k = 0; k < message->args; k++) {
-					args[k].~Variant();
-				}
-			}
-
-			message->~Message();
+			_destroy_message(message);
 		}
 	}
 
@@ -351,6 +573,7 @@ void CallQueue::statistics() {
 	HashMap<StringName, int> set_count;
 	HashMap<int, int> notify_count;
 	HashMap<Callable, int> call_count;
+	int typed_call_count = 0;
 	int null_count = 0;
 
 	for (uint32_t i = 0; i < pages_used; i++) {
@@ -362,10 +585,7 @@ void CallQueue::statistics() {
 
 			Message *message = (Message *)&page->data[offset];
 
-			uint32_t advance = sizeof(Message);
-			if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-				advance += sizeof(Variant) * message->args;
-			}
+			uint32_t advance = _get_message_size(message);
 
 			Object *target = message->callable.get_object();
 
@@ -402,6 +622,13 @@ void CallQueue::statistics() {
 						null_target = false;
 					}
 				} break;
+				case TYPE_TYPED_CALL: {
+					TypedCallBase *typed_call = (TypedCallBase *)(message + 1);
+					if (ObjectDB::get_instance(typed_call->object_id)) {
+						typed_call_count++;
+						null_target = false;
+					}
+				} break;
 			}
 			if (null_target) {
 				// Object was deleted.
@@ -412,19 +639,13 @@ void CallQueue::statistics() {
 
 			offset += advance;
 
-			if ((message->type & FLAG_MASK) != TYPE_NOTIFICATION) {
-				Variant *args = (Variant *)(message + 1);
-				for (int k = 0; k < message->args; k++) {
-					args[k].~Variant();
-				}
-			}
-
-			message->~Message();
+			_destroy_message(message);
 		}
 	}
 
 	fprintf(stdout, "TOTAL PAGES: %d (%d bytes).\n", pages_used, pages_used * PAGE_SIZE_BYTES);
 	fprintf(stdout, "NULL count: %d.\n", null_count);
+	fprintf(stdout, "TYPED CALL count: %d.\n", typed_call_count);
 
 	for (const KeyValue<StringName, int> &E : set_count) {
 		fprintf(stdout, "SET %s: %d.\n", String(E.key).utf8().get_data(), E.value);
@@ -470,6 +691,7 @@ CallQueue::CallQueue(Allocator *p_custom_allocator, uint32_t p_max_pages, const
 	}
 	max_pages = p_max_pages;
 	error_text = p_error_text;
+	queue_serial = last_queue_serial.increment();
 }
 
 CallQueue::~CallQueue() {
@@ -478,6 +700,20 @@ CallQueue::~CallQueue() {
 	for (uint32_t i = 0; i < pages.size(); i++) {
 		allocator->free(pages[i]);
 	}
+	// Buffers of threads still alive are freed by them on exit. They're empty after clear().
+	for (ThreadBuffer *buffer : thread_buffers) {
+		buffer->lock.lock();
+		for (Page *page : buffer->pages) {
+			allocator->free(page);
+		}
+		buffer->pages.clear();
+		buffer->page_bytes.clear();
+		buffer->pages_used = 0;
+		buffer->lock.unlock();
+		if (buffer->refcount.unref()) {
+			memdelete(buffer);
+		}
+	}
 	if (!allocator_is_custom) {
 		memdelete(allocator);
 	}
@@ -509,6 +745,7 @@ MessageQueue::MessageQueue() :
 				"Message queue out of memory. Try increasing 'memory/limits/message_queue/max_size_mb' in project settings.") {
 	ERR_FAIL_COND_MSG(main_singleton != nullptr, "A MessageQueue singleton already exists.");
 	main_singleton = this;
+	use_thread_buffers = true;
 }
 
 MessageQueue::~MessageQueue() {
@@ -32,9 +32,13 @@
 #define MESSAGE_QUEUE_H
 
 #include "core/object/object_id.h"
+#include "core/os/spin_lock.h"
 #include "core/os/thread_safe.h"
 #include "core/templates/local_vector.h"
 #include "core/templates/paged_allocator.h"
+#include "core/templates/safe_refcount.h"
+#include "core/templates/simple_type.h"
+#include "core/templates/tuple.h"
 #include "core/variant/variant.h"
 
 class Object;
@@ -60,6 +64,7 @@ private:
 		TYPE_CALL,
 		TYPE_NOTIFICATION,
 		TYPE_SET,
+		TYPE_TYPED_CALL, // Followed by a TypedCallBase, whose size is stored in args.
 		TYPE_END, // End marker.
 		FLAG_NULL_IS_OK = 1 << 13,
 		FLAG_SHOW_ERROR = 1 << 14,
@@ -90,6 +95,80 @@ private:
 		};
 	};
 
+	// Deferred call keeping its arguments as native types, so pushing and flushing it
+	// needs neither Variant boxing nor allocations.
+	struct TypedCallBase {
+		ObjectID object_id;
+		virtual void call(Object *p_object) = 0;
+		virtual ~TypedCallBase() = default;
+	};
+
+	template <typename T, typename M, typename... Args>
+	struct TypedCall : public TypedCallBase {
+		M method;
+		Tuple<GetSimpleTypeT<Args>...> args;
+
+		template <typename... FwdArgs>
+		_FORCE_INLINE_ TypedCall(ObjectID p_object_id, M p_method, FwdArgs &&...p_args) :
+				method(p_method), args(std::forward<FwdArgs>(p_args)...) {
+			object_id = p_object_id;
+		}
+
+		virtual void call(Object *p_object) override {
+			call_impl(static_cast<T *>(p_object), BuildIndexSequence<sizeof...(Args)>{});
+		}
+
+	private:
+		template <size_t... I>
+		_FORCE_INLINE_ void call_impl(T *p_instance, IndexSequence<I...>) {
+			// Move out of the Tuple, this will be destroyed as soon as the call is complete.
+			(p_instance->*method)(std::move(get<I>())...);
+		}
+
+		// This method exists so we can call it in the parameter pack expansion in call_impl.
+		template <size_t I>
+		_FORCE_INLINE_ auto &get() { return ::tuple_get<I>(args); }
+	};
+
+	// Typed calls pushed to a queue shared among threads are written to a buffer owned by the
+	// pushing thread, so they don't contend on the queue mutex. A thread's buffer is merged into
+	// the queue when it pushes an untyped message, which keeps each thread's messages in order,
+	// and when the queue is flushed.
+	struct ThreadBuffer {
+		SpinLock lock;
+		SafeRefCount refcount; // One reference for the queue, one for the thread.
+		uint64_t queue_serial = 0;
+		LocalVector<Page *> pages;
+		LocalVector<uint32_t> page_bytes;
+		uint32_t pages_used = 0;
+	};
+
+	struct ThreadBufferHolder {
+		ThreadBuffer *buffer = nullptr;
+		~ThreadBufferHolder();
+	};
+
+	static thread_local ThreadBufferHolder thread_buffer_holder;
+	static SafeNumeric<uint64_t> last_queue_serial;
+
+	uint64_t queue_serial = 0;
+	bool use_thread_buffers = false;
+	LocalVector<ThreadBuffer *> thread_buffers; // Guarded by mutex.
+	LocalVector<Page *> dropped_pages; // Thread buffer pages that didn't fit when merging. Guarded by mutex.
+	LocalVector<uint32_t> dropped_page_bytes;
+
+	static uint32_t _get_message_size(const Message *p_message);
+	static void _destroy_message(Message *p_message);
+
+	ThreadBuffer *_get_thread_buffer();
+	bool _merge_thread_buffer(ThreadBuffer *p_buffer);
+	void _drop_overflow_pages();
+	bool _merge_thread_buffers();
+	void _merge_current_thread_buffer();
+
+	uint8_t *_reserve_typed_call(uint32_t p_room_needed, ThreadBuffer *&r_buffer);
+	void _commit_typed_call(uint32_t p_room_needed, ThreadBuffer *p_buffer);
+
 	_FORCE_INLINE_ void _ensure_first_page() {
 		if (unlikely(pages.is_empty())) {
 			pages.push_back(allocator->alloc());
@@ -144,6 +223,31 @@ public:
 	Error push_notification(Object *p_object, int p_notification);
 	Error push_set(Object *p_object, const StringName &p_prop, const Variant &p_value);
 
+	// Fast path for deferred calls to native methods: arguments are kept as their own types.
+	// Typed calls pushed from different threads may run in a different order than they were pushed.
+	template <typename T, typename M, typename... Args>
+	Error push_typed_call(T *p_object, M p_method, Args &&...p_args) {
+		typedef TypedCall<T, M, Args...> CallType;
+		constexpr uint32_t room_needed = sizeof(Message) + ((sizeof(CallType) + 8U - 1U) & ~(8U - 1U));
+		static_assert(room_needed <= uint32_t(PAGE_SIZE_BYTES), "Typed call is too large to fit on a page.");
+		static_assert(alignof(CallType) <= 8, "Typed call arguments can't need more than 8-byte alignment.");
+		ERR_FAIL_NULL_V(p_object, ERR_INVALID_PARAMETER);
+
+		ThreadBuffer *buffer = nullptr;
+		uint8_t *buffer_end = _reserve_typed_call(room_needed, buffer);
+		if (unlikely(!buffer_end)) {
+			return ERR_OUT_OF_MEMORY;
+		}
+
+		Message *msg = memnew_placement(buffer_end, Message);
+		msg->type = TYPE_TYPED_CALL;
+		msg->args = room_needed - sizeof(Message);
+		memnew_placement(buffer_end + sizeof(Message), CallType(p_object->get_instance_id(), p_method, std::forward<Args>(p_args)...));
+
+		_commit_typed_call(room_needed, buffer);
+		return OK;
+	}
+
 	Error flush();
 	void clear();
 	void statistics();
@@ -44,6 +44,57 @@ void WorkerThreadPool::Task::free_template_userdata() {
 	memdelete(btu);
 }
 
+bool WorkerThreadPool::TaskDeque::push(Task *p_task) {
+	int64_t b = bottom.load(std::memory_order_relaxed);
+	int64_t t = top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY) {
+		return false;
+	}
+	buffer[b & (CAPACITY - 1)].store(p_task, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+WorkerThreadPool::Task *WorkerThreadPool::TaskDeque::pop() {
+	int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top.load(std::memory_order_relaxed);
+
+	if (t > b) {
+		// Empty.
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Task *task = buffer[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b) {
+		// Last one; race against thieves for it.
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+			task = nullptr;
+		}
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return task;
+}
+
+WorkerThreadPool::Task *WorkerThreadPool::TaskDeque::steal() {
+	int64_t t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom.load(std::memory_order_acquire);
+
+	if (t >= b) {
+		return nullptr;
+	}
+
+	Task *task = buffer[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+		return nullptr; // Lost the race to the owner or another thief.
+	}
+	return task;
+}
+
 WorkerThreadPool *WorkerThreadPool::singleton = nullptr;
 
 #ifdef THREADS_ENABLED
@@ -183,7 +234,18 @@ void WorkerThreadPool::_thread_function(void *p_user) {
 
 	while (true) {
 		Task *task_to_process = nullptr;
-		{
+
+		// Tasks from this thread's own deque or stolen from others don't need the lock.
+		// After a streak of them, the shared queue gets its turn so it doesn't starve.
+		if (thread_data->local_streak < MAX_LOCAL_STREAK) {
+			task_to_process = singleton->_take_local_task(thread_data);
+		}
+
+		if (task_to_process) {
+			thread_data->local_streak++;
+		} else {
+			thread_data->local_streak = 0;
+
 			MutexLock lock(singleton->task_mutex);
 
 			bool exit = singleton->_handle_runlevel(thread_data, lock);
@@ -193,10 +255,13 @@ void WorkerThreadPool::_thread_function(void *p_user) {
 
 			thread_data->signaled = false;
 
-			if (singleton->task_queue.first()) {
-				task_to_process = singleton->task_queue.first()->self();
-				singleton->task_queue.remove(singleton->task_queue.first());
-			} else {
+			task_to_process = singleton->_take_shared_task();
+			if (!task_to_process) {
+				task_to_process = singleton->_take_local_task(thread_data);
+			}
+			// Deques are only pushed to with the lock held, so if they look empty here,
+			// no notification can be missed while waiting.
+			if (!task_to_process && !singleton->_has_queued_tasks()) {
 				thread_data->cond_var.wait(lock);
 			}
 		}
@@ -230,10 +295,16 @@ void WorkerThreadPool::_post_tasks(Task **p_tasks, uint32_t p_count, bool p_high
 
 	ThreadData *caller_pool_thread = thread_ids.has(Thread::get_caller_id()) ? &threads[thread_ids[Thread::get_caller_id()]] : nullptr;
 
+	// Tasks spawned from a pool thread go to its own deque, where it will find them first
+	// and idle threads can steal them. Everything else goes through the shared queue.
+	TaskDeque *local_deque = (caller_pool_thread && work_stealing_enabled) ? &caller_pool_thread->deque : nullptr;
+
 	for (uint32_t i = 0; i < p_count; i++) {
 		p_tasks[i]->low_priority = !p_high_priority;
 		if (p_high_priority || low_priority_threads_used < max_low_priority_threads) {
-			task_queue.add_last(&p_tasks[i]->task_elem);
+			if (!local_deque || !local_deque->push(p_tasks[i])) {
+				task_queue.add_last(&p_tasks[i]->task_elem);
+			}
 			if (!p_high_priority) {
 				low_priority_threads_used++;
 			}
@@ -324,6 +395,61 @@ bool WorkerThreadPool::_try_promote_low_priority_task() {
 	}
 }
 
+WorkerThreadPool::Task *WorkerThreadPool::_take_local_task(ThreadData *p_thread_data) {
+	Task *task = p_thread_data->deque.pop();
+	if (!task) {
+		task = _steal_task(p_thread_data);
+	}
+	return task;
+}
+
+WorkerThreadPool::Task *WorkerThreadPool::_take_shared_task() {
+	if (!task_queue.first()) {
+		return nullptr;
+	}
+	Task *task = task_queue.first()->self();
+	task_queue.remove(task_queue.first());
+	return task;
+}
+
+WorkerThreadPool::Task *WorkerThreadPool::_steal_task(ThreadData *p_thief) {
+	uint32_t thread_count = threads.size();
+	if (thread_count < 2) {
+		return nullptr;
+	}
+
+	// Start at a random victim so thieves don't all pile up on the same deque.
+	uint32_t seed = p_thief->steal_seed;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	p_thief->steal_seed = seed;
+
+	uint32_t victim = seed % thread_count;
+	for (uint32_t i = 0; i < thread_count; i++, victim = (victim + 1) % thread_count) {
+		if (victim == p_thief->index) {
+			continue;
+		}
+		Task *task = threads[victim].deque.steal();
+		if (task) {
+			return task;
+		}
+	}
+	return nullptr;
+}
+
+bool WorkerThreadPool::_has_queued_tasks() const {
+	if (task_queue.first()) {
+		return true;
+	}
+	for (uint32_t i = 0; i < threads.size(); i++) {
+		if (!threads[i].deque.is_empty()) {
+			return true;
+		}
+	}
+	return false;
+}
+
 WorkerThreadPool::TaskID WorkerThreadPool::add_native_task(void (*p_func)(void *), void *p_userdata, bool p_high_priority, const String &p_description) {
 	return _add_task(Callable(), p_func, p_userdata, nullptr, p_high_priority, p_description);
 }
@@ -479,7 +605,7 @@ void WorkerThreadPool::_wait_collaboratively(ThreadData *p_caller_pool_thread, T
 				if (was_signaled) {
 					// This thread was awaken for some additional reason, but it's about to exit.
 					// Let's find out what may be pending and forward the requests.
-					uint32_t to_process = task_queue.first() ? 1 : 0;
+					uint32_t to_process = _has_queued_tasks() ? 1 : 0;
 					uint32_t to_promote = p_caller_pool_thread->current_task->low_priority && low_priority_task_queue.first() ? 1 : 0;
 					if (to_process || to_promote) {
 						// This thread must be left alone since it won't loop again.
@@ -497,12 +623,12 @@ void WorkerThreadPool::_wait_collaboratively(ThreadData *p_caller_pool_thread, T
 				}
 			}
 
-			if (singleton->task_queue.first()) {
-				task_to_process = task_queue.first()->self();
-				task_queue.remove(task_queue.first());
+			task_to_process = _take_local_task(p_caller_pool_thread);
+			if (!task_to_process) {
+				task_to_process = _take_shared_task();
 			}
 
-			if (!task_to_process) {
+			if (!task_to_process && !_has_queued_tasks()) {
 				p_caller_pool_thread->awaited_task = p_task;
 
 				_unlock_unlockable_mutexes();
@@ -543,7 +669,7 @@ bool WorkerThreadPool::_handle_runlevel(ThreadData *p_thread_data, MutexLock<Bin
 		} break;
 		case RUNLEVEL_PRE_EXIT_LANGUAGES: {
 			if (!p_thread_data->pre_exited_languages) {
-				if (!task_queue.first() && !low_priority_task_queue.first()) {
+				if (!_has_queued_tasks() && !low_priority_task_queue.first()) {
 					p_thread_data->pre_exited_languages = true;
 					runlevel_data.pre_exit_languages.num_idle_threads++;
 					control_cond_var.notify_all();
@@ -709,6 +835,16 @@ void WorkerThreadPool::wait_for_group_task_completion(GroupID p_group) {
 #endif
 }
 
+void WorkerThreadPool::set_work_stealing_enabled(bool p_enabled) {
+	MutexLock task_lock(task_mutex);
+	work_stealing_enabled = p_enabled;
+}
+
+bool WorkerThreadPool::is_work_stealing_enabled() const {
+	MutexLock task_lock(task_mutex);
+	return work_stealing_enabled;
+}
+
 int WorkerThreadPool::get_thread_index() {
 	Thread::ID tid = Thread::get_caller_id();
 	return singleton->thread_ids.has(tid) ? singleton->thread_ids[tid] : -1;
@@ -766,6 +902,7 @@ void WorkerThreadPool::init(int p_thread_count, float p_low_priority_task_ratio)
 
 	for (uint32_t i = 0; i < threads.size(); i++) {
 		threads[i].index = i;
+		threads[i].steal_seed = i * 2654435761u + 1; // Any non-zero value works for xorshift.
 		threads[i].thread.start(&WorkerThreadPool::_thread_function, &threads[i]);
 		thread_ids.insert(threads[i].thread.get_id(), i);
 	}
@@ -96,16 +96,41 @@ private:
 				task_elem(this) {}
 	};
 
+	// Chase-Lev work-stealing deque. Only the owning pool thread pushes and pops at the bottom,
+	// while any other thread may steal from the top. It has a fixed capacity; when full,
+	// tasks are posted to the shared queue instead.
+	struct TaskDeque {
+		static const int64_t CAPACITY = 1024; // Must be a power of two.
+
+		std::atomic<int64_t> top;
+		uint8_t padding[64]; // Keep thieves and the owner on separate cache lines.
+		std::atomic<int64_t> bottom;
+		std::atomic<Task *> buffer[CAPACITY];
+
+		bool push(Task *p_task);
+		Task *pop();
+		Task *steal();
+		_FORCE_INLINE_ bool is_empty() const {
+			return bottom.load(std::memory_order_acquire) <= top.load(std::memory_order_acquire);
+		}
+
+		TaskDeque() :
+				top(0),
+				bottom(0) {}
+	};
+
 	static const uint32_t TASKS_PAGE_SIZE = 1024;
 	static const uint32_t GROUPS_PAGE_SIZE = 256;
+	static const uint32_t MAX_LOCAL_STREAK = 32; // Local tasks run in a row before looking at the shared queue.
 
 	PagedAllocator<Task, false, TASKS_PAGE_SIZE> task_allocator;
 	PagedAllocator<Group, false, GROUPS_PAGE_SIZE> group_allocator;
 
 	SelfList<Task>::List low_priority_task_queue;
-	SelfList<Task>::List task_queue;
+	SelfList<Task>::List task_queue; // Shared; tasks posted from pool threads go to their own deques.
 
 	BinaryMutex task_mutex;
+	bool work_stealing_enabled = true;
 
 	struct ThreadData {
 		static Task *const YIELDING; // Too bad constexpr doesn't work here.
@@ -119,6 +144,9 @@ private:
 		Task *current_task = nullptr;
 		Task *awaited_task = nullptr; // Null if not awaiting the condition variable, or special value (YIELDING).
 		ConditionVariable cond_var;
+		TaskDeque deque;
+		uint32_t steal_seed = 1;
+		uint32_t local_streak = 0;
 
 		ThreadData() :
 				signaled(false),
@@ -175,6 +203,11 @@ private:
 
 	bool _try_promote_low_priority_task();
 
+	Task *_take_local_task(ThreadData *p_thread_data);
+	Task *_take_shared_task();
+	Task *_steal_task(ThreadData *p_thief);
+	bool _has_queued_tasks() const;
+
 	static WorkerThreadPool *singleton;
 
 #ifdef THREADS_ENABLED
@@ -266,6 +299,11 @@ public:
 #endif
 	}
 
+	// When disabled, tasks spawned from pool threads go to the shared queue like any other,
+	// which is how the pool behaved before work stealing. Meant for comparisons and debugging.
+	void set_work_stealing_enabled(bool p_enabled);
+	bool is_work_stealing_enabled() const;
+
 	static WorkerThreadPool *get_singleton() { return singleton; }
 	static int get_thread_index();
 	static TaskID get_caller_task_id();
@@ -0,0 +1,242 @@
+/**************************************************************************/
+/*  engine_allocator.cpp                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#include "engine_allocator.h"
+
+#include "core/error/error_macros.h"
+#include "core/os/spin_lock.h"
+
+#include <stdlib.h>
+#include <atomic>
+
+const uint32_t EngineAllocator::size_classes[SIZE_CLASS_COUNT] = { 16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024 };
+
+// Everything here is constant-initialized and trivially destructible (except for the per-thread
+// cleanup helpers), as it can be used by static constructors and destructors in any order.
+
+static std::atomic<uint64_t> slab_claimed(0);
+static std::atomic<uint64_t> slab_reserved(0);
+
+#ifdef ENGINE_ALLOCATOR_ENABLED
+
+static constexpr size_t CHUNK_HEADER_SIZE = alignof(max_align_t) > sizeof(void *) ? alignof(max_align_t) : sizeof(void *);
+
+struct SlabFreeBlock {
+	SlabFreeBlock *next;
+};
+
+struct SlabCentralList {
+	SpinLock lock;
+	SlabFreeBlock *free = nullptr;
+	uint8_t *carve_pos = nullptr;
+	uint8_t *carve_end = nullptr;
+};
+
+struct SlabThreadCache {
+	SlabFreeBlock *free[EngineAllocator::SIZE_CLASS_COUNT];
+	uint32_t count[EngineAllocator::SIZE_CLASS_COUNT];
+	bool initialized;
+	bool exited;
+};
+
+struct SlabThreadCacheFlusher {
+	void touch() {}
+	~SlabThreadCacheFlusher();
+};
+
+static SlabCentralList slab_central[EngineAllocator::SIZE_CLASS_COUNT];
+static SpinLock slab_chunks_lock;
+static void *slab_chunks = nullptr; // Keeps them reachable for leak checkers.
+static thread_local SlabThreadCache slab_cache;
+static thread_local SlabThreadCacheFlusher slab_cache_flusher;
+
+_FORCE_INLINE_ static uint32_t _slab_batch_size(uint32_t p_class) {
+	return CLAMP(8192u / EngineAllocator::size_classes[p_class], 8u, 64u);
+}
+
+static uint8_t *_slab_alloc_chunk() {
+	uint8_t *chunk = (uint8_t *)malloc(EngineAllocator::SLAB_CHUNK_SIZE);
+	if (!chunk) {
+		return nullptr; // Can't report here, the caller holds a lock printing may need.
+	}
+
+	slab_chunks_lock.lock();
+	*(void **)chunk = slab_chunks;
+	slab_chunks = chunk;
+	slab_chunks_lock.unlock();
+
+	slab_reserved.fetch_add(EngineAllocator::SLAB_CHUNK_SIZE, std::memory_order_relaxed);
+	return chunk + CHUNK_HEADER_SIZE;
+}
+
+// Takes up to p_count blocks from the central list, carving new ones as needed.
+static uint32_t _slab_fetch(uint32_t p_class, uint32_t p_count, SlabFreeBlock *&r_list) {
+	const uint32_t size = EngineAllocator::size_classes[p_class];
+	SlabCentralList &central = slab_central[p_class];
+
+	uint32_t fetched = 0;
+	bool out_of_memory = false;
+	r_list = nullptr;
+
+	central.lock.lock();
+	while (fetched < p_count) {
+		SlabFreeBlock *block = central.free;
+		if (block) {
+			central.free = block->next;
+		} else {
+			if (central.carve_pos + size > central.carve_end) {
+				if (fetched) {
+					break; // Good enough, don't grab a chunk for the tail of the batch.
+				}
+				uint8_t *chunk = _slab_alloc_chunk();
+				if (!chunk) {
+					out_of_memory = true;
+					break;
+				}
+				central.carve_pos = chunk;
+				central.carve_end = chunk + EngineAllocator::SLAB_CHUNK_SIZE - CHUNK_HEADER_SIZE;
+			}
+			block = (SlabFreeBlock *)central.carve_pos;
+			central.carve_pos += size;
+		}
+		block->next = r_list;
+		r_list = block;
+		fetched++;
+	}
+	central.lock.unlock();
+
+	ERR_FAIL_COND_V_MSG(out_of_memory, 0, "Out of memory allocating a slab chunk.");
+
+	slab_claimed.fetch_add((uint64_t)fetched * size, std::memory_order_relaxed);
+	return fetched;
+}
+
+static void _slab_release(uint32_t p_class, SlabFreeBlock *p_first, SlabFreeBlock *p_last, uint32_t p_count) {
+	SlabCentralList &central = slab_central[p_class];
+
+	central.lock.lock();
+	p_last->next = central.free;
+	central.free = p_first;
+	central.lock.unlock();
+
+	slab_claimed.fetch_sub((uint64_t)p_count * EngineAllocator::size_classes[p_class], std::memory_order_relaxed);
+}
+
+SlabThreadCacheFlusher::~SlabThreadCacheFlusher() {
+	for (uint32_t i = 0; i < EngineAllocator::SIZE_CLASS_COUNT; i++) {
+		SlabFreeBlock *first = slab_cache.free[i];
+		if (!first) {
+			continue;
+		}
+		SlabFreeBlock *last = first;
+		while (last->next) {
+			last = last->next;
+		}
+		_slab_release(i, first, last, slab_cache.count[i]);
+		slab_cache.free[i] = nullptr;
+		slab_cache.count[i] = 0;
+	}
+	// Anything allocated or freed by this thread from now on goes straight to the central lists.
+	slab_cache.exited = true;
+}
+
+void *EngineAllocator::alloc_small(size_t p_bytes) {
+	const uint32_t size_class = get_size_class(p_bytes);
+	SlabThreadCache &cache = slab_cache;
+
+	SlabFreeBlock *block = cache.free[size_class];
+	if (likely(block)) {
+		cache.free[size_class] = block->next;
+		cache.count[size_class]--;
+		return block;
+	}
+
+	if (unlikely(cache.exited)) {
+		_slab_fetch(size_class, 1, block);
+		return block;
+	}
+
+	if (unlikely(!cache.initialized)) {
+		// Registers the flusher for when this thread exits.
+		slab_cache_flusher.touch();
+		cache.initialized = true;
+	}
+
+	const uint32_t fetched = _slab_fetch(size_class, _slab_batch_size(size_class), block);
+	if (unlikely(!fetched)) {
+		return nullptr;
+	}
+	cache.free[size_class] = block->next;
+	cache.count[size_class] = fetched - 1;
+	return block;
+}
+
+void EngineAllocator::free_small(void *p_ptr, size_t p_bytes) {
+	const uint32_t size_class = get_size_class(p_bytes);
+	SlabThreadCache &cache = slab_cache;
+	SlabFreeBlock *block = (SlabFreeBlock *)p_ptr;
+
+	if (unlikely(cache.exited)) {
+		_slab_release(size_class, block, block, 1);
+		return;
+	}
+
+	if (unlikely(!cache.initialized)) {
+		slab_cache_flusher.touch();
+		cache.initialized = true;
+	}
+
+	block->next = cache.free[size_class];
+	cache.free[size_class] = block;
+	cache.count[size_class]++;
+
+	// Give a batch back once this thread holds on to too many, so blocks freed on a different
+	// thread than the one allocating them flow back.
+	const uint32_t batch = _slab_batch_size(size_class);
+	if (unlikely(cache.count[size_class] > batch * 2)) {
+		SlabFreeBlock *last = block;
+		for (uint32_t i = 1; i < batch; i++) {
+			last = last->next;
+		}
+		cache.free[size_class] = last->next;
+		cache.count[size_class] -= batch;
+		_slab_release(size_class, block, last, batch);
+	}
+}
+
+#endif // ENGINE_ALLOCATOR_ENABLED
+
+uint64_t EngineAllocator::get_small_claimed() {
+	return slab_claimed.load(std::memory_order_relaxed);
+}
+
+uint64_t EngineAllocator::get_small_reserved() {
+	return slab_reserved.load(std::memory_order_relaxed);
+}
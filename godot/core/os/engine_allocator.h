@@ -0,0 +1,74 @@
+/**************************************************************************/
+/*  engine_allocator.h                                                    */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef ENGINE_ALLOCATOR_H
+#define ENGINE_ALLOCATOR_H
+
+#include "core/typedefs.h"
+
+#include <stddef.h>
+
+// Allocator sitting between Memory and the system heap.
+//
+// Small blocks (built with `engine_allocator=yes`, which defines ENGINE_ALLOCATOR_ENABLED) come
+// from size-class slabs. Each thread keeps a short free list per class and trades batches of
+// blocks with a central list per class, so most allocations and frees don't synchronize at all.
+// Blocks are never given back to the system, but any thread can free and reuse them.
+
+class EngineAllocator {
+public:
+	enum {
+		SIZE_CLASS_COUNT = 14,
+		SMALL_MAX_SIZE = 1024,
+		SLAB_CHUNK_SIZE = 64 * 1024,
+	};
+
+	static const uint32_t size_classes[SIZE_CLASS_COUNT];
+
+	_FORCE_INLINE_ static uint32_t get_size_class(size_t p_bytes) {
+		// Steps of 16 bytes up to 128, then two classes per power of two.
+		static constexpr uint8_t large_classes[16] = { 0, 0, 8, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13 };
+		if (p_bytes <= 128) {
+			return p_bytes ? (p_bytes - 1) >> 4 : 0;
+		}
+		return large_classes[(p_bytes - 1) >> 6];
+	}
+
+	_FORCE_INLINE_ static bool is_small(size_t p_bytes) { return p_bytes <= SMALL_MAX_SIZE; }
+
+	static void *alloc_small(size_t p_bytes);
+	static void free_small(void *p_ptr, size_t p_bytes);
+
+	// Blocks taken from the central lists, whether they're in use or cached by a thread.
+	static uint64_t get_small_claimed();
+	static uint64_t get_small_reserved();
+};
+
+#endif // ENGINE_ALLOCATOR_H
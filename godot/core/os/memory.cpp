@@ -30,6 +30,7 @@
 
 #include "memory.h"
 
+#include "core/os/engine_allocator.h"
 #include "core/templates/safe_refcount.h"
 
 #include <stdlib.h>
@@ -97,13 +98,18 @@ void Memory::free_aligned_static(void *p_memory) {
 }
 
 void *Memory::alloc_static(size_t p_bytes, bool p_pad_align) {
-#ifdef DEBUG_ENABLED
+#if defined(DEBUG_ENABLED) || defined(ENGINE_ALLOCATOR_ENABLED)
 	bool prepad = true;
 #else
 	bool prepad = p_pad_align;
 #endif
 
+#ifdef ENGINE_ALLOCATOR_ENABLED
+	// Always prepadded, so the size class can be found again when freeing.
+	void *mem = EngineAllocator::is_small(p_bytes + DATA_OFFSET) ? EngineAllocator::alloc_small(p_bytes + DATA_OFFSET) : malloc(p_bytes + DATA_OFFSET);
+#else
 	void *mem = malloc(p_bytes + (prepad ? DATA_OFFSET : 0));
+#endif
 
 	ERR_FAIL_NULL_V(mem, nullptr);
 
@@ -132,7 +138,7 @@ void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align) {
 
 	uint8_t *mem = (uint8_t *)p_memory;
 
-#ifdef DEBUG_ENABLED
+#if defined(DEBUG_ENABLED) || defined(ENGINE_ALLOCATOR_ENABLED)
 	bool prepad = true;
 #else
 	bool prepad = p_pad_align;
@@ -151,6 +157,40 @@ void *Memory::realloc_static(void *p_memory, size_t p_bytes, bool p_pad_align) {
 		}
 #endif
 
+#ifdef ENGINE_ALLOCATOR_ENABLED
+		const size_t prev_bytes = *s;
+		const bool prev_small = EngineAllocator::is_small(prev_bytes + DATA_OFFSET);
+		const bool small = EngineAllocator::is_small(p_bytes + DATA_OFFSET);
+
+		if (p_bytes == 0) {
+			if (prev_small) {
+				EngineAllocator::free_small(mem, prev_bytes + DATA_OFFSET);
+			} else {
+				free(mem);
+			}
+			return nullptr;
+		} else if (prev_small && small && EngineAllocator::get_size_class(prev_bytes + DATA_OFFSET) == EngineAllocator::get_size_class(p_bytes + DATA_OFFSET)) {
+			*s = p_bytes;
+			return mem + DATA_OFFSET;
+		} else if (prev_small || small) {
+			// Moving between slabs, or between a slab and the system heap.
+			uint8_t *new_mem = (uint8_t *)(small ? EngineAllocator::alloc_small(p_bytes + DATA_OFFSET) : malloc(p_bytes + DATA_OFFSET));
+			ERR_FAIL_NULL_V(new_mem, nullptr);
+
+			memcpy(new_mem, mem, MIN(prev_bytes, (uint64_t)p_bytes) + DATA_OFFSET);
+			if (prev_small) {
+				EngineAllocator::free_small(mem, prev_bytes + DATA_OFFSET);
+			} else {
+				free(mem);
+			}
+
+			s = (uint64_t *)(new_mem + SIZE_OFFSET);
+			*s = p_bytes;
+
+			return new_mem + DATA_OFFSET;
+		}
+#endif
+
 		if (p_bytes == 0) {
 			free(mem);
 			return nullptr;
@@ -180,7 +220,7 @@ void Memory::free_static(void *p_ptr, bool p_pad_align) {
 
 	uint8_t *mem = (uint8_t *)p_ptr;
 
-#ifdef DEBUG_ENABLED
+#if defined(DEBUG_ENABLED) || defined(ENGINE_ALLOCATOR_ENABLED)
 	bool prepad = true;
 #else
 	bool prepad = p_pad_align;
@@ -196,6 +236,13 @@ void Memory::free_static(void *p_ptr, bool p_pad_align) {
 		mem_usage.sub(*s);
 #endif
 
+#ifdef ENGINE_ALLOCATOR_ENABLED
+		const uint64_t bytes = *(uint64_t *)(mem + SIZE_OFFSET);
+		if (EngineAllocator::is_small(bytes + DATA_OFFSET)) {
+			EngineAllocator::free_small(mem, bytes + DATA_OFFSET);
+			return;
+		}
+#endif
 		free(mem);
 	} else {
 		free(mem);
@@ -68,6 +68,7 @@
 #include "core/math/a_star_grid_2d.h"
 #include "core/math/expression.h"
 #include "core/math/random_number_generator.h"
+#include "core/math/static_raycaster.h"
 #include "core/math/triangle_mesh.h"
 #include "core/object/class_db.h"
 #include "core/object/script_language_extension.h"
@@ -235,6 +236,7 @@ void register_core_types() {
 	GDREGISTER_CLASS(OptimizedTranslation);
 	GDREGISTER_CLASS(UndoRedo);
 	GDREGISTER_CLASS(TriangleMesh);
+	GDREGISTER_ABSTRACT_CLASS(StaticRaycaster);
 
 	GDREGISTER_CLASS(ResourceFormatLoader);
 	GDREGISTER_CLASS(ResourceFormatSaver);
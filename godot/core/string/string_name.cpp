@@ -67,10 +67,188 @@ StringName _scs_create(const char *p_chr, bool p_static) {
 	return (p_chr[0] ? StringName(StaticCString::create(p_chr), p_static) : StringName());
 }
 
+StringName::_Shard StringName::_shards[StringName::STRING_TABLE_SHARDS];
+
+StringName::_Buckets *StringName::_alloc_buckets(uint32_t p_len) {
+	_Buckets *buckets = memnew(_Buckets);
+	buckets->mask = p_len - 1;
+	buckets->slots = memnew_arr(std::atomic<_Data *>, p_len);
+	for (uint32_t i = 0; i < p_len; i++) {
+		buckets->slots[i].store(nullptr, std::memory_order_relaxed);
+	}
+	return buckets;
+}
+
+void StringName::_free_buckets(_Buckets *p_buckets) {
+	memdelete_arr(p_buckets->slots);
+	memdelete(p_buckets);
+}
+
+void StringName::_grow(_Shard &p_shard) {
+	_Buckets *old_buckets = p_shard.buckets.load(std::memory_order_relaxed);
+	const uint32_t old_len = old_buckets->mask + 1;
+	_Buckets *new_buckets = _alloc_buckets(old_len * 2);
+
+	// Entries are relinked in place, so a reader walking the old buckets meanwhile may be led
+	// into another chain and miss its name. It still reaches the end of a chain, and misses are
+	// only trusted if resize_version is even and didn't change during the walk.
+	p_shard.resize_version.fetch_add(1);
+	for (uint32_t i = 0; i < old_len; i++) {
+		_Data *d = old_buckets->slots[i].load(std::memory_order_relaxed);
+		while (d) {
+			_Data *next = d->next.load(std::memory_order_relaxed);
+			std::atomic<_Data *> &slot = new_buckets->slots[d->hash & new_buckets->mask];
+			d->next.store(slot.load(std::memory_order_relaxed));
+			slot.store(d, std::memory_order_relaxed);
+			d = next;
+		}
+	}
+	p_shard.buckets.store(new_buckets);
+	p_shard.resize_version.fetch_add(1);
+
+	p_shard.retired_buckets.push_back(old_buckets);
+	p_shard.has_retired.store(true);
+}
+
+void StringName::_reclaim(_Shard &p_shard) {
+	// Must be called with the shard mutex held. Anything retired before a moment with no readers
+	// can't be reached anymore, as new readers only see the current buckets and chains.
+	if (!p_shard.has_retired.load() || p_shard.readers.load() != 0) {
+		return;
+	}
+
+	for (_Data *d : p_shard.retired_data) {
+		memdelete(d);
+	}
+	for (_Buckets *buckets : p_shard.retired_buckets) {
+		_free_buckets(buckets);
+	}
+	p_shard.retired_data.clear();
+	p_shard.retired_buckets.clear();
+	p_shard.has_retired.store(false);
+}
+
+template <typename T>
+StringName::_Data *StringName::_find(_Shard &p_shard, uint32_t p_hash, const T &p_name, bool &r_resized) {
+	p_shard.readers.fetch_add(1);
+	const uint32_t version = p_shard.resize_version.load();
+
+	_Buckets *buckets = p_shard.buckets.load();
+	_Data *data = buckets->slots[p_hash & buckets->mask].load();
+	while (data) {
+		// Compare hash first. Entries being freed fail to ref, so skip them.
+		if (data->hash == p_hash && data->operator==(p_name) && data->refcount.ref()) {
+			break;
+		}
+		data = data->next.load();
+	}
+
+	r_resized = (version & 1) || p_shard.resize_version.load() != version;
+
+	if (p_shard.readers.fetch_sub(1) == 1 && p_shard.has_retired.load() && p_shard.mutex.try_lock()) {
+		_reclaim(p_shard);
+		p_shard.mutex.unlock();
+	}
+
+	return data;
+}
+
+template <typename T>
+StringName::_Data *StringName::_find_locked(_Shard &p_shard, uint32_t p_hash, const T &p_name) {
+	_Buckets *buckets = p_shard.buckets.load(std::memory_order_relaxed);
+	_Data *data = buckets->slots[p_hash & buckets->mask].load(std::memory_order_relaxed);
+	while (data) {
+		if (data->hash == p_hash && data->operator==(p_name) && data->refcount.ref()) {
+			break;
+		}
+		data = data->next.load(std::memory_order_relaxed);
+	}
+	return data;
+}
+
+template <typename T>
+StringName::_Data *StringName::_intern(uint32_t p_hash, const T &p_name, const char *p_cname, bool p_static) {
+	_Shard &shard = _get_shard(p_hash);
+
+	bool resized = false;
+	_Data *data = _find(shard, p_hash, p_name, resized);
+
+	if (!data) {
+		MutexLock lock(shard.mutex);
+
+		// Someone else may have added it since, or a resize hid it.
+		data = _find_locked(shard, p_hash, p_name);
+
+		if (!data) {
+			data = memnew(_Data);
+			if (p_cname) {
+				data->cname = p_cname;
+			} else {
+				data->name = p_name;
+			}
+			data->refcount.init();
+			data->static_count.set(p_static ? 1 : 0);
+			data->hash = p_hash;
+#ifdef DEBUG_ENABLED
+			if (unlikely(debug_stringname)) {
+				// Keep in memory, force static.
+				data->refcount.ref();
+				data->static_count.increment();
+			}
+#endif
+
+			if (shard.count > shard.buckets.load(std::memory_order_relaxed)->mask) {
+				_grow(shard);
+			}
+
+			_Buckets *buckets = shard.buckets.load(std::memory_order_relaxed);
+			std::atomic<_Data *> &slot = buckets->slots[p_hash & buckets->mask];
+			data->next.store(slot.load(std::memory_order_relaxed), std::memory_order_relaxed);
+			slot.store(data);
+			shard.count++;
+
+			_reclaim(shard);
+			return data;
+		}
+	}
+
+	// Exists.
+	if (p_static) {
+		data->static_count.increment();
+	}
+#ifdef DEBUG_ENABLED
+	if (unlikely(debug_stringname)) {
+		data->debug_references++;
+	}
+#endif
+	return data;
+}
+
+template <typename T>
+StringName::_Data *StringName::_search(uint32_t p_hash, const T &p_name) {
+	_Shard &shard = _get_shard(p_hash);
+
+	bool resized = false;
+	_Data *data = _find(shard, p_hash, p_name, resized);
+
+	if (!data && resized) {
+		MutexLock lock(shard.mutex);
+		data = _find_locked(shard, p_hash, p_name);
+	}
+
+#ifdef DEBUG_ENABLED
+	if (data && unlikely(debug_stringname)) {
+		data->debug_references++;
+	}
+#endif
+	return data;
+}
+
 void StringName::setup() {
 	ERR_FAIL_COND(configured);
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
-		_table[i] = nullptr;
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+		_shards[i].buckets.store(_alloc_buckets(STRING_TABLE_SHARD_MIN_LEN));
+		_shards[i].count = 0;
 	}
 	configured = true;
 }
@@ -81,11 +259,14 @@ void StringName::cleanup() {
 #ifdef DEBUG_ENABLED
 	if (unlikely(debug_stringname)) {
 		Vector<_Data *> data;
-		for (int i = 0; i < STRING_TABLE_LEN; i++) {
-			_Data *d = _table[i];
-			while (d) {
-				data.push_back(d);
-				d = d->next;
+		for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+			_Buckets *buckets = _shards[i].buckets.load();
+			for (uint32_t j = 0; j <= buckets->mask; j++) {
+				_Data *d = buckets->slots[j].load();
+				while (d) {
+					data.push_back(d);
+					d = d->next.load();
+				}
 			}
 		}
 
@@ -108,22 +289,33 @@ void StringName::cleanup() {
 	}
 #endif
 	int lost_strings = 0;
-	for (int i = 0; i < STRING_TABLE_LEN; i++) {
-		while (_table[i]) {
-			_Data *d = _table[i];
-			if (d->static_count.get() != d->refcount.get()) {
-				lost_strings++;
+	for (int i = 0; i < STRING_TABLE_SHARDS; i++) {
+		_Shard &shard = _shards[i];
+		_Buckets *buckets = shard.buckets.load();
+		for (uint32_t j = 0; j <= buckets->mask; j++) {
+			_Data *d = buckets->slots[j].load();
+			while (d) {
+				if (d->static_count.get() != d->refcount.get()) {
+					lost_strings++;
 
-				if (OS::get_singleton()->is_stdout_verbose()) {
-					String dname = String(d->cname ? d->cname : d->name);
+					if (OS::get_singleton()->is_stdout_verbose()) {
+						String dname = String(d->cname ? d->cname : d->name);
 
-					print_line(vformat("Orphan StringName: %s (static: %d, total: %d)", dname, d->static_count.get(), d->refcount.get()));
+						print_line(vformat("Orphan StringName: %s (static: %d, total: %d)", dname, d->static_count.get(), d->refcount.get()));
+					}
 				}
-			}
 
-			_table[i] = _table[i]->next;
-			memdelete(d);
+				_Data *next = d->next.load();
+				memdelete(d);
+				d = next;
+			}
 		}
+
+		// No readers are left at this point.
+		_reclaim(shard);
+		_free_buckets(buckets);
+		shard.buckets.store(nullptr);
+		shard.count = 0;
 	}
 	if (lost_strings) {
 		print_verbose(vformat("StringName: %d unclaimed string names at exit.", lost_strings));
@@ -135,7 +327,8 @@ void StringName::unref() {
 	ERR_FAIL_COND(!configured);
 
 	if (_data && _data->refcount.unref()) {
-		MutexLock lock(mutex);
+		_Shard &shard = _get_shard(_data->hash);
+		MutexLock lock(shard.mutex);
 
 		if (CoreGlobals::leak_reporting_enabled && _data->static_count.get() > 0) {
 			if (_data->cname) {
@@ -144,19 +337,26 @@ void StringName::unref() {
 				ERR_PRINT("BUG: Unreferenced static string to 0: " + String(_data->name));
 			}
 		}
-		if (_data->prev) {
-			_data->prev->next = _data->next;
-		} else {
-			if (_table[_data->idx] != _data) {
+
+		_Buckets *buckets = shard.buckets.load(std::memory_order_relaxed);
+		std::atomic<_Data *> *link = &buckets->slots[_data->hash & buckets->mask];
+		while (link->load(std::memory_order_relaxed) != _data) {
+			_Data *d = link->load(std::memory_order_relaxed);
+			if (!d) {
 				ERR_PRINT("BUG!");
+				break;
 			}
-			_table[_data->idx] = _data->next;
+			link = &d->next;
 		}
 
-		if (_data->next) {
-			_data->next->prev = _data->prev;
+		if (link->load(std::memory_order_relaxed) == _data) {
+			// Lock-free readers may still be looking at it, so it's only freed once they're gone.
+			link->store(_data->next.load(std::memory_order_relaxed));
+			shard.count--;
+			shard.retired_data.push_back(_data);
+			shard.has_retired.store(true);
+			_reclaim(shard);
 		}
-		memdelete(_data);
 	}
 
 	_data = nullptr;
@@ -269,54 +469,7 @@ StringName::StringName(const char *p_name, bool p_static) {
 		return; //empty, ignore
 	}
 
-	const uint32_t hash = String::hash(p_name);
-	const uint32_t idx = hash & STRING_TABLE_MASK;
-
-	MutexLock lock(mutex);
-	_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->operator==(p_name)) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		// exists
-		if (p_static) {
-			_data->static_count.increment();
-		}
-#ifdef DEBUG_ENABLED
-		if (unlikely(debug_stringname)) {
-			_data->debug_references++;
-		}
-#endif
-		return;
-	}
-
-	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->static_count.set(p_static ? 1 : 0);
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-
-#ifdef DEBUG_ENABLED
-	if (unlikely(debug_stringname)) {
-		// Keep in memory, force static.
-		_data->refcount.ref();
-		_data->static_count.increment();
-	}
-#endif
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
+	_data = _intern(String::hash(p_name), p_name, nullptr, p_static);
 }
 
 StringName::StringName(const StaticCString &p_static_string, bool p_static) {
@@ -326,53 +479,7 @@ StringName::StringName(const StaticCString &p_static_string, bool p_static) {
 
 	ERR_FAIL_COND(!p_static_string.ptr || !p_static_string.ptr[0]);
 
-	const uint32_t hash = String::hash(p_static_string.ptr);
-	const uint32_t idx = hash & STRING_TABLE_MASK;
-
-	MutexLock lock(mutex);
-	_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->operator==(p_static_string.ptr)) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		// exists
-		if (p_static) {
-			_data->static_count.increment();
-		}
-#ifdef DEBUG_ENABLED
-		if (unlikely(debug_stringname)) {
-			_data->debug_references++;
-		}
-#endif
-		return;
-	}
-
-	_data = memnew(_Data);
-
-	_data->refcount.init();
-	_data->static_count.set(p_static ? 1 : 0);
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = p_static_string.ptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-#ifdef DEBUG_ENABLED
-	if (unlikely(debug_stringname)) {
-		// Keep in memory, force static.
-		_data->refcount.ref();
-		_data->static_count.increment();
-	}
-#endif
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
+	_data = _intern(String::hash(p_static_string.ptr), p_static_string.ptr, p_static_string.ptr, p_static);
 }
 
 StringName::StringName(const String &p_name, bool p_static) {
@@ -384,53 +491,7 @@ StringName::StringName(const String &p_name, bool p_static) {
 		return;
 	}
 
-	const uint32_t hash = p_name.hash();
-	const uint32_t idx = hash & STRING_TABLE_MASK;
-
-	MutexLock lock(mutex);
-	_data = _table[idx];
-
-	while (_data) {
-		if (_data->hash == hash && _data->operator==(p_name)) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		// exists
-		if (p_static) {
-			_data->static_count.increment();
-		}
-#ifdef DEBUG_ENABLED
-		if (unlikely(debug_stringname)) {
-			_data->debug_references++;
-		}
-#endif
-		return;
-	}
-
-	_data = memnew(_Data);
-	_data->name = p_name;
-	_data->refcount.init();
-	_data->static_count.set(p_static ? 1 : 0);
-	_data->hash = hash;
-	_data->idx = idx;
-	_data->cname = nullptr;
-	_data->next = _table[idx];
-	_data->prev = nullptr;
-#ifdef DEBUG_ENABLED
-	if (unlikely(debug_stringname)) {
-		// Keep in memory, force static.
-		_data->refcount.ref();
-		_data->static_count.increment();
-	}
-#endif
-
-	if (_table[idx]) {
-		_table[idx]->prev = _data;
-	}
-	_table[idx] = _data;
+	_data = _intern(p_name.hash(), p_name, nullptr, p_static);
 }
 
 StringName StringName::search(const char *p_name) {
@@ -441,28 +502,9 @@ StringName StringName::search(const char *p_name) {
 		return StringName();
 	}
 
-	const uint32_t hash = String::hash(p_name);
-	const uint32_t idx = hash & STRING_TABLE_MASK;
-
-	MutexLock lock(mutex);
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->operator==(p_name)) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-#ifdef DEBUG_ENABLED
-		if (unlikely(debug_stringname)) {
-			_data->debug_references++;
-		}
-#endif
-
-		return StringName(_data);
+	_Data *data = _search(String::hash(p_name), p_name);
+	if (data) {
+		return StringName(data);
 	}
 
 	return StringName(); //does not exist
@@ -476,22 +518,9 @@ StringName StringName::search(const char32_t *p_name) {
 		return StringName();
 	}
 
-	const uint32_t hash = String::hash(p_name);
-	const uint32_t idx = hash & STRING_TABLE_MASK;
-
-	MutexLock lock(mutex);
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->operator==(p_name)) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-		return StringName(_data);
+	_Data *data = _search(String::hash(p_name), String(p_name));
+	if (data) {
+		return StringName(data);
 	}
 
 	return StringName(); //does not exist
@@ -500,27 +529,9 @@ StringName StringName::search(const char32_t *p_name) {
 StringName StringName::search(const String &p_name) {
 	ERR_FAIL_COND_V(p_name.is_empty(), StringName());
 
-	const uint32_t hash = p_name.hash();
-	const uint32_t idx = hash & STRING_TABLE_MASK;
-
-	MutexLock lock(mutex);
-	_Data *_data = _table[idx];
-
-	while (_data) {
-		// compare hash first
-		if (_data->hash == hash && _data->operator==(p_name)) {
-			break;
-		}
-		_data = _data->next;
-	}
-
-	if (_data && _data->refcount.ref()) {
-#ifdef DEBUG_ENABLED
-		if (unlikely(debug_stringname)) {
-			_data->debug_references++;
-		}
-#endif
-		return StringName(_data);
+	_Data *data = _search(p_name.hash(), p_name);
+	if (data) {
+		return StringName(data);
 	}
 
 	return StringName(); //does not exist
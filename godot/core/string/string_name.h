@@ -32,9 +32,12 @@
 #define STRING_NAME_H
 
 #include "core/os/mutex.h"
+#include "core/os/thread.h"
 #include "core/string/ustring.h"
 #include "core/templates/safe_refcount.h"
 
+#include <atomic>
+
 #define UNIQUE_NODE_PREFIX "%"
 
 class Main;
@@ -46,9 +49,9 @@ struct StaticCString {
 
 class StringName {
 	enum {
-		STRING_TABLE_BITS = 16,
-		STRING_TABLE_LEN = 1 << STRING_TABLE_BITS,
-		STRING_TABLE_MASK = STRING_TABLE_LEN - 1
+		STRING_TABLE_SHARD_BITS = 6,
+		STRING_TABLE_SHARDS = 1 << STRING_TABLE_SHARD_BITS,
+		STRING_TABLE_SHARD_MIN_LEN = 1 << 10,
 	};
 
 	struct _Data {
@@ -65,17 +68,51 @@ class StringName {
 		bool operator==(const char *p_name) const;
 		bool operator!=(const char *p_name) const;
 
-		int idx = 0;
 		uint32_t hash = 0;
-		_Data *prev = nullptr;
-		_Data *next = nullptr;
+		std::atomic<_Data *> next = nullptr;
 		_Data() {}
 	};
 
-	static inline _Data *_table[STRING_TABLE_LEN];
+	struct _Buckets {
+		uint32_t mask = 0;
+		std::atomic<_Data *> *slots = nullptr;
+	};
+
+	// The table is split in shards by the top bits of the hash, each one growing on its own.
+	// Existing names are found without locking: readers only announce themselves in `readers`,
+	// and unlinked entries or replaced bucket arrays are retired until no reader can see them.
+	// Inserting, removing and resizing take the shard mutex.
+	struct alignas(Thread::CACHE_LINE_BYTES) _Shard {
+		Mutex mutex;
+		std::atomic<_Buckets *> buckets = nullptr;
+		std::atomic<uint32_t> readers = 0;
+		std::atomic<uint32_t> resize_version = 0; // Odd while rehashing.
+		std::atomic<bool> has_retired = false;
+		uint32_t count = 0;
+		Vector<_Data *> retired_data;
+		Vector<_Buckets *> retired_buckets;
+	};
+
+	static _Shard _shards[STRING_TABLE_SHARDS];
 
 	_Data *_data = nullptr;
 
+	_FORCE_INLINE_ static _Shard &_get_shard(uint32_t p_hash) {
+		return _shards[p_hash >> (32 - STRING_TABLE_SHARD_BITS)];
+	}
+	static _Buckets *_alloc_buckets(uint32_t p_len);
+	static void _free_buckets(_Buckets *p_buckets);
+	static void _grow(_Shard &p_shard);
+	static void _reclaim(_Shard &p_shard);
+	template <typename T>
+	static _Data *_find(_Shard &p_shard, uint32_t p_hash, const T &p_name, bool &r_resized);
+	template <typename T>
+	static _Data *_find_locked(_Shard &p_shard, uint32_t p_hash, const T &p_name);
+	template <typename T>
+	static _Data *_intern(uint32_t p_hash, const T &p_name, const char *p_cname, bool p_static);
+	template <typename T>
+	static _Data *_search(uint32_t p_hash, const T &p_name);
+
 	void unref();
 	friend void register_core_types();
 	friend void unregister_core_types();
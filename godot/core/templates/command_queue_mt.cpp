@@ -30,9 +30,22 @@
 
 #include "command_queue_mt.h"
 
-CommandQueueMT::CommandQueueMT() {
+CommandQueueMT::CommandQueueMT(uint32_t p_ring_size_kb) :
+		ring_write_pos(0),
+		ring_read_pos(0),
+		use_locked_path(false),
+		pump_task_id(WorkerThreadPool::INVALID_TASK_ID),
+		pending(false) {
 	command_mem.reserve(DEFAULT_COMMAND_MEM_SIZE_KB * 1024);
+	if (p_ring_size_kb > 0) {
+		ring_size = next_power_of_2(p_ring_size_kb * 1024);
+		ring = (uint8_t *)Memory::alloc_static(ring_size);
+		memset(ring, 0, ring_size);
+	}
 }
 
 CommandQueueMT::~CommandQueueMT() {
+	if (ring) {
+		Memory::free_static(ring);
+	}
 }
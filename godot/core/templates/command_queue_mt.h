@@ -105,22 +105,55 @@ class CommandQueueMT {
 	/***** BASE *******/
 
 	static const uint32_t DEFAULT_COMMAND_MEM_SIZE_KB = 64;
+	static const uint32_t DEFAULT_RING_SIZE_KB = 256;
+
+	// Commands are pushed to a lock-free multi-producer ring buffer whenever possible.
+	// Sync commands, and commands not fitting in the ring, are appended to command_mem
+	// under the mutex instead (the locked path). The ring is always drained first, and
+	// once a command has taken the locked path because the ring was full, every later one
+	// does too until the consumer has taken them, so each producer's order is kept.
+
+	enum RingSlotState : uint32_t {
+		RING_SLOT_EMPTY,
+		RING_SLOT_COMMAND,
+		RING_SLOT_PADDING, // Unused space at the end of the ring, skipped by the consumer.
+	};
+
+	struct RingSlotHeader {
+		uint32_t size; // Bytes following the header.
+		std::atomic<uint32_t> state; // Set last by the producer, to publish the slot.
+	};
+	static_assert(sizeof(RingSlotHeader) == 8, "Ring slot headers must keep commands 8-byte aligned.");
+
+	uint8_t *ring = nullptr; // Consumed bytes are zeroed, so stale data is never taken for a header.
+	uint64_t ring_size = 0; // Power of two, or zero if the ring is disabled.
+	std::atomic<uint64_t> ring_write_pos;
+	std::atomic<uint64_t> ring_read_pos;
+	std::atomic<bool> use_locked_path;
 
 	BinaryMutex mutex;
 	LocalVector<uint8_t> command_mem;
+	LocalVector<uint8_t> flush_mem; // command_mem is swapped into it to be flushed without the lock.
+	uint64_t flush_mem_ring_end = 0; // Ring position the commands in flush_mem have to wait for.
 	ConditionVariable sync_cond_var;
 	uint32_t sync_head = 0;
 	uint32_t sync_tail = 0;
 	uint32_t sync_awaiters = 0;
-	WorkerThreadPool::TaskID pump_task_id = WorkerThreadPool::INVALID_TASK_ID;
-	uint64_t flush_read_ptr = 0;
+	std::atomic<WorkerThreadPool::TaskID> pump_task_id;
+	bool flushing = false;
 	std::atomic<bool> pending;
 
+	template <typename T>
+	static constexpr uint64_t _get_alloc_size() {
+		constexpr uint64_t alloc_size = ((sizeof(T) + 8U - 1U) & ~(8U - 1U));
+		static_assert(alloc_size < UINT32_MAX, "Type too large to fit in the command queue.");
+		return alloc_size;
+	}
+
 	template <typename T, typename... Args>
 	_FORCE_INLINE_ void create_command(Args &&...p_args) {
 		// alloc size is size+T+safeguard
-		constexpr uint64_t alloc_size = ((sizeof(T) + 8U - 1U) & ~(8U - 1U));
-		static_assert(alloc_size < UINT32_MAX, "Type too large to fit in the command queue.");
+		constexpr uint64_t alloc_size = _get_alloc_size<T>();
 
 		uint64_t size = command_mem.size();
 		command_mem.resize(size + alloc_size + sizeof(uint64_t));
@@ -130,18 +163,72 @@ class CommandQueueMT {
 		pending.store(true);
 	}
 
+	_FORCE_INLINE_ void _notify_pump() {
+		WorkerThreadPool::TaskID pump_task = pump_task_id.load(std::memory_order_acquire);
+		if (pump_task != WorkerThreadPool::INVALID_TASK_ID) {
+			WorkerThreadPool::get_singleton()->notify_yield_over(pump_task);
+		}
+	}
+
+	// Returns false if the command has to take the locked path.
+	template <typename T, typename... Args>
+	_FORCE_INLINE_ bool _try_push_ring(Args &&...p_args) {
+		constexpr uint64_t slot_size = sizeof(RingSlotHeader) + _get_alloc_size<T>();
+		if (slot_size > ring_size || use_locked_path.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		// Reserve the slot. If it would cross the end of the ring, the rest of the lap
+		// is reserved too, as padding, so commands are always contiguous.
+		uint64_t pos = ring_write_pos.load(std::memory_order_relaxed);
+		uint64_t padding = 0;
+		do {
+			uint64_t offset = pos & (ring_size - 1);
+			padding = offset + slot_size > ring_size ? ring_size - offset : 0;
+			if (pos + padding + slot_size - ring_read_pos.load(std::memory_order_acquire) > ring_size) {
+				return false; // Full.
+			}
+		} while (!ring_write_pos.compare_exchange_weak(pos, pos + padding + slot_size, std::memory_order_relaxed));
+
+		if (padding) {
+			RingSlotHeader *padding_header = reinterpret_cast<RingSlotHeader *>(ring + (pos & (ring_size - 1)));
+			padding_header->size = padding - sizeof(RingSlotHeader);
+			padding_header->state.store(RING_SLOT_PADDING, std::memory_order_release);
+			pos += padding;
+		}
+
+		RingSlotHeader *header = reinterpret_cast<RingSlotHeader *>(ring + (pos & (ring_size - 1)));
+		header->size = slot_size - sizeof(RingSlotHeader);
+		new (header + 1) T(std::forward<Args>(p_args)...);
+		header->state.store(RING_SLOT_COMMAND, std::memory_order_release);
+
+		// Only the first push since the consumer last started flushing needs to wake it up;
+		// the others are batched into that same flush.
+		if (!pending.exchange(true, std::memory_order_acq_rel)) {
+			_notify_pump();
+		}
+		return true;
+	}
+
 	template <typename T, bool NeedsSync, typename... Args>
 	_FORCE_INLINE_ void _push_internal(Args &&...args) {
+		if constexpr (!NeedsSync) {
+			if (_try_push_ring<T>(std::forward<Args>(args)...)) {
+				return;
+			}
+		}
+
 		MutexLock mlock(mutex);
 		create_command<T>(std::forward<Args>(args)...);
 
-		if (pump_task_id != WorkerThreadPool::INVALID_TASK_ID) {
-			WorkerThreadPool::get_singleton()->notify_yield_over(pump_task_id);
-		}
+		_notify_pump();
 
 		if constexpr (NeedsSync) {
+			// The caller can't push anything else until this one is done, so the ring can keep being used.
 			sync_tail++;
 			_wait_for_sync(mlock);
+		} else {
+			use_locked_path.store(true, std::memory_order_release);
 		}
 	}
 
@@ -154,44 +241,104 @@ class CommandQueueMT {
 		}
 	}
 
-	void _flush() {
-		if (unlikely(flush_read_ptr)) {
-			// Re-entrant call.
-			return;
+	// Runs the published commands in the ring, up to p_until. Returns false if it had
+	// to stop at a slot that is reserved but still being written.
+	bool _flush_ring(uint64_t p_until) {
+		if (!ring) {
+			return true;
 		}
 
-		MutexLock lock(mutex);
+		uint64_t pos = ring_read_pos.load(std::memory_order_relaxed);
+		while (pos < p_until) {
+			RingSlotHeader *header = reinterpret_cast<RingSlotHeader *>(ring + (pos & (ring_size - 1)));
+			uint32_t state = header->state.load(std::memory_order_acquire);
+			if (state == RING_SLOT_EMPTY) {
+				return pos == ring_write_pos.load(std::memory_order_acquire);
+			}
 
-		while (flush_read_ptr < command_mem.size()) {
-			uint64_t size = *(uint64_t *)&command_mem[flush_read_ptr];
-			flush_read_ptr += 8;
-			CommandBase *cmd = reinterpret_cast<CommandBase *>(&command_mem[flush_read_ptr]);
-			uint32_t allowance_id = WorkerThreadPool::thread_enter_unlock_allowance_zone(lock);
-			cmd->call();
-			WorkerThreadPool::thread_exit_unlock_allowance_zone(allowance_id);
+			uint64_t slot_size = sizeof(RingSlotHeader) + header->size;
+			if (state == RING_SLOT_COMMAND) {
+				CommandBase *cmd = reinterpret_cast<CommandBase *>(header + 1);
+				cmd->call();
+				cmd->~CommandBase();
+			}
+
+			memset((void *)header, 0, slot_size);
+			pos += slot_size;
+			ring_read_pos.store(pos, std::memory_order_release);
+		}
+		return true;
+	}
 
-			// Handle potential realloc due to the command and unlock allowance.
-			cmd = reinterpret_cast<CommandBase *>(&command_mem[flush_read_ptr]);
+	void _flush_locked_commands() {
+		uint64_t read_ptr = 0;
+		while (read_ptr < flush_mem.size()) {
+			uint64_t size = *(uint64_t *)&flush_mem[read_ptr];
+			read_ptr += 8;
+			CommandBase *cmd = reinterpret_cast<CommandBase *>(&flush_mem[read_ptr]);
+			cmd->call();
 
 			if (unlikely(cmd->sync)) {
-				sync_head++;
-				lock.~MutexLock(); // Give an opportunity to awaiters right away.
+				{
+					MutexLock lock(mutex);
+					sync_head++;
+				}
 				sync_cond_var.notify_all();
-				new (&lock) MutexLock(mutex);
-				// Handle potential realloc happened during unlock.
-				cmd = reinterpret_cast<CommandBase *>(&command_mem[flush_read_ptr]);
 			}
 
 			cmd->~CommandBase();
 
-			flush_read_ptr += size;
+			read_ptr += size;
 		}
+		flush_mem.clear();
+	}
+
+	void _flush() {
+		if (unlikely(flushing)) {
+			// Re-entrant call.
+			return;
+		}
+		flushing = true;
+
+		// Anything published from now on will set this again.
+		pending.exchange(false, std::memory_order_acq_rel);
+
+		while (true) {
+			if (flush_mem.is_empty()) {
+				MutexLock lock(mutex);
+				if (!command_mem.is_empty()) {
+					SWAP(command_mem, flush_mem);
+					// The ring commands reserved until now may have been pushed before the locked ones,
+					// so they run first. Later ones wait for the next pass, which keeps a producer that
+					// never stops pushing to the ring from holding back the locked (and sync) commands.
+					// Read before the ring is reopened, so nothing pushed after the locked commands is included.
+					flush_mem_ring_end = ring_write_pos.load(std::memory_order_acquire);
+					use_locked_path.store(false, std::memory_order_release);
+				}
+			}
 
-		command_mem.clear();
-		pending.store(false);
-		flush_read_ptr = 0;
+			if (flush_mem.is_empty()) {
+				// A single pass too, anything pushed meanwhile sets pending for the next flush.
+				if (!_flush_ring(ring_write_pos.load(std::memory_order_acquire))) {
+					break;
+				}
+				MutexLock lock(mutex);
+				if (command_mem.is_empty()) {
+					_prevent_sync_wraparound();
+					break;
+				}
+				continue;
+			}
 
-		_prevent_sync_wraparound();
+			if (!_flush_ring(flush_mem_ring_end)) {
+				break;
+			}
+			_flush_locked_commands();
+		}
+
+		// If the ring stopped at a command being written, the locked commands have to
+		// wait for it (they stay in flush_mem). Its producer will set pending once it's published.
+		flushing = false;
 	}
 
 	_FORCE_INLINE_ void _wait_for_sync(MutexLock<BinaryMutex> &p_lock) {
@@ -243,17 +390,18 @@ public:
 	}
 
 	void wait_and_flush() {
-		ERR_FAIL_COND(pump_task_id == WorkerThreadPool::INVALID_TASK_ID);
-		WorkerThreadPool::get_singleton()->wait_for_task_completion(pump_task_id);
+		WorkerThreadPool::TaskID pump_task = pump_task_id.load(std::memory_order_acquire);
+		ERR_FAIL_COND(pump_task == WorkerThreadPool::INVALID_TASK_ID);
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(pump_task);
 		_flush();
 	}
 
 	void set_pump_task_id(WorkerThreadPool::TaskID p_task_id) {
-		MutexLock lock(mutex);
-		pump_task_id = p_task_id;
+		pump_task_id.store(p_task_id, std::memory_order_release);
 	}
 
-	CommandQueueMT();
+	// A zero-sized ring makes every command take the locked path.
+	CommandQueueMT(uint32_t p_ring_size_kb = DEFAULT_RING_SIZE_KB);
 	~CommandQueueMT();
 };
 
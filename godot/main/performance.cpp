@@ -30,6 +30,7 @@
 
 #include "performance.h"
 
+#include "core/os/engine_allocator.h"
 #include "core/os/os.h"
 #include "core/variant/typed_array.h"
 #include "scene/main/node.h"
@@ -97,6 +98,8 @@ void Performance::_bind_methods() {
 	BIND_ENUM_CONSTANT(PIPELINE_COMPILATIONS_SURFACE);
 	BIND_ENUM_CONSTANT(PIPELINE_COMPILATIONS_DRAW);
 	BIND_ENUM_CONSTANT(PIPELINE_COMPILATIONS_SPECIALIZATION);
+	BIND_ENUM_CONSTANT(MEMORY_SLAB_CLAIMED);
+	BIND_ENUM_CONSTANT(MEMORY_SLAB_RESERVED);
 	BIND_ENUM_CONSTANT(MONITOR_MAX);
 }
 
@@ -151,6 +154,8 @@ String Performance::get_monitor_name(Monitor p_monitor) const {
 		PNAME("pipeline/compilations_surface"),
 		PNAME("pipeline/compilations_draw"),
 		PNAME("pipeline/compilations_specialization"),
+		PNAME("memory/slab_claimed"),
+		PNAME("memory/slab_reserved"),
 	};
 	static_assert((sizeof(names) / sizeof(const char *)) == MONITOR_MAX);
 
@@ -173,6 +178,10 @@ double Performance::get_monitor(Monitor p_monitor) const {
 			return Memory::get_mem_max_usage();
 		case MEMORY_MESSAGE_BUFFER_MAX:
 			return MessageQueue::get_singleton()->get_max_buffer_usage();
+		case MEMORY_SLAB_CLAIMED:
+			return EngineAllocator::get_small_claimed();
+		case MEMORY_SLAB_RESERVED:
+			return EngineAllocator::get_small_reserved();
 		case OBJECT_COUNT:
 			return ObjectDB::get_object_count();
 		case OBJECT_RESOURCE_COUNT:
@@ -298,6 +307,8 @@ Performance::MonitorType Performance::get_monitor_type(Monitor p_monitor) const
 		MONITOR_TYPE_QUANTITY,
 		MONITOR_TYPE_QUANTITY,
 		MONITOR_TYPE_QUANTITY,
+		MONITOR_TYPE_MEMORY,
+		MONITOR_TYPE_MEMORY,
 
 	};
 	static_assert((sizeof(types) / sizeof(MonitorType)) == MONITOR_MAX);
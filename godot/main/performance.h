@@ -106,6 +106,8 @@ public:
 		PIPELINE_COMPILATIONS_SURFACE,
 		PIPELINE_COMPILATIONS_DRAW,
 		PIPELINE_COMPILATIONS_SPECIALIZATION,
+		MEMORY_SLAB_CLAIMED,
+		MEMORY_SLAB_RESERVED,
 		MONITOR_MAX
 	};
 
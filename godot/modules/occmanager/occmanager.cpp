@@ -1,6 +1,17 @@
 #include "occmanager.h"
+#include "topology_hash.h"
+#include "picking_index.h"
+#include "shape_cache.h"
+
+#include "core/math/geometry_3d.h"
+
+#include "scene/resources/mesh.h"
+#include "scene/resources/surface_tool.h"
+
 #include <STEPControl_Reader.hxx>
 #include <BRepMesh_IncrementalMesh.hxx>
+#include <IMeshTools_Parameters.hxx>
+#include <BRepBuilderAPI_Copy.hxx>
 #include <BRepBuilderAPI_MakeVertex.hxx>
 #include <BRepBuilderAPI_MakeEdge.hxx>
 #include <BRepBuilderAPI_MakeWire.hxx>
@@ -8,13 +19,17 @@
 #include <BRepBuilderAPI_MakeFace.hxx>
 #include <BRep_Builder.hxx>
 #include <TopExp_Explorer.hxx>
+#include <TopoDS_Iterator.hxx>
 #include <TopTools_IndexedMapOfShape.hxx>
 #include <TopExp.hxx>
 #include <TopoDS_Face.hxx>
 #include <TopoDS.hxx>
 
 #include <Poly_Triangulation.hxx>
+#include <BRepLib_ToolTriangulatedShape.hxx>
 #include <BRep_Tool.hxx>
+#include <BRepAdaptor_Curve.hxx>
+#include <GCPnts_TangentialDeflection.hxx>
 #include <TColgp_Array1OfPnt.hxx>
 #include <gp_Pnt.hxx>
 #include <gp_Pln.hxx>
@@ -26,28 +41,64 @@
 #include <Geom_BSplineCurve.hxx>
 #include <GeomAPI_PointsToBSpline.hxx>
 #include <TColgp_Array1OfPnt.hxx>
-#include <set>
+#include <Message_ProgressIndicator.hxx>
+#include <Message_ProgressScope.hxx>
+#include <Standard_Failure.hxx>
+#include <functional>
+#include <algorithm>
 
 OCCManager::OCCManager() {
 
 }
 
+OCCManager::~OCCManager() {
+    // The workers use this object, so they have to be done before it goes away
+    for (auto &task : import_tasks) {
+        task.second->cancelled = true;
+    }
+    for (auto &task : import_tasks) {
+        WorkerThreadPool::get_singleton()->wait_for_task_completion(task.second->pool_task);
+    }
+}
+
 void OCCManager::save_state(const String &state_name) {
+    // A state must never see half a batch
+    if (batch_shape_index != -1) {
+        commit_batch();
+    }
     //If this isn't the most recent position, remove all later states first
-    if ((position_in_stack != -1) && (position_in_stack < undo_shapes.size() - 1)) {
-        undo_shapes.erase(undo_shapes.begin() + position_in_stack + 1, undo_shapes.end());
-        undo_shape_vertices.erase(undo_shape_vertices.begin() + position_in_stack + 1, undo_shape_vertices.end());
-        undo_shape_edges.erase(undo_shape_edges.begin() + position_in_stack + 1, undo_shape_edges.end());
+    if ((position_in_stack != -1) && (position_in_stack < (int)undo_states.size() - 1)) {
+        // Snapshots shared with the current state must not point past it anymore, the dropped state IDs are given to the new states
+        const int64_t current_state = undo_state_base + position_in_stack;
+        for (int i = position_in_stack + 1; i < (int)undo_states.size(); i++) {
+            for (const std::shared_ptr<ShapeSnapshot> &snapshot : undo_states[i]) {
+                snapshot->last_state = MIN(snapshot->last_state, current_state);
+            }
+        }
+        undo_states.erase(undo_states.begin() + position_in_stack + 1, undo_states.end());
         undo_state_names.erase(undo_state_names.begin() + position_in_stack + 1, undo_state_names.end());
     }
 
     // Save the current state of shapes, vertices, and edges to the undo stack
-    undo_shapes.push_back(shapes);
-    undo_shape_vertices.push_back(shape_vertices);
-    undo_shape_edges.push_back(shape_edges);
+    // Only the shapes that changed since the last save get a new snapshot, the others reuse the one they already point to
+    const int64_t state_id = undo_state_base + undo_states.size();
+    UndoState state;
+    state.reserve(shapes.size());
+    for (int i = 0; i < (int)shapes.size(); i++) {
+        if (!shape_snapshots[i]) {
+            shape_snapshots[i] = make_snapshot(i);
+            shape_snapshots[i]->first_state = state_id;
+            hot_snapshots.push_back(shape_snapshots[i]);
+        }
+        shape_snapshots[i]->last_state = state_id;
+        state.push_back(shape_snapshots[i]);
+    }
+    undo_states.push_back(state);
     undo_state_names.push_back(state_name);
 
-    position_in_stack = undo_shapes.size() - 1;
+    position_in_stack = undo_states.size() - 1;
+    enforce_undo_memory_budget();
+    update_hot_snapshots();
     print_undo_stack();
 }
 
@@ -61,7 +112,7 @@ void OCCManager::undo() {
 
 //Goes to next state
 void OCCManager::redo() {
-    if (position_in_stack < undo_shapes.size() - 1) {
+    if (position_in_stack < (int)undo_states.size() - 1) {
         load_state(position_in_stack + 1);
     }
 }
@@ -71,23 +122,201 @@ bool OCCManager::load_state(int position) {
     if(position_in_stack == position){
         return false;
     }
-    if (position < undo_shapes.size()) {
-        shapes = undo_shapes[position];
-        shape_vertices = undo_shape_vertices[position];
-        shape_edges = undo_shape_edges[position];
+    if (position < 0 || position >= (int)undo_states.size()) {
+        ERR_PRINT("Undo state position out of bounds");
+        return false;
+    }
+    // Undoing (or redoing) past a batch that was never committed drops it
+    if (batch_shape_index != -1) {
+        discard_batch();
+    }
+
+    const UndoState &state = undo_states[position];
+    //The cold snapshots are read back first so nothing changes if one of them can't be
+    for (const std::shared_ptr<ShapeSnapshot> &snapshot : state) {
+        if (snapshot->cold && !load_cold_snapshot(snapshot)) {
+            return false;
+        }
+    }
+
+    shapes.resize(state.size());
+    shape_vertices.resize(state.size());
+    shape_edges.resize(state.size());
+    shape_snapshots.resize(state.size());
+    topology_indices.resize(state.size());
+    shape_change_logs.resize(state.size());
+
+    //Only copy back the shapes that differ from the ones we currently have
+    for (int i = 0; i < (int)state.size(); i++) {
+        if (shape_snapshots[i] == state[i]) {
+            continue;
+        }
+        shapes[i] = state[i]->shape;
+        shape_vertices[i] = state[i]->vertices;
+        shape_edges[i] = state[i]->edges;
+        shape_snapshots[i] = state[i];
+        topology_indices[i] = nullptr;
+        reset_shape_changes(i);
+        // Its faces are normally still triangulated, this only meshes them if the deflections changed since
+        mesh_shape(i);
     }
     position_in_stack = position;
+    update_hot_snapshots();
     print_undo_stack();
     return true;
 }
 
+void OCCManager::mark_shape_modified(int shape_index) {
+    if (shape_index < 0 || shape_index >= (int)shape_snapshots.size()) {
+        ERR_PRINT("Shape index out of bounds");
+        return;
+    }
+    shape_snapshots[shape_index] = nullptr;
+}
+
+std::shared_ptr<OCCManager::ShapeSnapshot> OCCManager::make_snapshot(int shape_index) const {
+    std::shared_ptr<ShapeSnapshot> snapshot = std::make_shared<ShapeSnapshot>();
+    snapshot->shape = shapes[shape_index];
+    snapshot->vertices = shape_vertices[shape_index];
+    snapshot->edges = shape_edges[shape_index];
+
+    //The TopoDS graph is shared with the live shape (OCC shapes are handles), so we only count what the snapshot owns
+    snapshot->memory_cost = sizeof(ShapeSnapshot) +
+            snapshot->vertices.capacity() * sizeof(gp_Pnt) +
+            snapshot->edges.capacity() * sizeof(TopoDS_Edge);
+    return snapshot;
+}
+
+void OCCManager::update_hot_snapshots() {
+    const int64_t current_state = undo_state_base + position_in_stack;
+    for (size_t i = 0; i < hot_snapshots.size();) {
+        ShapeSnapshot &snapshot = *hot_snapshots[i];
+        // Nothing but this list points to it anymore, its states were dropped
+        bool keep = hot_snapshots[i].use_count() > 1;
+        if (keep && undo_hot_state_count > 0 &&
+                (snapshot.last_state <= current_state - undo_hot_state_count || snapshot.first_state >= current_state + undo_hot_state_count)) {
+            keep = !make_snapshot_cold(snapshot);
+        }
+        if (keep) {
+            i++;
+            continue;
+        }
+        hot_snapshots[i] = std::move(hot_snapshots.back());
+        hot_snapshots.pop_back();
+    }
+}
+
+bool OCCManager::make_snapshot_cold(ShapeSnapshot &snapshot) {
+    // A snapshot that was loaded back from the file is still there
+    if (snapshot.record.size == 0) {
+        snapshot.linear_deflection = 0;
+        snapshot.angular_deflection = 0;
+        if (is_meshed_with(snapshot.shape, linear_deflection, angular_deflection)) {
+            snapshot.linear_deflection = linear_deflection;
+            snapshot.angular_deflection = angular_deflection;
+        }
+        std::vector<uint8_t> data;
+        ShapeCache::serialize(snapshot.shape, snapshot.vertices, snapshot.edges, data);
+        if (!undo_file.append(data, snapshot.record)) {
+            return false;
+        }
+    }
+    snapshot.shape.Nullify();
+    std::vector<gp_Pnt>().swap(snapshot.vertices);
+    std::vector<TopoDS_Edge>().swap(snapshot.edges);
+    snapshot.cold = true;
+    return true;
+}
+
+bool OCCManager::load_cold_snapshot(const std::shared_ptr<ShapeSnapshot> &snapshot) {
+    std::vector<uint8_t> data;
+    if (!undo_file.read(snapshot->record, data) ||
+            !ShapeCache::deserialize(data.data(), data.size(), snapshot->shape, snapshot->vertices, snapshot->edges)) {
+        ERR_PRINT("Couldn't read an undo state back from the undo file");
+        return false;
+    }
+    // The triangulation was written along with the shape, so mesh_shape doesn't have to redo it (unless the deflections changed since)
+    if (snapshot->linear_deflection > 0) {
+        record_meshed_faces(snapshot->shape, snapshot->linear_deflection, snapshot->angular_deflection);
+    }
+    snapshot->cold = false;
+    hot_snapshots.push_back(snapshot);
+    return true;
+}
+
+void OCCManager::enforce_undo_memory_budget() {
+    if (undo_memory_budget <= 0) {
+        return;
+    }
+    //Never evict the current state
+    while (position_in_stack > 0 && get_undo_memory_usage() > undo_memory_budget) {
+        //Cold states don't use any memory, dropping them wouldn't help
+        bool has_hot_snapshot = false;
+        for (const std::shared_ptr<ShapeSnapshot> &snapshot : undo_states.front()) {
+            has_hot_snapshot = has_hot_snapshot || !snapshot->cold;
+        }
+        if (!has_hot_snapshot) {
+            break;
+        }
+        undo_states.erase(undo_states.begin());
+        undo_state_names.erase(undo_state_names.begin());
+        undo_state_base++;
+        position_in_stack--;
+    }
+}
+
+void OCCManager::set_undo_memory_budget(int64_t bytes) {
+    undo_memory_budget = bytes;
+    enforce_undo_memory_budget();
+    update_hot_snapshots();
+}
+
+int64_t OCCManager::get_undo_memory_budget() const {
+    return undo_memory_budget;
+}
+
+int64_t OCCManager::get_undo_memory_usage() const {
+    //Every snapshot in memory is in hot_snapshots exactly once
+    int64_t usage = 0;
+    for (const std::shared_ptr<ShapeSnapshot> &snapshot : hot_snapshots) {
+        //Only this list points to it, it is dropped on the next update
+        if (snapshot.use_count() > 1) {
+            usage += snapshot->memory_cost;
+        }
+    }
+    return usage;
+}
+
+void OCCManager::set_undo_hot_state_count(int count) {
+    if (count < 0) {
+        ERR_PRINT("Undo hot state count can't be negative");
+        return;
+    }
+    undo_hot_state_count = count;
+    update_hot_snapshots();
+}
+
+int OCCManager::get_undo_hot_state_count() const {
+    return undo_hot_state_count;
+}
+
+int64_t OCCManager::get_undo_file_size() const {
+    return undo_file.get_size();
+}
+
 void OCCManager::print_undo_stack() {
     print_line("=== Undo Stack Debug ===");
-    print_line("Stack size: " + String::num_int64(undo_shapes.size()));
+    print_line("Stack size: " + String::num_int64(undo_states.size()));
+    print_line("Memory used: " + String::humanize_size(get_undo_memory_usage()) + " (" + String::humanize_size(undo_file.get_size()) + " in the undo file)");
     print_line("Current position: " + String::num_int64(position_in_stack));
-    
-    // Print each state in the stack with indicators
-    for (int i = 0; i < undo_state_names.size(); i++) {
+
+    // Print the states around the current one with indicators, the whole stack gets long in long sessions
+    const int first = MAX(0, position_in_stack - UNDO_PRINT_RADIUS);
+    const int last = MIN((int)undo_state_names.size() - 1, position_in_stack + UNDO_PRINT_RADIUS);
+    if (first > 0) {
+        print_line("... " + String::num_int64(first) + " older states");
+    }
+    for (int i = first; i <= last; i++) {
         String line = "State " + String::num_int64(i) + ": " + undo_state_names[i];
 
         if (i == position_in_stack) {
@@ -100,6 +329,9 @@ void OCCManager::print_undo_stack() {
         
         print_line(line);
     }
+    if (last < (int)undo_state_names.size() - 1) {
+        print_line("... " + String::num_int64(undo_state_names.size() - 1 - last) + " newer states");
+    }
     print_line("========================");
 }
 
@@ -126,6 +358,28 @@ void OCCManager::delete_shape(int shape_index){
     shapes.erase(shapes.begin() + shape_index);
     shape_vertices.erase(shape_vertices.begin() + shape_index);
     shape_edges.erase(shape_edges.begin() + shape_index);
+    shape_snapshots.erase(shape_snapshots.begin() + shape_index);
+    topology_indices.erase(topology_indices.begin() + shape_index);
+    shape_change_logs.erase(shape_change_logs.begin() + shape_index);
+    if (shape_index < (int)picking_indices.size()) {
+        picking_indices.erase(picking_indices.begin() + shape_index);
+    }
+    if (shape_index < (int)assemblies.size()) {
+        assemblies.erase(assemblies.begin() + shape_index);
+    }
+    if (shape_index < (int)shape_lods.size()) {
+        shape_lods.erase(shape_lods.begin() + shape_index);
+    }
+    if (shape_index < (int)shape_occluders.size()) {
+        shape_occluders.erase(shape_occluders.begin() + shape_index);
+    }
+    // An open batch on the deleted shape is dropped, one on a later shape follows it down
+    if (shape_index == batch_shape_index) {
+        batch_shape_index = -1;
+        batch_sub_shapes.clear();
+    } else if (shape_index < batch_shape_index) {
+        batch_shape_index--;
+    }
 
 }
 
@@ -133,17 +387,29 @@ void OCCManager::delete_shape(int shape_index){
 void OCCManager::store_shape(const TopoDS_Shape &shape,int shape_index){
     if(shape_index < 0){
         shapes.push_back(shape);
+        shape_snapshots.push_back(nullptr);
+        topology_indices.push_back(std::make_unique<TopologyIndex>());
+        shape_change_logs.push_back(ShapeChangeLog());
         store_vertices(-1);
         store_edges(-1);
+        reset_shape_changes(shapes.size() - 1);
     }
     else{
         if(shape_index >= shapes.size()) {
             ERR_PRINT("Shape index out of bounds");
             return;
         }
+        // The shape is replaced, so whatever the batch queued for it no longer applies
+        if (shape_index == batch_shape_index) {
+            batch_shape_index = -1;
+            batch_sub_shapes.clear();
+        }
         shapes[shape_index] = shape;
+        topology_indices[shape_index] = std::make_unique<TopologyIndex>();
         store_vertices(shape_index);
         store_edges(shape_index);
+        mark_shape_modified(shape_index);
+        reset_shape_changes(shape_index);
     }
 
     // //Print the number of shapes/vertices/edges stored
@@ -159,15 +425,64 @@ void OCCManager::store_shape(const TopoDS_Shape &shape,int shape_index){
 }
 
 void OCCManager::store_vertices(int shape_index) {
-    TopoDS_Shape shape; 
+    // Get the last shape if no index is specified
+    const int index = shape_index < 0 ? shapes.size() - 1 : shape_index;
+    const TopoDS_Shape &shape = shapes[index];
+
+    //The welder is kept in the topology index so that later additions can be welded against these vertices
+    PointWelder &welder = topology_indices[index]->vertices;
+    welder.clear();
+    index_vertices(shape, welder);
+    const std::vector<gp_Pnt> &vertices = welder.get_points();
+
+    //Add the vertices to a new shape in shape_vertices
     if(shape_index < 0){
-        shape = shapes[shapes.size() - 1]; // Get the last shape if no index is specified
+        shape_vertices.push_back(vertices);
     }
     else{
-        shape = shapes[shape_index];
+        if(shape_index >= shape_vertices.size() ) {
+            ERR_PRINT("Shape index out of bounds for vertices storage");
+            return;
+        }
+        if(shape_vertices.size() != shapes.size()) {
+            ERR_PRINT("Shape vertices size does not match shapes size");
+            return;
+        }
+        shape_vertices[shape_index] = vertices; // Update existing shape's vertices
+    }
+
+
+}
+
+void OCCManager::store_edges(int shape_index) {
+    // Get the last shape if no index is specified
+    const int index = shape_index < 0 ? shapes.size() - 1 : shape_index;
+    const TopoDS_Shape &shape = shapes[index];
+
+    EdgeDeduplicator &deduplicator = topology_indices[index]->edges;
+    deduplicator.clear();
+    std::vector<TopoDS_Edge> edges;
+    index_edges(shape, deduplicator, edges);
+    print_line("Ready to store the edges into shape_edges");
+
+    if (shape_index < 0) {
+        shape_edges.push_back(edges);
+    } else {
+        if (shape_index >= shape_edges.size()) {
+            ERR_PRINT("Shape index out of bounds for edges storage");
+            return;
+        }
+        if (shape_edges.size() != shapes.size()) {
+            ERR_PRINT("Shape edges size does not match shapes size");
+            return;
+        }
+        shape_edges[shape_index] = edges; // Update existing shape's edges
     }
 
-    std::vector<gp_Pnt> vertices;
+
+}
+
+void OCCManager::index_vertices(const TopoDS_Shape &shape, PointWelder &r_welder) {
     //So that we don't get duplicate vertices
     TopTools_IndexedMapOfShape vertex_map;
     TopExp::MapShapes(shape, TopAbs_VERTEX, vertex_map); // unique vertices only
@@ -175,334 +490,1657 @@ void OCCManager::store_vertices(int shape_index) {
     //This tolerance value is used to avoid the add_edge function from adding vertices.
     //So when we store vertices we wont store duplicates
     //This is probably a band aid fix but it's okay time is tight
-    const double tolerance = 1e-6; 
+    //The welder only compares against the points in neighbouring cells so this stays linear with big imports
+    r_welder.reserve(vertex_map.Extent());
+    for (int i = 1; i <= vertex_map.Extent(); ++i) {
+        TopoDS_Vertex vertex = TopoDS::Vertex(vertex_map.FindKey(i));
+        r_welder.weld(BRep_Tool::Pnt(vertex));
+    }
+}
+
+void OCCManager::index_edges(const TopoDS_Shape &shape, EdgeDeduplicator &r_deduplicator, std::vector<TopoDS_Edge> &r_edges) {
+    // So that we don't get duplicate edges
+    TopTools_IndexedMapOfShape edge_map;
+    TopExp::MapShapes(shape, TopAbs_EDGE, edge_map);   // unique edges only
+
+    //Edges are only compared against edges sharing both endpoints, so this stays linear with big imports
+    r_deduplicator.reserve(edge_map.Extent());
+    for (int i = 1; i <= edge_map.Extent(); ++i) {
+        TopoDS_Edge edge = TopoDS::Edge(edge_map.FindKey(i));
+
+        if (r_deduplicator.add(edge)) {
+            r_edges.push_back(edge);
+        }
+    }
+}
+
+OCCManager::TopologyIndex &OCCManager::get_topology_index(int shape_index) {
+    std::unique_ptr<TopologyIndex> &index = topology_indices[shape_index];
+    if (!index) {
+        //Happens after loading a state, the stored vertices and edges are already unique so we just re-add them
+        index = std::make_unique<TopologyIndex>();
+        index->vertices.reserve(shape_vertices[shape_index].size());
+        for (const gp_Pnt &point : shape_vertices[shape_index]) {
+            index->vertices.weld(point);
+        }
+        index->edges.reserve(shape_edges[shape_index].size());
+        for (const TopoDS_Edge &edge : shape_edges[shape_index]) {
+            index->edges.add(edge);
+        }
+    }
+    return *index;
+}
+
+void OCCManager::append_sub_shape(int shape_index, const TopoDS_Shape &sub_shape) {
+    // In a batch the new IDs are handed out right away, everything else waits for commit_batch
+    if (shape_index == batch_shape_index) {
+        index_sub_shape(shape_index, sub_shape);
+        batch_sub_shapes.push_back(sub_shape);
+        return;
+    }
+
+    ShapeChange change = start_change(shape_index);
+    index_sub_shape(shape_index, sub_shape);
+    finish_change(shape_index, { sub_shape }, change);
+}
+
+OCCManager::ShapeChange OCCManager::start_change(int shape_index) {
+    TopologyIndex &index = get_topology_index(shape_index);
+    if (index.face_count < 0) {
+        index.face_count = count_triangulated_faces(shapes[shape_index]);
+    }
+
+    ShapeChange change;
+    change.first_vertex = shape_vertices[shape_index].size();
+    change.first_edge = shape_edges[shape_index].size();
+    change.first_face = index.face_count;
+    return change;
+}
+
+void OCCManager::index_sub_shape(int shape_index, const TopoDS_Shape &sub_shape) {
+    TopologyIndex &index = get_topology_index(shape_index);
+
+    // Only look at the vertices and edges of the new sub shape
+    // Anything that isn't a duplicate gets the next ID, which is the same ID a full store_shape would've given it
+    TopTools_IndexedMapOfShape vertex_map;
+    TopExp::MapShapes(sub_shape, TopAbs_VERTEX, vertex_map);
+    for (int i = 1; i <= vertex_map.Extent(); ++i) {
+        gp_Pnt point = BRep_Tool::Pnt(TopoDS::Vertex(vertex_map.FindKey(i)));
+        bool added = false;
+        index.vertices.weld(point, &added);
+        if (added) {
+            shape_vertices[shape_index].push_back(point);
+        }
+    }
+
+    TopTools_IndexedMapOfShape edge_map;
+    TopExp::MapShapes(sub_shape, TopAbs_EDGE, edge_map);
+    for (int i = 1; i <= edge_map.Extent(); ++i) {
+        TopoDS_Edge edge = TopoDS::Edge(edge_map.FindKey(i));
+        if (index.edges.add(edge)) {
+            shape_edges[shape_index].push_back(edge);
+        }
+    }
+}
+
+void OCCManager::finish_change(int shape_index, const std::vector<TopoDS_Shape> &sub_shapes, ShapeChange change) {
+    // Add the sub shapes to the existing shape using compound
+    // If the shape is already a compound we copy its children into the new compound instead of nesting it,
+    // otherwise every edit would add one more level of nesting. (We can't add to the existing compound directly since undo states share it)
+    BRep_Builder builder;
+    TopoDS_Compound compound;
+    builder.MakeCompound(compound);
+    if (shapes[shape_index].ShapeType() == TopAbs_COMPOUND) {
+        for (TopoDS_Iterator it(shapes[shape_index]); it.More(); it.Next()) {
+            builder.Add(compound, it.Value());
+        }
+    } else {
+        builder.Add(compound, shapes[shape_index]);
+    }
+
+    TopoDS_Compound new_shapes;
+    builder.MakeCompound(new_shapes);
+    for (const TopoDS_Shape &sub_shape : sub_shapes) {
+        builder.Add(compound, sub_shape);
+        builder.Add(new_shapes, sub_shape);
+    }
+
+    // Only the new sub shapes need meshing (all at once), the rest of the shape already has its triangulation
+    TopologyIndex &index = get_topology_index(shape_index);
+    mesh(new_shapes);
+    std::vector<FaceTriangulation> new_faces;
+    collect_face_triangulations(new_shapes, new_faces);
+    change.faces.reserve(new_faces.size());
+    for (const FaceTriangulation &face : new_faces) {
+        change.faces.push_back(face.face);
+    }
+    index.face_count += new_faces.size();
+
+    shapes[shape_index] = compound;
+    mark_shape_modified(shape_index);
+
+    change.vertex_count = shape_vertices[shape_index].size() - change.first_vertex;
+    change.edge_count = shape_edges[shape_index].size() - change.first_edge;
+    change.face_count = index.face_count - change.first_face;
+    record_shape_change(shape_index, change);
+}
+
+bool OCCManager::begin_batch(int shape_index) {
+    if (batch_shape_index != -1) {
+        ERR_PRINT("A batch is already open, commit it first");
+        return false;
+    }
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return false;
+    }
+    batch_shape_index = shape_index;
+    batch_change = start_change(shape_index);
+    batch_sub_shapes.clear();
+    return true;
+}
+
+void OCCManager::commit_batch(const String &state_name) {
+    if (batch_shape_index == -1) {
+        ERR_PRINT("No batch to commit");
+        return;
+    }
+    const int shape_index = batch_shape_index;
+    batch_shape_index = -1;
+    if (!batch_sub_shapes.empty()) {
+        finish_change(shape_index, batch_sub_shapes, batch_change);
+        batch_sub_shapes.clear();
+    }
+    if (!state_name.is_empty()) {
+        save_state(state_name);
+    }
+}
+
+void OCCManager::discard_batch() {
+    const int shape_index = batch_shape_index;
+    batch_shape_index = -1;
+    batch_sub_shapes.clear();
+    // The points and edges the batch gave IDs to are the ones past its start, the tables go back to what they were before it
+    shape_vertices[shape_index].resize(batch_change.first_vertex);
+    shape_edges[shape_index].resize(batch_change.first_edge);
+    // The welder and deduplicator still know the dropped ones, they're rebuilt from the tables when needed
+    topology_indices[shape_index] = nullptr;
+}
+
+bool OCCManager::is_batch_open() const {
+    return batch_shape_index != -1;
+}
+
+//Look at .h file for the format of the operations
+bool OCCManager::apply_operations(int shape_index, const Array &operations, const String &state_name) {
+    if (!begin_batch(shape_index)) {
+        return false;
+    }
+    for (int i = 0; i < operations.size(); i++) {
+        if (operations[i].get_type() != Variant::DICTIONARY) {
+            ERR_PRINT("Operation " + itos(i) + " isn't a Dictionary");
+            continue;
+        }
+        const Dictionary operation = operations[i];
+        const String type = operation.get("type", String());
+        const Array points = operation.get("points", Array());
+
+        if (type == "point") {
+            const Vector3 position = operation.get("position", Vector3());
+            add_point(shape_index, position.x, position.y, position.z);
+        } else if (type == "edge" && points.size() == 2) {
+            add_edge(shape_index, points[0], points[1]);
+        } else if (type == "arc" && points.size() == 3) {
+            add_arc_circle(shape_index, points[0], points[1], points[2]);
+        } else if (type == "spline") {
+            add_spline(shape_index, points);
+        } else if (type == "surface") {
+            add_surface(shape_index, operation.get("edges", Array()));
+        } else {
+            ERR_PRINT("Invalid operation " + itos(i) + ": " + Variant(operation).stringify());
+        }
+    }
+    commit_batch(state_name);
+    return true;
+}
+
+int OCCManager::count_triangulated_faces(const TopoDS_Shape &shape) {
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(shape, TopAbs_FACE, face_map);
+    int count = 0;
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        TopLoc_Location loc;
+        if (!BRep_Tool::Triangulation(TopoDS::Face(face_map.FindKey(i)), loc).IsNull()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void OCCManager::reset_shape_changes(int shape_index) {
+    ShapeChangeLog &log = shape_change_logs[shape_index];
+    log.generation = next_generation++;
+    log.history_start = log.generation;
+    log.changes.clear();
+}
+
+void OCCManager::record_shape_change(int shape_index, ShapeChange change) {
+    ShapeChangeLog &log = shape_change_logs[shape_index];
+    change.generation = next_generation++;
+    log.generation = change.generation;
+    log.changes.push_back(change);
+    if ((int)log.changes.size() > MAX_TRACKED_CHANGES) {
+        // The generation right after the forgotten change is the oldest we can still catch up from
+        log.history_start = log.changes.front().generation;
+        log.changes.erase(log.changes.begin());
+    }
+}
+
+int64_t OCCManager::get_shape_generation(int shape_index) const {
+    if (shape_index < 0 || shape_index >= (int)shape_change_logs.size()) {
+        ERR_PRINT("Invalid shape index");
+        return 0;
+    }
+    return shape_change_logs[shape_index].generation;
+}
+
+bool OCCManager::get_added_since(int shape_index, uint64_t generation, ShapeChange &r_added) const {
+    const ShapeChangeLog &log = shape_change_logs[shape_index];
+
+    // Find where generation is in this shape's history
+    // A generation that isn't part of it (too old, or from before the shape was replaced/moved to this index) can't be caught up with additions
+    int first_change = -1;
+    if (generation == log.history_start) {
+        first_change = 0;
+    } else {
+        for (int i = 0; i < (int)log.changes.size(); i++) {
+            if (log.changes[i].generation == generation) {
+                first_change = i + 1;
+                break;
+            }
+        }
+    }
+    if (first_change == -1) {
+        return false;
+    }
+
+    // Every change appends after the previous one, so together they're a single range per element type
+    r_added = ShapeChange();
+    r_added.generation = log.generation;
+    r_added.first_vertex = shape_vertices[shape_index].size();
+    r_added.first_edge = shape_edges[shape_index].size();
+    r_added.first_face = topology_indices[shape_index] ? topology_indices[shape_index]->face_count : 0;
+    for (int i = first_change; i < (int)log.changes.size(); i++) {
+        const ShapeChange &change = log.changes[i];
+        if (i == first_change) {
+            r_added.first_vertex = change.first_vertex;
+            r_added.first_edge = change.first_edge;
+            r_added.first_face = change.first_face;
+        }
+        r_added.vertex_count += change.vertex_count;
+        r_added.edge_count += change.edge_count;
+        r_added.face_count += change.face_count;
+        r_added.faces.insert(r_added.faces.end(), change.faces.begin(), change.faces.end());
+    }
+    return true;
+}
+
+//Look at .h file for the format of the returned dictionary
+Dictionary OCCManager::get_changes_since(int shape_index, int64_t generation) const {
+    Dictionary result;
+    if (shape_index < 0 || shape_index >= (int)shape_change_logs.size()) {
+        ERR_PRINT("Invalid shape index");
+        return result;
+    }
+    result["generation"] = (int64_t)shape_change_logs[shape_index].generation;
+
+    ShapeChange added;
+    bool full = !get_added_since(shape_index, generation, added);
+
+    PackedInt32Array vertices;
+    PackedInt32Array edges;
+    PackedInt32Array faces;
+    result["full"] = full;
+    if (!full) {
+        for (int id = added.first_vertex; id < added.first_vertex + added.vertex_count; id++) {
+            vertices.push_back(id);
+        }
+        for (int id = added.first_edge; id < added.first_edge + added.edge_count; id++) {
+            edges.push_back(id);
+        }
+        for (int id = added.first_face; id < added.first_face + added.face_count; id++) {
+            faces.push_back(id);
+        }
+    }
+    result["vertices"] = vertices;
+    result["edges"] = edges;
+    result["faces"] = faces;
+    return result;
+}
+
+ShapePickingIndex &OCCManager::get_picking_index(int shape_index) {
+    if ((int)picking_indices.size() < (int)shapes.size()) {
+        picking_indices.resize(shapes.size());
+    }
+    std::unique_ptr<ShapePickingIndex> &index = picking_indices[shape_index];
+    if (!index) {
+        index = std::make_unique<ShapePickingIndex>();
+    }
+    const uint64_t generation = shape_change_logs[shape_index].generation;
+    if (index->generation == generation) {
+        return *index;
+    }
+
+    // Only the elements added since the index was last updated are inserted, unless the shape was replaced
+    ShapeChange added;
+    const bool rebuild = index->generation == 0 || !get_added_since(shape_index, index->generation, added);
+    if (rebuild) {
+        index->clear();
+        added.first_vertex = 0;
+        added.vertex_count = shape_vertices[shape_index].size();
+        added.first_edge = 0;
+        added.edge_count = shape_edges[shape_index].size();
+    }
+
+    const std::vector<gp_Pnt> &vertices = shape_vertices[shape_index];
+    for (int id = added.first_vertex; id < added.first_vertex + added.vertex_count; id++) {
+        index->add_point(id, Vector3(vertices[id].X(), vertices[id].Y(), vertices[id].Z()));
+    }
+
+    std::vector<Vector3> polyline;
+    for (int id = added.first_edge; id < added.first_edge + added.edge_count; id++) {
+        polyline.clear();
+        if (sample_edge(shape_edges[shape_index][id], polyline)) {
+            index->add_edge(id, polyline.data(), polyline.size());
+        }
+    }
+
+    if (rebuild || added.face_count > 0) {
+        // When catching up only the appended faces are resolved, the full shape is only walked when rebuilding
+        std::vector<FaceTriangulation> faces;
+        int first_face = 0;
+        if (rebuild) {
+            collect_face_triangulations(shape_index, faces);
+        } else {
+            first_face = added.first_face;
+            faces.reserve(added.faces.size());
+            for (const TopoDS_Face &added_face : added.faces) {
+                FaceTriangulation face;
+                if (make_face_triangulation(added_face, face)) {
+                    faces.push_back(face);
+                }
+            }
+        }
+        for (int i = 0; i < (int)faces.size(); i++) {
+            const int face_id = first_face + i;
+            const FaceTriangulation &face = faces[i];
+            for (int t = 1; t <= face.triangulation->NbTriangles(); ++t) {
+                int n1, n2, n3;
+                face.triangulation->Triangle(t).Get(n1, n2, n3);
+                gp_Pnt p1 = face.triangulation->Node(n1).Transformed(face.transform);
+                gp_Pnt p2 = face.triangulation->Node(n2).Transformed(face.transform);
+                gp_Pnt p3 = face.triangulation->Node(n3).Transformed(face.transform);
+                index->add_face_triangle(face_id, Vector3(p1.X(), p1.Y(), p1.Z()), Vector3(p2.X(), p2.Y(), p2.Z()), Vector3(p3.X(), p3.Y(), p3.Z()));
+            }
+        }
+    }
+
+    index->generation = generation;
+    return *index;
+}
+
+//Look at .h file for the format of the returned dictionary
+Dictionary OCCManager::pick_nearest(const Vector3 &ray_origin, const Vector3 &ray_dir, double tolerance, ElementType element_type) {
+    Dictionary result;
+    result["shape_index"] = -1;
+    result["element_id"] = -1;
+    if (ray_dir.is_zero_approx()) {
+        ERR_PRINT("Ray direction can't be zero");
+        return result;
+    }
+    const Vector3 dir = ray_dir.normalized();
+
+    ShapePickingIndex::Hit best;
+    int best_shape = -1;
+    for (int i = 0; i < (int)shapes.size(); i++) {
+        ShapePickingIndex &index = get_picking_index(i);
+        ShapePickingIndex::Hit hit;
+        switch (element_type) {
+            case ELEMENT_POINT:
+                hit = index.pick_point(ray_origin, dir, tolerance);
+                break;
+            case ELEMENT_EDGE:
+                hit = index.pick_edge(ray_origin, dir, tolerance);
+                break;
+            case ELEMENT_FACE:
+                hit = index.pick_face(ray_origin, dir);
+                break;
+            default:
+                ERR_PRINT("Invalid element type");
+                return result;
+        }
+        if (hit.element_id == -1) {
+            continue;
+        }
+        // Same rule as inside a shape: closest to the ray first, then closest to the origin
+        if (best_shape == -1 || hit.distance < best.distance || (hit.distance == best.distance && hit.depth < best.depth)) {
+            best = hit;
+            best_shape = i;
+        }
+    }
+
+    if (best_shape != -1) {
+        result["shape_index"] = best_shape;
+        result["element_id"] = best.element_id;
+        result["distance"] = best.distance;
+        result["depth"] = best.depth;
+        result["position"] = best.position;
+    }
+    return result;
+}
+
+Array OCCManager::select_in_volume(const TypedArray<Plane> &planes, ElementType element_type) {
+    Array result;
+    Vector<Plane> volume_planes;
+    for (int i = 0; i < planes.size(); i++) {
+        volume_planes.push_back(planes[i]);
+    }
+    // convex_query also wants the corners of the volume
+    Vector<Vector3> hull_points = Geometry3D::compute_convex_mesh_points(volume_planes.ptr(), volume_planes.size());
+    if (hull_points.is_empty()) {
+        ERR_PRINT("The planes don't enclose a volume");
+        return result;
+    }
+
+    std::vector<int> ids;
+    for (int i = 0; i < (int)shapes.size(); i++) {
+        ShapePickingIndex &index = get_picking_index(i);
+        ids.clear();
+        switch (element_type) {
+            case ELEMENT_POINT:
+                index.select_points(volume_planes.ptr(), volume_planes.size(), hull_points.ptr(), hull_points.size(), ids);
+                break;
+            case ELEMENT_EDGE:
+                index.select_edges(volume_planes.ptr(), volume_planes.size(), hull_points.ptr(), hull_points.size(), ids);
+                break;
+            case ELEMENT_FACE:
+                index.select_faces(volume_planes.ptr(), volume_planes.size(), hull_points.ptr(), hull_points.size(), ids);
+                break;
+            default:
+                ERR_PRINT("Invalid element type");
+                return Array();
+        }
+
+        PackedInt32Array shape_ids;
+        shape_ids.resize(ids.size());
+        for (int j = 0; j < (int)ids.size(); j++) {
+            shape_ids.set(j, ids[j]);
+        }
+        result.push_back(shape_ids);
+    }
+    return result;
+}
+
+//Forwards OCC's progress through an import phase, and tells OCC to stop when the import is cancelled
+class ImportProgressIndicator : public Message_ProgressIndicator {
+    std::function<void(double)> report;
+    const std::atomic<bool> *cancelled;
+    double last_reported = 0;
+
+public:
+    ImportProgressIndicator(const std::function<void(double)> &p_report, const std::atomic<bool> *p_cancelled) :
+            report(p_report), cancelled(p_cancelled) {}
+
+    void Show(const Message_ProgressScope &, const Standard_Boolean p_force) override {
+        // OCC calls this very often, only every percent is reported
+        double position = GetPosition();
+        if (p_force || position - last_reported >= 0.01) {
+            last_reported = position;
+            report(position);
+        }
+    }
+
+    Standard_Boolean UserBreak() override {
+        return cancelled->load();
+    }
+};
+
+void OCCManager::import_step(const String &p_path) {
+    ImportTask task;
+    task.path = p_path;
+    task.linear_deflection = linear_deflection;
+    task.angular_deflection = angular_deflection;
+    task.use_cache = import_cache_enabled;
+    run_import(&task);
+    finish_import(task);
+}
+
+int64_t OCCManager::import_step_async(const String &p_path) {
+    std::unique_ptr<ImportTask> task = std::make_unique<ImportTask>();
+    task->id = next_import_id++;
+    task->path = p_path;
+    task->linear_deflection = linear_deflection;
+    task->angular_deflection = angular_deflection;
+    task->asynchronous = true;
+    task->use_cache = import_cache_enabled;
+
+    ImportTask *task_ptr = task.get();
+    import_tasks[task->id] = std::move(task);
+    task_ptr->pool_task = WorkerThreadPool::get_singleton()->add_template_task(this, &OCCManager::run_import, task_ptr, false, "Import STEP " + p_path.get_file());
+    return task_ptr->id;
+}
+
+bool OCCManager::cancel_import(int64_t task_id) {
+    auto task = import_tasks.find(task_id);
+    if (task == import_tasks.end()) {
+        return false;
+    }
+    // The worker notices between phases, and OCC notices through the progress indicator during them
+    task->second->cancelled = true;
+    return true;
+}
+
+void OCCManager::report_import_progress(ImportTask *task, const String &phase, double progress) {
+    if (!task->asynchronous) {
+        return;
+    }
+    callable_mp(this, &OCCManager::_emit_import_progress).call_deferred(task->id, phase, progress);
+}
+
+void OCCManager::_emit_import_progress(int64_t task_id, const String &phase, double progress) {
+    emit_signal(SNAME("import_progress"), task_id, phase, progress);
+}
+
+void OCCManager::run_import(ImportTask *task) {
+    if (task->asynchronous) {
+        // Whatever happens, the main thread gets to finish the import once this returns
+        struct FinishOnExit {
+            OCCManager *manager;
+            int64_t task_id;
+            ~FinishOnExit() {
+                callable_mp(manager, &OCCManager::_finish_async_import).call_deferred(task_id);
+            }
+        } finish_on_exit{ this, task->id };
+        run_import_phases(task);
+    } else {
+        run_import_phases(task);
+    }
+}
+
+void OCCManager::run_import_phases(ImportTask *task) {
+    try {
+        // The cache holds the result of every phase, the topology index is rebuilt from the tables when it's first needed
+        if (task->use_cache) {
+            report_import_progress(task, "cache", 0);
+            if (ShapeCache::load(task->path, task->linear_deflection, task->angular_deflection, task->shape, task->vertices, task->edges)) {
+                report_import_progress(task, "cache", 1);
+                task->succeeded = true;
+                return;
+            }
+        }
+
+        //print_line("Importing STEP file");
+        STEPControl_Reader reader;
+        std::string native_path = task->path.utf8().get_data();
+
+        report_import_progress(task, "parse", 0);
+        if (reader.ReadFile(native_path.c_str()) != IFSelect_RetDone) {
+            ERR_PRINT("Failed to read STEP file: " + task->path);
+            return;
+        }
+        report_import_progress(task, "parse", 1);
+        if (task->cancelled) {
+            return;
+        }
+
+        //print_line("STEP file read successfully, transferring entities...");
+
+        // Get number of roots for diagnostics
+        Standard_Integer nb_roots = reader.NbRootsForTransfer();
+        //print_line("Number of root entities found: " + String::num_int64(nb_roots));
+
+        if (nb_roots == 0) {
+            ERR_PRINT("No transferable root entities found in STEP file");
+            return;
+        }
+
+        report_import_progress(task, "transfer", 0);
+        Handle(ImportProgressIndicator) transfer_progress = new ImportProgressIndicator(
+                [this, task](double progress) { report_import_progress(task, "transfer", progress); }, &task->cancelled);
+
+        // Try to transfer roots with more detailed error reporting
+        Standard_Integer transfer_result = reader.TransferRoots(transfer_progress->Start());
+        if (task->cancelled) {
+            return;
+        }
+
+        if (transfer_result == 0) {
+            //print_line("Transfer failed, attempting alternative method...");
+
+            // Try alternative transfer method for problematic files
+            Standard_Integer nb_transferred = 0;
+
+            for (Standard_Integer i = 1; i <= nb_roots && !task->cancelled; ++i) {
+                if (reader.TransferOne(i)) {
+                    nb_transferred++;
+                }
+            }
+            if (task->cancelled) {
+                return;
+            }
+
+            if (nb_transferred == 0) {
+                ERR_PRINT("Failed to transfer any entities from STEP file");
+                return;
+            }
+
+            //print_line("Successfully transferred " + String::num_int64(nb_transferred) + " out of " + String::num_int64(nb_roots) + " entities");
+        } else {
+            //print_line("Successfully transferred " + String::num_int64(transfer_result) + " entities");
+        }
+
+        //print_line("Getting combined shape...");
+        task->shape = reader.OneShape();
+
+        if (task->shape.IsNull()) {
+            ERR_PRINT("Resulting shape is null after transfer");
+            return;
+        }
+        report_import_progress(task, "transfer", 1);
+
+        // Deduplicated vertices and edges, exactly what store_shape would've made
+        report_import_progress(task, "dedup", 0);
+        task->topology_index = std::make_unique<TopologyIndex>();
+        index_vertices(task->shape, task->topology_index->vertices);
+        task->vertices = task->topology_index->vertices.get_points();
+        report_import_progress(task, "dedup", 0.5);
+        if (task->cancelled) {
+            return;
+        }
+        index_edges(task->shape, task->topology_index->edges, task->edges);
+        report_import_progress(task, "dedup", 1);
+        if (task->cancelled) {
+            return;
+        }
+
+        report_import_progress(task, "mesh", 0);
+        Handle(ImportProgressIndicator) mesh_progress = new ImportProgressIndicator(
+                [this, task](double progress) { report_import_progress(task, "mesh", progress); }, &task->cancelled);
+        mesh_faces(task->shape, task->linear_deflection, task->angular_deflection, mesh_progress->Start());
+        if (task->cancelled) {
+            return;
+        }
+        report_import_progress(task, "mesh", 1);
+
+        if (task->use_cache && !ShapeCache::save(task->path, task->linear_deflection, task->angular_deflection, task->shape, task->vertices, task->edges)) {
+            WARN_PRINT("Couldn't write the import cache of " + task->path);
+        }
+
+        task->succeeded = true;
+    } catch (const Standard_Failure &e) {
+        ERR_PRINT("OCC failed to import " + task->path + ": " + String(e.GetMessageString()));
+    }
+}
+
+int OCCManager::finish_import(ImportTask &task) {
+    if (!task.succeeded || task.cancelled) {
+        return -1;
+    }
+
+    print_line("Shape obtained successfully, now storing shape...");
+    // The visualization shape has to stay last, so the import goes right before it
+    const int index = visualization_active ? shapes.size() - 1 : shapes.size();
+    shapes.insert(shapes.begin() + index, task.shape);
+    shape_vertices.insert(shape_vertices.begin() + index, std::move(task.vertices));
+    shape_edges.insert(shape_edges.begin() + index, std::move(task.edges));
+    shape_snapshots.insert(shape_snapshots.begin() + index, nullptr);
+    topology_indices.insert(topology_indices.begin() + index, std::move(task.topology_index));
+    shape_change_logs.insert(shape_change_logs.begin() + index, ShapeChangeLog());
+    if (index < (int)picking_indices.size()) {
+        picking_indices.insert(picking_indices.begin() + index, nullptr);
+    }
+    if (index < (int)assemblies.size()) {
+        assemblies.insert(assemblies.begin() + index, nullptr);
+    }
+    if (index < (int)shape_lods.size()) {
+        shape_lods.insert(shape_lods.begin() + index, nullptr);
+    }
+    if (index < (int)shape_occluders.size()) {
+        shape_occluders.insert(shape_occluders.begin() + index, nullptr);
+    }
+    reset_shape_changes(index);
+
+    record_meshed_faces(task.shape, task.linear_deflection, task.angular_deflection);
+    // Only does something if the deflections were changed while the import was running
+    mesh_shape(index);
+    return index;
+}
+
+void OCCManager::set_import_cache_enabled(bool enabled) {
+    import_cache_enabled = enabled;
+}
+
+bool OCCManager::is_import_cache_enabled() const {
+    return import_cache_enabled;
+}
+
+void OCCManager::_finish_async_import(int64_t task_id) {
+    auto it = import_tasks.find(task_id);
+    if (it == import_tasks.end()) {
+        return;
+    }
+    std::unique_ptr<ImportTask> task = std::move(it->second);
+    import_tasks.erase(it);
+
+    // The task queued this call as the last thing it did, so this returns right away
+    WorkerThreadPool::get_singleton()->wait_for_task_completion(task->pool_task);
+    int shape_index = finish_import(*task);
+    emit_signal(SNAME("import_finished"), task_id, shape_index);
+}
+
+void OCCManager::mesh_shape(int shape_index){
+	mesh(shapes[shape_index]);
+}
+
+void OCCManager::mesh(const TopoDS_Shape &shape) {
+    // Gather the faces that weren't meshed with the current deflections yet
+    BRep_Builder builder;
+    TopoDS_Compound to_mesh;
+    builder.MakeCompound(to_mesh);
+    std::vector<TopoDS_Face> new_faces;
+
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(shape, TopAbs_FACE, face_map);
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        const TopoDS_Face &face = TopoDS::Face(face_map.FindKey(i));
+        auto cached = meshed_faces.find(face.TShape().get());
+        if (cached != meshed_faces.end() &&
+                cached->second.linear_deflection == linear_deflection &&
+                cached->second.angular_deflection == angular_deflection) {
+            TopLoc_Location loc;
+            if (!BRep_Tool::Triangulation(face, loc).IsNull()) {
+                continue;
+            }
+        }
+        builder.Add(to_mesh, face);
+        new_faces.push_back(face);
+    }
+
+    if (new_faces.empty()) {
+        return;
+    }
+
+    mesh_faces(to_mesh, linear_deflection, angular_deflection);
+    record_meshed_faces(to_mesh, linear_deflection, angular_deflection);
+}
+
+bool OCCManager::is_meshed_with(const TopoDS_Shape &shape, double p_linear_deflection, double p_angular_deflection) const {
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(shape, TopAbs_FACE, face_map);
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        const TopoDS_Face &face = TopoDS::Face(face_map.FindKey(i));
+        auto cached = meshed_faces.find(face.TShape().get());
+        if (cached == meshed_faces.end() || cached->second.linear_deflection != p_linear_deflection || cached->second.angular_deflection != p_angular_deflection) {
+            return false;
+        }
+        TopLoc_Location loc;
+        if (BRep_Tool::Triangulation(face, loc).IsNull()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void OCCManager::mesh_faces(const TopoDS_Shape &shape, double p_linear_deflection, double p_angular_deflection, const Message_ProgressRange &progress) {
+    IMeshTools_Parameters parameters;
+    parameters.Deflection = p_linear_deflection;
+    parameters.Angle = p_angular_deflection;
+    // OCC meshes the shared edges first then spreads the faces over all cores
+    parameters.InParallel = true;
+    // So that a coarser deflection actually replaces a finer triangulation that's already there
+    parameters.AllowQualityDecrease = true;
+    BRepMesh_IncrementalMesh mesher(shape, parameters, progress);
+}
+
+void OCCManager::record_meshed_faces(const TopoDS_Shape &shape, double p_linear_deflection, double p_angular_deflection) {
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(shape, TopAbs_FACE, face_map);
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        const TopoDS_Face &face = TopoDS::Face(face_map.FindKey(i));
+        meshed_faces[face.TShape().get()] = MeshedFace{ face.TShape(), p_linear_deflection, p_angular_deflection };
+    }
+    if (meshed_faces.size() >= meshed_faces_prune_size) {
+        prune_meshed_faces();
+    }
+}
+
+void OCCManager::prune_meshed_faces() {
+    // Faces whose TShape is only referenced by the cache itself aren't part of any shape or undo state anymore
+    for (auto it = meshed_faces.begin(); it != meshed_faces.end();) {
+        if (it->second.tshape->GetRefCount() <= 1) {
+            it = meshed_faces.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    meshed_faces_prune_size = MAX((size_t)1024, meshed_faces.size() * 2);
+}
+
+void OCCManager::set_linear_deflection(double deflection) {
+    if (deflection <= 0) {
+        ERR_PRINT("Linear deflection must be positive");
+        return;
+    }
+    linear_deflection = deflection;
+    for (int i = 0; i < (int)shapes.size(); i++) {
+        mesh_shape(i);
+        topology_indices[i] = nullptr;
+        reset_shape_changes(i);
+    }
+}
+
+void OCCManager::set_lod_level_count(int count) {
+    if (count < 0) {
+        ERR_PRINT("LOD level count can't be negative");
+        return;
+    }
+    lod_level_count = count;
+    shape_lods.clear();
+}
+
+int OCCManager::get_lod_level_count() const {
+    return lod_level_count;
+}
+
+void OCCManager::set_lod_deflection_factor(double factor) {
+    if (factor <= 1) {
+        ERR_PRINT("LOD deflection factor must be greater than 1");
+        return;
+    }
+    lod_deflection_factor = factor;
+    shape_lods.clear();
+}
+
+double OCCManager::get_lod_deflection_factor() const {
+    return lod_deflection_factor;
+}
+
+void OCCManager::set_occluder_deflection_factor(double factor) {
+    if (factor < 1) {
+        ERR_PRINT("Occluder deflection factor can't be less than 1");
+        return;
+    }
+    occluder_deflection_factor = factor;
+    // The occluders are kept (they're in use), they get rebuilt the next time they're asked for
+    for (std::unique_ptr<ShapeOccluder> &occluder : shape_occluders) {
+        if (occluder) {
+            occluder->generation = 0;
+        }
+    }
+}
+
+double OCCManager::get_occluder_deflection_factor() const {
+    return occluder_deflection_factor;
+}
+
+void OCCManager::set_occluder_simplify_ratio(double ratio) {
+    if (ratio <= 0 || ratio > 1) {
+        ERR_PRINT("Occluder simplify ratio must be in (0, 1]");
+        return;
+    }
+    occluder_simplify_ratio = ratio;
+    for (std::unique_ptr<ShapeOccluder> &occluder : shape_occluders) {
+        if (occluder) {
+            occluder->generation = 0;
+        }
+    }
+}
+
+double OCCManager::get_occluder_simplify_ratio() const {
+    return occluder_simplify_ratio;
+}
+
+double OCCManager::get_linear_deflection() const {
+    return linear_deflection;
+}
+
+void OCCManager::set_angular_deflection(double deflection) {
+    if (deflection <= 0) {
+        ERR_PRINT("Angular deflection must be positive");
+        return;
+    }
+    angular_deflection = deflection;
+    for (int i = 0; i < (int)shapes.size(); i++) {
+        mesh_shape(i);
+        topology_indices[i] = nullptr;
+        reset_shape_changes(i);
+    }
+}
+
+double OCCManager::get_angular_deflection() const {
+    return angular_deflection;
+}
+
+
+
+//Gets vertices for the visual mesh
+PackedVector3Array OCCManager::get_visual_vertices(int shape_index) const {
+    PackedVector3Array vertices;
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return vertices;
+    }
+    std::vector<FaceTriangulation> faces;
+    collect_face_triangulations(shape_index, faces);
+
+    FaceBufferJob job;
+    prepare_face_buffer_job(job, faces, 0, false);
+    vertices.resize(job.vertex_offsets.back());
+    job.vertices = vertices.ptrw();
+    run_face_buffer_job(job);
+    return vertices;
+}
+
+//Gets indices for the visual mesh
+PackedInt32Array OCCManager::get_visual_indices(int shape_index) const {
+    PackedInt32Array indices;
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return indices;
+    }
+    std::vector<FaceTriangulation> faces;
+    collect_face_triangulations(shape_index, faces);
+
+    FaceBufferJob job;
+    prepare_face_buffer_job(job, faces, 0, false);
+    indices.resize(job.index_offsets.back());
+    job.indices = indices.ptrw();
+    run_face_buffer_job(job);
+    return indices;
+}
+
+//Gets the faces of the shape
+//Look at .h file for the format of the returned array
+Array OCCManager::get_faces(int shape_index) const {
+    PackedVector3Array tris;
+    //its size is tris/3. Each entry represents the ith triangle's face ID.
+    //So first entry is the face ID of the first triangle(3 vertices) etc etc...
+    PackedInt32Array tri_id;
+    Array ret;
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        ret.append(tris);
+        ret.append(tri_id);
+        return ret;
+    }
+    std::vector<FaceTriangulation> faces;
+    collect_face_triangulations(shape_index, faces);
+
+    FaceBufferJob job;
+    prepare_face_buffer_job(job, faces, 0, false);
+    tris.resize(job.index_offsets.back());
+    tri_id.resize(job.index_offsets.back() / 3);
+    job.triangle_vertices = tris.ptrw();
+    job.triangle_face_ids = tri_id.ptrw();
+    run_face_buffer_job(job);
+
+    ret.append(tris);
+    ret.append(tri_id);
+    return ret;
+}
+
+
+void OCCManager::collect_face_triangulations(int shape_index, std::vector<FaceTriangulation> &r_faces) const {
+    collect_face_triangulations(shapes[shape_index], r_faces);
+}
+
+void OCCManager::collect_face_triangulations(const TopoDS_Shape &shape, std::vector<FaceTriangulation> &r_faces) {
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(shape, TopAbs_FACE, face_map);
+    r_faces.reserve(face_map.Extent());
+
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        FaceTriangulation face_triangulation;
+        // Faces that aren't triangulated don't get an ID (same as get_faces)
+        if (make_face_triangulation(TopoDS::Face(face_map.FindKey(i)), face_triangulation)) {
+            r_faces.push_back(face_triangulation);
+        }
+    }
+}
+
+bool OCCManager::make_face_triangulation(const TopoDS_Face &face, FaceTriangulation &r_face_triangulation) {
+    r_face_triangulation.face = face;
+    TopLoc_Location loc;
+    r_face_triangulation.triangulation = BRep_Tool::Triangulation(face, loc);
+    if (r_face_triangulation.triangulation.IsNull()) {
+        return false;
+    }
+    r_face_triangulation.transform = loc.Transformation();
+    r_face_triangulation.reversed = (face.Orientation() == TopAbs_REVERSED);
+    return true;
+}
+
+const OCCManager::ShapeLods *OCCManager::get_shape_lods(int shape_index) {
+    if (lod_level_count <= 0) {
+        return nullptr;
+    }
+    if ((int)shape_lods.size() < (int)shapes.size()) {
+        shape_lods.resize(shapes.size());
+    }
+    std::unique_ptr<ShapeLods> &lods = shape_lods[shape_index];
+    if (!lods) {
+        lods = std::make_unique<ShapeLods>();
+    }
+    // Generations are unique across shapes, so this also catches a shape that moved to another index
+    const uint64_t generation = shape_change_logs[shape_index].generation;
+    if (lods->generation == generation) {
+        return lods.get();
+    }
+
+    std::vector<double> level_linear_deflections;
+    std::vector<double> level_angular_deflections;
+    double level_linear_deflection = linear_deflection;
+    double level_angular_deflection = angular_deflection;
+    for (int level = 1; level <= lod_level_count; level++) {
+        level_linear_deflection *= lod_deflection_factor;
+        level_angular_deflection = MIN(level_angular_deflection * lod_deflection_factor, MAX_LOD_ANGULAR_DEFLECTION);
+        level_linear_deflections.push_back(level_linear_deflection);
+        level_angular_deflections.push_back(level_angular_deflection);
+    }
+    if (level_linear_deflections != lod_face_linear_deflections || level_angular_deflections != lod_face_angular_deflections) {
+        lod_faces.clear();
+        lod_face_linear_deflections = level_linear_deflections;
+        lod_face_angular_deflections = level_angular_deflections;
+    }
+
+    std::vector<FaceTriangulation> faces;
+    collect_face_triangulations(shape_index, faces);
+    mesh_lod_faces(faces);
+
+    // The levels use the shape's faces (and so their placements) with the coarse triangulations swapped in
+    lods->levels.clear();
+    lods->levels.resize(lod_level_count);
+    for (int level = 0; level < lod_level_count; level++) {
+        std::vector<FaceTriangulation> &level_faces = lods->levels[level];
+        level_faces.reserve(faces.size());
+        for (const FaceTriangulation &face : faces) {
+            FaceTriangulation level_face = face;
+            auto found = lod_faces.find(face.face.TShape().get());
+            if (found != lod_faces.end() && !found->second.levels[level].IsNull()) {
+                level_face.triangulation = found->second.levels[level];
+            }
+            level_faces.push_back(level_face);
+        }
+    }
+    lods->deflections = level_linear_deflections;
+    lods->generation = generation;
+    return lods.get();
+}
+
+void OCCManager::mesh_lod_faces(const std::vector<FaceTriangulation> &faces) {
+    // The missing faces are meshed together (without their placements, the triangulations are in the faces' own space),
+    // so the ones sharing edges share their discretization and the levels stay watertight
+    BRep_Builder builder;
+    TopoDS_Compound missing;
+    builder.MakeCompound(missing);
+    bool has_missing = false;
+    for (const FaceTriangulation &face : faces) {
+        if (lod_faces.find(face.face.TShape().get()) == lod_faces.end()) {
+            builder.Add(missing, face.face.Located(TopLoc_Location()));
+            has_missing = true;
+        }
+    }
+    if (!has_missing) {
+        return;
+    }
 
-    for (int i = 1; i <= vertex_map.Extent(); ++i) {
-        TopoDS_Vertex vertex = TopoDS::Vertex(vertex_map.FindKey(i));
-        gp_Pnt point = BRep_Tool::Pnt(vertex);
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(missing, TopAbs_FACE, face_map);
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        LodFace &lod_face = lod_faces[face_map.FindKey(i).TShape().get()];
+        lod_face.tshape = face_map.FindKey(i).TShape();
+        lod_face.levels.resize(lod_face_linear_deflections.size());
+    }
 
-        // Check if this point is too close to an existing one
-        bool is_duplicate = false;
-        for (const auto& existing_point : vertices) {
-            if (point.Distance(existing_point) < tolerance) {
-                is_duplicate = true;
-                break;
-            }
+    for (int level = 0; level < (int)lod_face_linear_deflections.size(); level++) {
+        // A copy has its own faces (and so its own triangulations) while sharing the curves and surfaces of the shape
+        // It has the same structure, so its faces come out of MapShapes in the same order
+        TopoDS_Shape level_shape = BRepBuilderAPI_Copy(missing, Standard_False, Standard_False).Shape();
+        mesh_faces(level_shape, lod_face_linear_deflections[level], lod_face_angular_deflections[level]);
+        TopTools_IndexedMapOfShape level_face_map;
+        TopExp::MapShapes(level_shape, TopAbs_FACE, level_face_map);
+        if (level_face_map.Extent() != face_map.Extent()) {
+            ERR_PRINT("LOD shape doesn't match its shape");
+            continue;
         }
-        
-        if (!is_duplicate) {
-            vertices.push_back(point);
+        for (int i = 1; i <= face_map.Extent(); ++i) {
+            TopLoc_Location loc;
+            lod_faces[face_map.FindKey(i).TShape().get()].levels[level] = BRep_Tool::Triangulation(TopoDS::Face(level_face_map.FindKey(i)), loc);
         }
     }
-    //Add the vertices to a new shape in shape_vertices
-    if(shape_index < 0){
-        shape_vertices.push_back(vertices);
+
+    if (lod_faces.size() >= lod_faces_prune_size) {
+        prune_lod_faces();
     }
-    else{
-        if(shape_index >= shape_vertices.size() ) {
-            ERR_PRINT("Shape index out of bounds for vertices storage");
-            return;
-        }
-        if(shape_vertices.size() != shapes.size()) {
-            ERR_PRINT("Shape vertices size does not match shapes size");
-            return;
+}
+
+void OCCManager::prune_lod_faces() {
+    // Faces whose TShape is only referenced by the cache itself aren't part of any shape or undo state anymore
+    for (auto it = lod_faces.begin(); it != lod_faces.end();) {
+        if (it->second.tshape->GetRefCount() <= 1) {
+            it = lod_faces.erase(it);
+        } else {
+            ++it;
         }
-        shape_vertices[shape_index] = vertices; // Update existing shape's vertices
     }
+    lod_faces_prune_size = MAX((size_t)1024, lod_faces.size() * 2);
+}
 
+//The level's vertices go after the ones already in r_arrays, and its triangles (pointing to them) become a LOD
+static void append_lod_arrays(Array &r_arrays, const Array &lod_arrays, double edge_length, Dictionary &r_lods) {
+    PackedVector3Array vertices = r_arrays[Mesh::ARRAY_VERTEX];
+    PackedVector3Array normals = r_arrays[Mesh::ARRAY_NORMAL];
+    PackedFloat32Array face_ids = r_arrays[Mesh::ARRAY_CUSTOM0];
+    const int vertex_offset = vertices.size();
+    vertices.append_array(lod_arrays[Mesh::ARRAY_VERTEX]);
+    normals.append_array(lod_arrays[Mesh::ARRAY_NORMAL]);
+    face_ids.append_array(lod_arrays[Mesh::ARRAY_CUSTOM0]);
+
+    PackedInt32Array indices = lod_arrays[Mesh::ARRAY_INDEX];
+    int32_t *indices_w = indices.ptrw();
+    for (int i = 0; i < indices.size(); i++) {
+        indices_w[i] += vertex_offset;
+    }
 
+    r_arrays[Mesh::ARRAY_VERTEX] = vertices;
+    r_arrays[Mesh::ARRAY_NORMAL] = normals;
+    r_arrays[Mesh::ARRAY_CUSTOM0] = face_ids;
+    r_lods[edge_length] = indices;
 }
 
-void OCCManager::store_edges(int shape_index) {
-    TopoDS_Shape shape;
-    if(shape_index < 0){
-        shape = shapes[shapes.size() - 1]; // Get the last shape if no index is specified
+Ref<ArrayOccluder3D> OCCManager::get_shape_occluder(int shape_index) {
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return Ref<ArrayOccluder3D>();
     }
-    else{
-        shape = shapes[shape_index];
+    if ((int)shape_occluders.size() < (int)shapes.size()) {
+        shape_occluders.resize(shapes.size());
+    }
+    std::unique_ptr<ShapeOccluder> &shape_occluder = shape_occluders[shape_index];
+    if (!shape_occluder) {
+        shape_occluder = std::make_unique<ShapeOccluder>();
+        shape_occluder->occluder.instantiate();
+    }
+    const uint64_t generation = shape_change_logs[shape_index].generation;
+    if (shape_occluder->generation == generation) {
+        return shape_occluder->occluder;
     }
 
-    // So that we don't get duplicate edges
-    TopTools_IndexedMapOfShape edge_map;
-    TopExp::MapShapes(shape, TopAbs_EDGE, edge_map);   // unique edges only
+    PackedVector3Array vertices;
+    PackedInt32Array indices;
+    build_occluder_arrays(shapes[shape_index], vertices, indices);
+    // Goes to RenderingServer::occluder_set_mesh, which marks every instance of the occluder for update
+    shape_occluder->occluder->set_arrays(vertices, indices);
+    shape_occluder->generation = generation;
+    return shape_occluder->occluder;
+}
 
-    const double tolerance = 1e-6; 
+void OCCManager::build_occluder_arrays(const TopoDS_Shape &shape, PackedVector3Array &r_vertices, PackedInt32Array &r_indices) {
+    const double occluder_linear_deflection = linear_deflection * occluder_deflection_factor;
+    const double occluder_angular_deflection = MIN(angular_deflection * occluder_deflection_factor, MAX_LOD_ANGULAR_DEFLECTION);
+    if (shell_meshes_linear_deflection != linear_deflection || shell_meshes_angular_deflection != angular_deflection ||
+            shell_meshes_deflection_factor != occluder_deflection_factor || shell_meshes_simplify_ratio != occluder_simplify_ratio) {
+        shell_meshes.clear();
+        shell_meshes_linear_deflection = linear_deflection;
+        shell_meshes_angular_deflection = angular_deflection;
+        shell_meshes_deflection_factor = occluder_deflection_factor;
+        shell_meshes_simplify_ratio = occluder_simplify_ratio;
+    }
 
-    std::vector<TopoDS_Edge> edges;
-    for (int i = 1; i <= edge_map.Extent(); ++i) {
-        TopoDS_Edge edge = TopoDS::Edge(edge_map.FindKey(i));
-        
-        // Get edge endpoints for comparison
-        TopoDS_Vertex v1, v2;
-        TopExp::Vertices(edge, v1, v2);
-        gp_Pnt p1 = BRep_Tool::Pnt(v1);
-        gp_Pnt p2 = BRep_Tool::Pnt(v2);
-        
-        // Check if this edge is too close to an existing one
-        bool is_duplicate = false;
-        for (const auto& existing_edge : edges) {
-            TopoDS_Vertex ev1, ev2;
-            TopExp::Vertices(existing_edge, ev1, ev2);
-            gp_Pnt ep1 = BRep_Tool::Pnt(ev1);
-            gp_Pnt ep2 = BRep_Tool::Pnt(ev2);
-            
-            // Check if endpoints match (either direction)
-            if ((p1.Distance(ep1) < tolerance && p2.Distance(ep2) < tolerance) ||
-                (p1.Distance(ep2) < tolerance && p2.Distance(ep1) < tolerance)) {
-                
-                // Endpoints match, now check if the curves are geometrically identical
-                Standard_Real first1, last1, first2, last2;
-                Handle(Geom_Curve) curve1 = BRep_Tool::Curve(edge, first1, last1);
-                Handle(Geom_Curve) curve2 = BRep_Tool::Curve(existing_edge, first2, last2);
-                
-                if (!curve1.IsNull() && !curve2.IsNull()) {
-                    // Sample points along both curves to compare their geometry
-                    bool curves_identical = true;
-                    const int num_samples = 4;
-                    
-                    for (int s = 0; s <= num_samples && curves_identical; ++s) {
-                        Standard_Real t1 = first1 + (last1 - first1) * s / num_samples;
-                        Standard_Real t2 = first2 + (last2 - first2) * s / num_samples;
-                        
-                        gp_Pnt pt1 = curve1->Value(t1);
-                        gp_Pnt pt2 = curve2->Value(t2);
-                        
-                        // If the curves are different, sample points will differ
-                        if (pt1.Distance(pt2) > tolerance) {
-                            curves_identical = false;
-                        }
-                    }
-                    
-                    if (curves_identical) {
-                        is_duplicate = true;
-                        break;
-                    }
-                } else {
-                    // If we can't get curves, fall back to endpoint-only comparison
-                    // This handles degenerate cases
-                    is_duplicate = true;
-                    break;
+    for (TopExp_Explorer shell_explorer(shape, TopAbs_SHELL); shell_explorer.More(); shell_explorer.Next()) {
+        const TopoDS_Shape &shell = shell_explorer.Current();
+        if (!BRep_Tool::IsClosed(shell)) {
+            continue;
+        }
+
+        auto found = shell_meshes.find(shell.TShape().get());
+        if (found == shell_meshes.end()) {
+            ShellMesh shell_mesh;
+            shell_mesh.tshape = shell.TShape();
+            // The shape's own triangulation, the occluder falls back to it when the shell isn't convex
+            const TopoDS_Shape local_shell = shell.Located(TopLoc_Location());
+            weld_shell_triangulation(local_shell, shell_mesh.vertices, shell_mesh.indices);
+            if (is_convex_mesh(shell_mesh.vertices, shell_mesh.indices, linear_deflection)) {
+                // A copy has its own faces, so meshing it coarsely leaves the shape's triangulation alone
+                TopoDS_Shape coarse_shell = BRepBuilderAPI_Copy(local_shell, Standard_False, Standard_False).Shape();
+                mesh_faces(coarse_shell, occluder_linear_deflection, occluder_angular_deflection);
+                PackedVector3Array coarse_vertices;
+                PackedInt32Array coarse_indices;
+                weld_shell_triangulation(coarse_shell, coarse_vertices, coarse_indices);
+                // A coarse mesh that didn't come out closed keeps the fine one
+                if (is_convex_mesh(coarse_vertices, coarse_indices, occluder_linear_deflection)) {
+                    simplify_occluder_arrays(coarse_vertices, coarse_indices, occluder_simplify_ratio);
+                    shell_mesh.vertices = coarse_vertices;
+                    shell_mesh.indices = coarse_indices;
                 }
             }
+            found = shell_meshes.emplace(shell.TShape().get(), std::move(shell_mesh)).first;
         }
-        
-        if (!is_duplicate) {
-            edges.push_back(edge);
+
+        const ShellMesh &shell_mesh = found->second;
+        const Transform3D placement = ShapeAssembly::to_transform(shell.Location().Transformation());
+        const int vertex_offset = r_vertices.size();
+        for (const Vector3 &vertex : shell_mesh.vertices) {
+            r_vertices.push_back(placement.xform(vertex));
+        }
+        for (int index : shell_mesh.indices) {
+            r_indices.push_back(vertex_offset + index);
         }
     }
-    print_line("Ready to store the edges into shape_edges");
 
-    if (shape_index < 0) {
-        shape_edges.push_back(edges);
-    } else {
-        if (shape_index >= shape_edges.size()) {
-            ERR_PRINT("Shape index out of bounds for edges storage");
-            return;
+    if (shell_meshes.size() >= shell_meshes_prune_size) {
+        prune_shell_meshes();
+    }
+}
+
+void OCCManager::prune_shell_meshes() {
+    // Shells whose TShape is only referenced by the cache itself aren't part of any shape or undo state anymore
+    for (auto it = shell_meshes.begin(); it != shell_meshes.end();) {
+        if (it->second.tshape->GetRefCount() <= 1) {
+            it = shell_meshes.erase(it);
+        } else {
+            ++it;
         }
-        if (shape_edges.size() != shapes.size()) {
-            ERR_PRINT("Shape edges size does not match shapes size");
-            return;
+    }
+    shell_meshes_prune_size = MAX((size_t)1024, shell_meshes.size() * 2);
+}
+
+void OCCManager::weld_shell_triangulation(const TopoDS_Shape &shell, PackedVector3Array &r_vertices, PackedInt32Array &r_indices) {
+    HashMap<Vector3, int> welded;
+    for (TopExp_Explorer face_explorer(shell, TopAbs_FACE); face_explorer.More(); face_explorer.Next()) {
+        FaceTriangulation face;
+        if (!make_face_triangulation(TopoDS::Face(face_explorer.Current()), face)) {
+            continue;
+        }
+        const int num_nodes = face.triangulation->NbNodes();
+        LocalVector<int> node_ids;
+        node_ids.resize(num_nodes + 1); // OCC indices start at 1
+        for (int n = 1; n <= num_nodes; ++n) {
+            gp_Pnt p = face.triangulation->Node(n).Transformed(face.transform);
+            const Vector3 vertex(p.X(), p.Y(), p.Z());
+            HashMap<Vector3, int>::Iterator existing = welded.find(vertex);
+            if (existing) {
+                node_ids[n] = existing->value;
+            } else {
+                node_ids[n] = r_vertices.size();
+                welded.insert(vertex, node_ids[n]);
+                r_vertices.push_back(vertex);
+            }
+        }
+        for (int t = 1; t <= face.triangulation->NbTriangles(); ++t) {
+            int n1, n2, n3;
+            face.triangulation->Triangle(t).Get(n1, n2, n3);
+            if (face.reversed) {
+                std::swap(n2, n3);
+            }
+            r_indices.push_back(node_ids[n1]);
+            r_indices.push_back(node_ids[n2]);
+            r_indices.push_back(node_ids[n3]);
         }
-        shape_edges[shape_index] = edges; // Update existing shape's edges
     }
+}
 
+bool OCCManager::is_convex_mesh(const PackedVector3Array &vertices, const PackedInt32Array &indices, double tolerance) {
+    // Each directed edge goes to its triangle, the neighbour across it has the same edge the other way around
+    if (indices.is_empty()) {
+        return false;
+    }
+    std::unordered_map<uint64_t, int> edge_triangles;
+    edge_triangles.reserve(indices.size());
+    for (int i = 0; i < indices.size(); i++) {
+        const int next = i % 3 == 2 ? i - 2 : i + 1;
+        // An edge used twice the same way means the weld went wrong, nothing can be said about the shape
+        if (!edge_triangles.emplace(((uint64_t)indices[i] << 32) | (uint32_t)indices[next], i / 3).second) {
+            return false;
+        }
+    }
 
+    for (int i = 0; i < indices.size(); i++) {
+        const int next = i % 3 == 2 ? i - 2 : i + 1;
+        auto neighbour = edge_triangles.find(((uint64_t)indices[next] << 32) | (uint32_t)indices[i]);
+        // A hole in the mesh (a failed weld, or a remesh that isn't watertight), so the shell can't be trusted to be convex
+        if (neighbour == edge_triangles.end()) {
+            return false;
+        }
+        const int triangle = i / 3;
+        const Vector3 normal = (vertices[indices[triangle * 3 + 1]] - vertices[indices[triangle * 3]]).cross(vertices[indices[triangle * 3 + 2]] - vertices[indices[triangle * 3]]);
+        if (normal.is_zero_approx()) {
+            continue;
+        }
+        // The corner of the neighbour that isn't on the edge must not be in front of this triangle
+        for (int corner = neighbour->second * 3; corner < neighbour->second * 3 + 3; corner++) {
+            if (indices[corner] != indices[i] && indices[corner] != indices[next] &&
+                    normal.normalized().dot(vertices[indices[corner]] - vertices[indices[i]]) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
-void OCCManager::import_step(const String &p_path) {
-    //print_line("Importing STEP file");
-	STEPControl_Reader reader;
-	std::string native_path = p_path.utf8().get_data();
-	
-	if (reader.ReadFile(native_path.c_str()) != IFSelect_RetDone) {
-		ERR_PRINT("Failed to read STEP file: " + p_path);
-		return;
-	}
-
-	//print_line("STEP file read successfully, transferring entities...");
-	
-	// Get number of roots for diagnostics
-	Standard_Integer nb_roots = reader.NbRootsForTransfer();
-	//print_line("Number of root entities found: " + String::num_int64(nb_roots));
-	
-	if (nb_roots == 0) {
-		ERR_PRINT("No transferable root entities found in STEP file");
-		return;
-	}
-	
-	// Try to transfer roots with more detailed error reporting
-	Standard_Integer transfer_result = reader.TransferRoots();
-	
-	if (transfer_result == 0) {
-		//print_line("Transfer failed, attempting alternative method...");
-		
-		// Try alternative transfer method for problematic files
-		Standard_Integer nb_transferred = 0;
-		
-		for (Standard_Integer i = 1; i <= nb_roots; ++i) {
-			if (reader.TransferOne(i)) {
-				nb_transferred++;
-			}
-		}
-		
-		if (nb_transferred == 0) {
-			ERR_PRINT("Failed to transfer any entities from STEP file");
-			return;
-		}
-		
-		//print_line("Successfully transferred " + String::num_int64(nb_transferred) + " out of " + String::num_int64(nb_roots) + " entities");
-	} else {
-		//print_line("Successfully transferred " + String::num_int64(transfer_result) + " entities");
-	}
-	
-    //print_line("Getting combined shape...");
-	TopoDS_Shape shape = reader.OneShape();
-	
-	if (shape.IsNull()) {
-		ERR_PRINT("Resulting shape is null after transfer");
-		return;
-	}
+void OCCManager::simplify_occluder_arrays(PackedVector3Array &r_vertices, PackedInt32Array &r_indices, double ratio) {
+    // Set by the meshoptimizer module, which may not be built
+    if (SurfaceTool::simplify_func == nullptr || r_indices.size() < 3) {
+        return;
+    }
 
-    print_line("Shape obtained successfully, now storing shape...");
-    //Save the shape
-	store_shape(shape);
+    const size_t index_count = r_indices.size();
+    const size_t target_index_count = MAX((size_t)3, (size_t)(index_count * ratio) / 3 * 3);
+    // meshoptimizer takes floats, Vector3 is double with precision=double
+    LocalVector<float> positions;
+    positions.resize(r_vertices.size() * 3);
+    for (int i = 0; i < r_vertices.size(); i++) {
+        positions[i * 3 + 0] = r_vertices[i].x;
+        positions[i * 3 + 1] = r_vertices[i].y;
+        positions[i * 3 + 2] = r_vertices[i].z;
+    }
 
-    //print_line("Shape imported successfully, now meshing...");
-    mesh_shape(shapes.size() - 1);
+    LocalVector<unsigned int> simplified;
+    simplified.resize(index_count);
+    float error = 0.0f;
+    const size_t simplified_count = SurfaceTool::simplify_func(simplified.ptr(), (const unsigned int *)r_indices.ptr(), index_count,
+            positions.ptr(), r_vertices.size(), sizeof(float) * 3, target_index_count, OCCLUDER_SIMPLIFY_ERROR, 0, &error);
+
+    // Only the vertices the remaining triangles use are kept
+    LocalVector<int> remap;
+    remap.resize(r_vertices.size());
+    for (int &id : remap) {
+        id = -1;
+    }
+    PackedVector3Array vertices;
+    PackedInt32Array indices;
+    indices.resize(simplified_count);
+    int32_t *indices_w = indices.ptrw();
+    for (size_t i = 0; i < simplified_count; i++) {
+        int &id = remap[simplified[i]];
+        if (id == -1) {
+            id = vertices.size();
+            vertices.push_back(r_vertices[simplified[i]]);
+        }
+        indices_w[i] = id;
+    }
+    r_vertices = vertices;
+    r_indices = indices;
 }
 
-void OCCManager::mesh_shape(int shape_index){
-	BRepMesh_IncrementalMesh(shapes[shape_index], 0.1);
+//Look at .h file for the format of the returned array
+Array OCCManager::get_mesh_arrays(int shape_index) const {
+    Array arrays;
+    arrays.resize(Mesh::ARRAY_MAX);
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return arrays;
+    }
+
+    std::vector<FaceTriangulation> faces;
+    collect_face_triangulations(shape_index, faces);
+    return build_mesh_arrays(faces);
 }
 
+Array OCCManager::build_mesh_arrays(const std::vector<FaceTriangulation> &faces, int first_face) {
+    Array arrays;
+    arrays.resize(Mesh::ARRAY_MAX);
 
+    FaceBufferJob job;
+    prepare_face_buffer_job(job, faces, first_face, true);
 
-//Gets vertices for the visual mesh
-PackedVector3Array OCCManager::get_visual_vertices(int shape_index) const {
-    TopoDS_Shape shape = shapes[shape_index];
     PackedVector3Array vertices;
+    PackedVector3Array normals;
+    PackedFloat32Array face_ids;
+    PackedInt32Array indices;
+    vertices.resize(job.vertex_offsets.back());
+    normals.resize(job.vertex_offsets.back());
+    face_ids.resize(job.vertex_offsets.back());
+    indices.resize(job.index_offsets.back());
+    job.vertices = vertices.ptrw();
+    job.normals = normals.ptrw();
+    job.face_ids = face_ids.ptrw();
+    job.indices = indices.ptrw();
+    run_face_buffer_job(job);
+
+    arrays[Mesh::ARRAY_VERTEX] = vertices;
+    arrays[Mesh::ARRAY_NORMAL] = normals;
+    arrays[Mesh::ARRAY_CUSTOM0] = face_ids;
+    arrays[Mesh::ARRAY_INDEX] = indices;
+    return arrays;
+}
 
-    TopExp_Explorer face_explorer(shape, TopAbs_FACE);
-    while (face_explorer.More()) {
-        TopoDS_Face face = TopoDS::Face(face_explorer.Current());
-        TopLoc_Location loc;
-
-        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
-        if (!triangulation.IsNull()) {
-            const gp_Trsf& trsf = loc.Transformation();
-            int num_nodes = triangulation->NbNodes();
+void OCCManager::prepare_face_buffer_job(FaceBufferJob &r_job, const std::vector<FaceTriangulation> &faces, int first_face, bool with_normals) {
+    r_job.faces = &faces;
+    r_job.first_face = CLAMP(first_face, 0, (int)faces.size());
+    const int face_count = faces.size() - r_job.first_face;
+
+    // First pass: where each face's nodes and triangles start in the buffers
+    r_job.vertex_offsets.resize(face_count + 1);
+    r_job.index_offsets.resize(face_count + 1);
+    r_job.vertex_offsets[0] = 0;
+    r_job.index_offsets[0] = 0;
+    for (int i = 0; i < face_count; ++i) {
+        const Handle(Poly_Triangulation) &triangulation = faces[r_job.first_face + i].triangulation;
+        r_job.vertex_offsets[i + 1] = r_job.vertex_offsets[i] + triangulation->NbNodes();
+        r_job.index_offsets[i + 1] = r_job.index_offsets[i] + triangulation->NbTriangles() * 3;
+    }
 
-            for (int i = 1; i <= num_nodes; ++i) { // OCC indices start at 1
-                gp_Pnt p = triangulation->Node(i).Transformed(trsf);
-                vertices.append(Vector3(p.X(), p.Y(), p.Z()));
-            }
+    if (!with_normals) {
+        return;
+    }
+    // Normals are stored on the triangulation, which faces placed several times share
+    // So each one is computed once, before the faces are filled in parallel
+    std::vector<const FaceTriangulation *> missing_normals;
+    std::unordered_set<const Poly_Triangulation *> seen;
+    for (int i = r_job.first_face; i < (int)faces.size(); ++i) {
+        const FaceTriangulation &face = faces[i];
+        if (!face.triangulation->HasNormals() && seen.insert(face.triangulation.get()).second) {
+            missing_normals.push_back(&face);
         }
-
-        face_explorer.Next();
     }
-
-    return vertices;
+    run_parallel(&OCCManager::compute_face_normals, &missing_normals, missing_normals.size(), "Compute face normals");
 }
 
-//Gets indices for the visual mesh
-PackedInt32Array OCCManager::get_visual_indices(int shape_index) const {
-    TopoDS_Shape shape = shapes[shape_index];
-    PackedInt32Array indices;
-
-    TopExp_Explorer face_explorer(shape, TopAbs_FACE);
-    int vertex_offset = 0;
-
-    while (face_explorer.More()) {
-        TopoDS_Face face = TopoDS::Face(face_explorer.Current());
-        TopLoc_Location loc;
+void OCCManager::run_face_buffer_job(FaceBufferJob &job) {
+    // Second pass: every face writes to its own ranges, so they can all be filled at once
+    run_parallel(&OCCManager::fill_face_buffers, &job, job.vertex_offsets.size() - 1, "Fill face buffers");
+}
 
-        Handle(Poly_Triangulation) triangulation = BRep_Tool::Triangulation(face, loc);
-        if (!triangulation.IsNull()) {
-            int num_nodes = triangulation->NbNodes();
-            int num_tris = triangulation->NbTriangles();
+void OCCManager::run_parallel(void (*func)(void *, uint32_t), void *userdata, int elements, const String &description) {
+    // Not worth waking up the pool for a handful of faces
+    if (elements < MIN_PARALLEL_FACES) {
+        for (int i = 0; i < elements; ++i) {
+            func(userdata, i);
+        }
+        return;
+    }
+    WorkerThreadPool::GroupID group = WorkerThreadPool::get_singleton()->add_native_group_task(func, userdata, elements, -1, true, description);
+    WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group);
+}
 
-            // Check face orientation
-            bool reverse_orientation = (face.Orientation() == TopAbs_REVERSED);
+void OCCManager::compute_face_normals(void *p_faces, uint32_t p_index) {
+    const FaceTriangulation &face = *(*(std::vector<const FaceTriangulation *> *)p_faces)[p_index];
+    // Normals computed from the surface, so curved faces are shaded smoothly
+    BRepLib_ToolTriangulatedShape::ComputeNormals(face.face, face.triangulation);
+}
 
-            for (int i = 1; i <= num_tris; ++i) {
-                int n1, n2, n3;
-                triangulation->Triangle(i).Get(n1, n2, n3);
-
-                // OCC indices are 1-based, Godot expects 0-based
-                if (reverse_orientation) {
-                    // Reverse winding order for reversed faces
-                    indices.append(vertex_offset + n1 - 1);
-                    indices.append(vertex_offset + n3 - 1);
-                    indices.append(vertex_offset + n2 - 1);
-                } else {
-                    indices.append(vertex_offset + n1 - 1);
-                    indices.append(vertex_offset + n2 - 1);
-                    indices.append(vertex_offset + n3 - 1);
+void OCCManager::fill_face_buffers(void *p_job, uint32_t p_index) {
+    const FaceBufferJob &job = *(const FaceBufferJob *)p_job;
+    const int face_id = job.first_face + p_index;
+    const FaceTriangulation &face = (*job.faces)[face_id];
+    const Handle(Poly_Triangulation) &triangulation = face.triangulation;
+    const int vertex_offset = job.vertex_offsets[p_index];
+    int index_offset = job.index_offsets[p_index];
+
+    if (job.vertices || job.normals || job.face_ids) {
+        const int num_nodes = triangulation->NbNodes();
+        for (int n = 1; n <= num_nodes; ++n) { // OCC indices start at 1
+            if (job.vertices) {
+                gp_Pnt p = triangulation->Node(n).Transformed(face.transform);
+                job.vertices[vertex_offset + n - 1] = Vector3(p.X(), p.Y(), p.Z());
+            }
+            if (job.normals) {
+                gp_Dir normal = triangulation->Normal(n).Transformed(face.transform);
+                if (face.reversed) {
+                    normal.Reverse();
                 }
+                job.normals[vertex_offset + n - 1] = Vector3(normal.X(), normal.Y(), normal.Z());
+            }
+            if (job.face_ids) {
+                job.face_ids[vertex_offset + n - 1] = face_id;
             }
-
-            vertex_offset += num_nodes;
         }
-
-        face_explorer.Next();
     }
 
-    return indices;
+    if (!job.indices && !job.triangle_vertices && !job.triangle_face_ids) {
+        return;
+    }
+    const int num_tris = triangulation->NbTriangles();
+    for (int t = 1; t <= num_tris; ++t) {
+        int n[3];
+        triangulation->Triangle(t).Get(n[0], n[1], n[2]);
+        // Reverse winding order for reversed faces
+        if (face.reversed) {
+            std::swap(n[1], n[2]);
+        }
+        if (job.triangle_face_ids) {
+            job.triangle_face_ids[index_offset / 3] = face_id;
+        }
+        for (int k = 0; k < 3; ++k, ++index_offset) {
+            // OCC indices are 1-based, Godot expects 0-based
+            if (job.indices) {
+                job.indices[index_offset] = vertex_offset + n[k] - 1;
+            }
+            if (job.triangle_vertices) {
+                gp_Pnt p = triangulation->Node(n[k]).Transformed(face.transform);
+                job.triangle_vertices[index_offset] = Vector3(p.X(), p.Y(), p.Z());
+            }
+        }
+    }
 }
 
-//Gets the faces of the shape
-//Look at .h file for the format of the returned array
-Array OCCManager::get_faces(int shape_index) const {
-    PackedVector3Array tris;
-    //its size is tris/3. Each entry represents the ith triangle's face ID.
-    //So first entry is the face ID of the first triangle(3 vertices) etc etc...
-    PackedInt32Array tri_id;
-    const TopoDS_Shape& shape = shapes[shape_index];
+const ShapeAssembly *OCCManager::get_assembly(int shape_index) {
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return nullptr;
+    }
+    if ((int)assemblies.size() < (int)shapes.size()) {
+        assemblies.resize(shapes.size());
+    }
+    std::unique_ptr<ShapeAssembly> &assembly = assemblies[shape_index];
+    if (!assembly) {
+        assembly = std::make_unique<ShapeAssembly>();
+    }
+    // Generations are unique across shapes, so this also catches a shape that moved to another index
+    const uint64_t generation = shape_change_logs[shape_index].generation;
+    if (assembly->generation != generation) {
+        assembly->build(shapes[shape_index]);
+        assembly->generation = generation;
+    }
+    return assembly.get();
+}
 
-    TopTools_IndexedMapOfShape face_map;
-    TopExp::MapShapes(shape, TopAbs_FACE, face_map);
+int OCCManager::get_part_count(int shape_index) {
+    const ShapeAssembly *assembly = get_assembly(shape_index);
+    return assembly ? assembly->parts.size() : 0;
+}
 
-    int currentID = 0; // Used to track the current face ID
-    for (int i = 1; i <= face_map.Extent(); ++i) {
-        TopoDS_Face face = TopoDS::Face(face_map.FindKey(i));
+Array OCCManager::get_part_mesh_arrays(int shape_index, int part_id) {
+    const ShapeAssembly *assembly = get_assembly(shape_index);
+    if (!assembly) {
+        Array arrays;
+        arrays.resize(Mesh::ARRAY_MAX);
+        return arrays;
+    }
+    if (part_id < 0 || part_id >= (int)assembly->parts.size()) {
+        ERR_PRINT("Invalid part ID");
+        Array arrays;
+        arrays.resize(Mesh::ARRAY_MAX);
+        return arrays;
+    }
 
-        TopLoc_Location loc;
-        Handle(Poly_Triangulation) tri = BRep_Tool::Triangulation(face, loc);
-        if (tri.IsNull()) continue;
+    std::vector<FaceTriangulation> faces;
+    collect_face_triangulations(assembly->parts[part_id].shape, faces);
+    return build_mesh_arrays(faces);
+}
 
-        gp_Trsf tr = loc.Transformation();
-        const Poly_Array1OfTriangle& triangles = tri->Triangles();
-        bool reversed = (face.Orientation() == TopAbs_REVERSED);
+//Look at .h file for the format of the returned dictionary
+Dictionary OCCManager::get_part_instances(int shape_index) {
+    Dictionary result;
+    PackedInt32Array parts;
+    Array transforms;
+    PackedInt32Array face_offsets;
+
+    const ShapeAssembly *assembly = get_assembly(shape_index);
+    if (assembly) {
+        parts.resize(assembly->instances.size());
+        transforms.resize(assembly->instances.size());
+        face_offsets.resize(assembly->instances.size());
+        for (int i = 0; i < (int)assembly->instances.size(); i++) {
+            const ShapeAssembly::Instance &instance = assembly->instances[i];
+            parts.set(i, instance.part);
+            transforms[i] = ShapeAssembly::to_transform(instance.location.Transformation());
+            face_offsets.set(i, instance.face_offset);
+        }
+    }
 
-        for (int t = triangles.Lower(); t <= triangles.Upper(); ++t) {
-            Standard_Integer n1, n2, n3;
-            triangles(t).Get(n1, n2, n3);
-            if (reversed) std::swap(n2, n3);
+    result["parts"] = parts;
+    result["transforms"] = transforms;
+    result["face_offsets"] = face_offsets;
+    return result;
+}
 
-            gp_Pnt p1 = tri->Node(n1).Transformed(tr);
-            gp_Pnt p2 = tri->Node(n2).Transformed(tr);
-            gp_Pnt p3 = tri->Node(n3).Transformed(tr);
+PackedFloat32Array OCCManager::get_part_instance_buffer(int shape_index, int part_id) {
+    PackedFloat32Array buffer;
+    const ShapeAssembly *assembly = get_assembly(shape_index);
+    if (!assembly) {
+        return buffer;
+    }
 
-            tris.append(Vector3(p1.X(), p1.Y(), p1.Z()));
-            tris.append(Vector3(p2.X(), p2.Y(), p2.Z()));
-            tris.append(Vector3(p3.X(), p3.Y(), p3.Z()));
+    for (const ShapeAssembly::Instance &instance : assembly->instances) {
+        if (instance.part != part_id) {
+            continue;
+        }
+        // Each row of the basis followed by that row's translation
+        const Transform3D transform = ShapeAssembly::to_transform(instance.location.Transformation());
+        for (int row = 0; row < 3; row++) {
+            buffer.push_back(transform.basis.rows[row].x);
+            buffer.push_back(transform.basis.rows[row].y);
+            buffer.push_back(transform.basis.rows[row].z);
+            buffer.push_back(transform.origin[row]);
+        }
+    }
+    return buffer;
+}
 
-            tri_id.append(currentID);
+//Look at .h file for the format of the returned dictionary
+Dictionary OCCManager::get_assembly_tree(int shape_index) {
+    Dictionary result;
+    PackedInt32Array parents;
+    PackedInt32Array parts;
+    Array transforms;
+
+    const ShapeAssembly *assembly = get_assembly(shape_index);
+    if (assembly) {
+        for (const ShapeAssembly::Node &node : assembly->nodes) {
+            parents.push_back(node.parent);
+            parts.push_back(node.part);
+            transforms.push_back(ShapeAssembly::to_transform(node.location.Transformation()));
         }
-        currentID++;
     }
-    // //Print the number of triangles and faces
-    // print_line("FROM OCCManager::get_faces");
-    // print_line("Number of triangles: " + String::num_int64(tris.size()));
-    // print_line("Number of faces: " + String::num_int64(tri_id.size()));
 
-    Array ret;
-    ret.append(tris);
-    ret.append(tri_id);
-    return ret;
+    result["parents"] = parents;
+    result["parts"] = parts;
+    result["transforms"] = transforms;
+    return result;
 }
 
-
 //Gets occ vertices
 PackedVector3Array OCCManager::get_vertices(int shape_index) const {
     PackedVector3Array vertices;
@@ -516,34 +2154,210 @@ PackedVector3Array OCCManager::get_vertices(int shape_index) const {
 
 
 
-PackedVector3Array OCCManager::get_edges(int shape_index) const {
-    PackedVector3Array edges;
-    
+bool OCCManager::sample_edge(const TopoDS_Edge &edge, std::vector<Vector3> &r_points) const {
+    Standard_Real first, last;
+    if (BRep_Tool::Curve(edge, first, last).IsNull()) {
+        return false;
+    }
 
-    const int divisions = 32;
+    // Uses the same deflections as the face mesher, so straight edges are a single segment
+    // and curved ones get more points where they bend more
+    BRepAdaptor_Curve curve(edge);
+    GCPnts_TangentialDeflection sampler(curve, angular_deflection, linear_deflection);
 
+    const size_t start = r_points.size();
+    for (int i = 1; i <= sampler.NbPoints(); ++i) {
+        gp_Pnt point = sampler.Value(i);
+        r_points.push_back(Vector3(point.X(), point.Y(), point.Z()));
+    }
 
-    for (const TopoDS_Edge& edge : shape_edges[shape_index]) {
-        Standard_Real first, last;
-        Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, first, last);
-        if (curve.IsNull()) continue;
+    // Respect orientation so the polyline goes the same way as the edge
+    if (edge.Orientation() == TopAbs_REVERSED) {
+        std::reverse(r_points.begin() + start, r_points.end());
+    }
+    return true;
+}
+
+PackedVector3Array OCCManager::get_edges(int shape_index) const {
+    PackedVector3Array edges;
+    std::vector<Vector3> polyline;
 
-        // Respect orientation so you don't sample reversed twice later
-        if (edge.Orientation() == TopAbs_REVERSED)
-            std::swap(first, last);
+    for (const TopoDS_Edge& edge : shape_edges[shape_index]) {
+        polyline.clear();
+        if (!sample_edge(edge, polyline)) continue;
 
-        gp_Pnt prev = curve->Value(first);
-        for (int s = 1; s <= divisions; ++s) {
-            Standard_Real t = first + (last - first) * s / divisions;
-            gp_Pnt cur = curve->Value(t);
-            edges.append(Vector3(prev.X(), prev.Y(), prev.Z()));
-            edges.append(Vector3(cur.X(),  cur.Y(),  cur.Z()));
-            prev = cur;
+        for (int s = 1; s < (int)polyline.size(); ++s) {
+            edges.append(polyline[s - 1]);
+            edges.append(polyline[s]);
         }
     }
     return edges;
 }
 
+//Look at .h file for the format of the returned dictionary
+Dictionary OCCManager::get_edge_polylines(int shape_index, int first_edge) const {
+    Dictionary result;
+    if (shape_index < 0 || shape_index >= (int)shape_edges.size()) {
+        ERR_PRINT("Invalid shape index");
+        return result;
+    }
+    const std::vector<TopoDS_Edge> &edges = shape_edges[shape_index];
+    first_edge = CLAMP(first_edge, 0, (int)edges.size());
+
+    // Sample everything first so the buffers can be sized exactly
+    std::vector<Vector3> points;
+    PackedInt32Array offsets;
+    offsets.resize(edges.size() - first_edge + 1);
+    int32_t *offsets_w = offsets.ptrw();
+    int segment_count = 0;
+    for (int id = first_edge; id < (int)edges.size(); ++id) {
+        offsets_w[id - first_edge] = points.size();
+        const size_t start = points.size();
+        sample_edge(edges[id], points);
+        if (points.size() > start) {
+            segment_count += points.size() - start - 1;
+        }
+    }
+    offsets_w[edges.size() - first_edge] = points.size();
+
+    PackedVector3Array vertices;
+    PackedFloat32Array edge_ids;
+    PackedInt32Array indices;
+    vertices.resize(points.size());
+    edge_ids.resize(points.size());
+    indices.resize(segment_count * 2);
+    Vector3 *vertices_w = vertices.ptrw();
+    float *edge_ids_w = edge_ids.ptrw();
+    int32_t *indices_w = indices.ptrw();
+
+    int index_offset = 0;
+    for (int i = 0; i < (int)edges.size() - first_edge; ++i) {
+        const int begin = offsets_w[i];
+        const int end = offsets_w[i + 1];
+        for (int v = begin; v < end; ++v) {
+            vertices_w[v] = points[v];
+            edge_ids_w[v] = first_edge + i;
+            if (v > begin) {
+                indices_w[index_offset++] = v - 1;
+                indices_w[index_offset++] = v;
+            }
+        }
+    }
+
+    Array arrays;
+    arrays.resize(Mesh::ARRAY_MAX);
+    arrays[Mesh::ARRAY_VERTEX] = vertices;
+    arrays[Mesh::ARRAY_CUSTOM0] = edge_ids;
+    arrays[Mesh::ARRAY_INDEX] = indices;
+
+    result["arrays"] = arrays;
+    result["offsets"] = offsets;
+    return result;
+}
+
+Array OCCManager::get_point_arrays(int shape_index, int first_point) const {
+    Array arrays;
+    arrays.resize(Mesh::ARRAY_MAX);
+    const std::vector<gp_Pnt> &vertices = shape_vertices[shape_index];
+    first_point = CLAMP(first_point, 0, (int)vertices.size());
+
+    PackedVector3Array points;
+    PackedFloat32Array point_ids;
+    points.resize(vertices.size() - first_point);
+    point_ids.resize(vertices.size() - first_point);
+    Vector3 *points_w = points.ptrw();
+    float *point_ids_w = point_ids.ptrw();
+    for (int id = first_point; id < (int)vertices.size(); ++id) {
+        points_w[id - first_point] = Vector3(vertices[id].X(), vertices[id].Y(), vertices[id].Z());
+        point_ids_w[id - first_point] = id;
+    }
+
+    arrays[Mesh::ARRAY_VERTEX] = points;
+    arrays[Mesh::ARRAY_CUSTOM0] = point_ids;
+    return arrays;
+}
+
+bool OCCManager::make_surface_data(int shape_index, ElementType element_type, int first_id, RS::SurfaceData &r_surface) {
+    if (shape_index < 0 || shape_index >= (int)shapes.size()) {
+        ERR_PRINT("Invalid shape index");
+        return false;
+    }
+
+    Array arrays;
+    Dictionary lods;
+    RS::PrimitiveType primitive;
+    switch (element_type) {
+        case ELEMENT_POINT:
+            arrays = get_point_arrays(shape_index, first_id);
+            primitive = RS::PRIMITIVE_POINTS;
+            break;
+        case ELEMENT_EDGE:
+            arrays = get_edge_polylines(shape_index, first_id)["arrays"];
+            primitive = RS::PRIMITIVE_LINES;
+            break;
+        case ELEMENT_FACE: {
+            std::vector<FaceTriangulation> faces;
+            collect_face_triangulations(shape_index, faces);
+            arrays = build_mesh_arrays(faces, first_id);
+            primitive = RS::PRIMITIVE_TRIANGLES;
+
+            // Appended faces are a small surface on top of the full one, only the full one gets LODs
+            const ShapeLods *shape_lod = first_id <= 0 ? get_shape_lods(shape_index) : nullptr;
+            if (shape_lod) {
+                for (int level = 0; level < (int)shape_lod->levels.size(); level++) {
+                    append_lod_arrays(arrays, build_mesh_arrays(shape_lod->levels[level]), shape_lod->deflections[level], lods);
+                }
+            }
+        } break;
+        default:
+            ERR_PRINT("Invalid element type");
+            return false;
+    }
+
+    // Nothing to draw, an empty surface would be rejected
+    const PackedVector3Array vertices = arrays[Mesh::ARRAY_VERTEX];
+    const PackedInt32Array indices = arrays[Mesh::ARRAY_INDEX];
+    if (vertices.is_empty() || (primitive != RS::PRIMITIVE_POINTS && indices.is_empty())) {
+        return false;
+    }
+
+    // Packs the arrays into the vertex/attribute/index buffers the renderer uploads as they are
+    const uint64_t format = (uint64_t)RS::ARRAY_CUSTOM_R_FLOAT << RS::ARRAY_FORMAT_CUSTOM0_SHIFT;
+    return RS::get_singleton()->mesh_create_surface_data_from_arrays(&r_surface, primitive, arrays, Array(), lods, format) == OK;
+}
+
+bool OCCManager::add_mesh_surface(const Ref<ArrayMesh> &mesh, int shape_index, ElementType element_type, int first_id) {
+    if (mesh.is_null()) {
+        ERR_PRINT("Mesh is null");
+        return false;
+    }
+    RS::SurfaceData surface;
+    if (!make_surface_data(shape_index, element_type, first_id, surface)) {
+        return false;
+    }
+    // Hands the packed buffers over as they are, so the ArrayMesh still knows about the surface (for its AABB, saving...)
+    mesh->add_surface(surface.format, (Mesh::PrimitiveType)surface.primitive, surface.vertex_data, surface.attribute_data, surface.skin_data,
+            surface.vertex_count, surface.index_data, surface.index_count, surface.aabb, surface.blend_shape_data, surface.bone_aabbs, surface.lods);
+    return true;
+}
+
+bool OCCManager::add_rendering_surface(const RID &mesh, int shape_index, ElementType element_type, int first_id) {
+    RS::SurfaceData surface;
+    if (!make_surface_data(shape_index, element_type, first_id, surface)) {
+        return false;
+    }
+    RS::get_singleton()->mesh_add_surface(mesh, surface);
+    return true;
+}
+
+int OCCManager::get_edge_count(int shape_index) const {
+    if (shape_index < 0 || shape_index >= (int)shape_edges.size()) {
+        ERR_PRINT("Invalid shape index");
+        return 0;
+    }
+    return shape_edges[shape_index].size();
+}
+
 void OCCManager::add_point(int shape_index,double x, double y, double z){
     if (shape_index < 0 || shape_index >= shapes.size()) {
         ERR_PRINT("Invalid shape index");
@@ -554,18 +2368,8 @@ void OCCManager::add_point(int shape_index,double x, double y, double z){
     
     TopoDS_Vertex vertex = BRepBuilderAPI_MakeVertex(point);
 
-    // Add the vertex to the existing shape using BooleanAPI or compound
-    BRep_Builder builder;
-    TopoDS_Compound compound;
-    builder.MakeCompound(compound);
-    builder.Add(compound, shapes[shape_index]);
-    builder.Add(compound, vertex);
-
-    // Re-mesh the modified shape
-    mesh_shape(shape_index);
-
-    //Update the stored value
-    store_shape(compound,shape_index);
+    // Add the vertex to the existing shape
+    append_sub_shape(shape_index, vertex);
 }
 
 //The new shape will be in the last index of shapes
@@ -615,19 +2419,8 @@ void OCCManager::add_edge(int shape_index, int firstPointID, int secondPointID)
     // Create an edge directly between the two points
     TopoDS_Edge edge = BRepBuilderAPI_MakeEdge(point1, point2);
     
-    // Add the edge to the existing shape using compound
-    BRep_Builder builder;
-    TopoDS_Compound compound;
-    builder.MakeCompound(compound);
-    builder.Add(compound, shapes[shape_index]);
-    builder.Add(compound, edge);
-    
-    // Re-mesh the modified shape
-    mesh_shape(shape_index);
-
-    // Update the stored value
-    store_shape(compound, shape_index);
-    // shapes[shape_index] = compound;
+    // Add the edge to the existing shape
+    append_sub_shape(shape_index, edge);
 }
 
 void OCCManager::add_arc_circle(int shape_index, int startPointID, int centerPointID, int endPointID){
@@ -638,17 +2431,8 @@ void OCCManager::add_arc_circle(int shape_index, int startPointID, int centerPoi
     Handle(Geom_TrimmedCurve) arc = GC_MakeArcOfCircle(startPoint, centerPoint, endPoint);
     TopoDS_Edge edge = BRepBuilderAPI_MakeEdge(arc);
 
-    // Add the edge to the existing shape using compound
-    BRep_Builder builder;
-    TopoDS_Compound compound;
-    builder.MakeCompound(compound);
-    builder.Add(compound, shapes[shape_index]);
-    builder.Add(compound, edge);
-
-    // Re-mesh the modified shape
-    mesh_shape(shape_index);
-    // Update the stored value
-    store_shape(compound, shape_index);
+    // Add the edge to the existing shape
+    append_sub_shape(shape_index, edge);
 }
 
 void OCCManager::add_spline(int shape_index, Array pointIDs) {
@@ -698,18 +2482,8 @@ void OCCManager::add_spline(int shape_index, Array pointIDs) {
         // Create edge from the spline curve
         TopoDS_Edge edge = BRepBuilderAPI_MakeEdge(splineCurve);
         
-        // Add the edge to the existing shape using compound
-        BRep_Builder builder;
-        TopoDS_Compound compound;
-        builder.MakeCompound(compound);
-        builder.Add(compound, shapes[shape_index]);
-        builder.Add(compound, edge);
-        
-        // Re-mesh the modified shape
-        mesh_shape(shape_index);
-        
-        // Update the stored value
-        store_shape(compound, shape_index);
+        // Add the edge to the existing shape
+        append_sub_shape(shape_index, edge);
         
     } catch (const Standard_Failure& e) {
         ERR_PRINT("Exception while creating spline curve: " + String(e.GetMessageString()));
@@ -763,18 +2537,8 @@ void OCCManager::add_surface(int shape_index, Array edgeIds){
 
 
 
-    // Add the face to the existing shape using compound
-    BRep_Builder builder;
-    TopoDS_Compound compound;
-    builder.MakeCompound(compound);
-    builder.Add(compound, shapes[shape_index]);
-    builder.Add(compound, face);
-
-    // Re-mesh the modified shape
-    mesh_shape(shape_index);
-
-    // Update the stored value
-    store_shape(compound, shape_index);
+    // Add the face to the existing shape, this also meshes the new face
+    append_sub_shape(shape_index, face);
 }
 
 
@@ -788,8 +2552,42 @@ void OCCManager::_bind_methods() {
 	ClassDB::bind_method(D_METHOD("get_visual_vertices", "shape_index"), &OCCManager::get_visual_vertices);
 	ClassDB::bind_method(D_METHOD("get_visual_indices", "shape_index"), &OCCManager::get_visual_indices);
     ClassDB::bind_method(D_METHOD("get_edges", "shape_index"), &OCCManager::get_edges);
+    ClassDB::bind_method(D_METHOD("get_edge_count", "shape_index"), &OCCManager::get_edge_count);
     ClassDB::bind_method(D_METHOD("get_vertices", "shape_index"), &OCCManager::get_vertices);
     ClassDB::bind_method(D_METHOD("get_faces", "shape_index"), &OCCManager::get_faces);
+    ClassDB::bind_method(D_METHOD("get_mesh_arrays", "shape_index"), &OCCManager::get_mesh_arrays);
+    ClassDB::bind_method(D_METHOD("add_mesh_surface", "mesh", "shape_index", "element_type", "first_id"), &OCCManager::add_mesh_surface, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("add_rendering_surface", "mesh", "shape_index", "element_type", "first_id"), &OCCManager::add_rendering_surface, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("set_lod_level_count", "count"), &OCCManager::set_lod_level_count);
+    ClassDB::bind_method(D_METHOD("get_lod_level_count"), &OCCManager::get_lod_level_count);
+    ClassDB::bind_method(D_METHOD("set_lod_deflection_factor", "factor"), &OCCManager::set_lod_deflection_factor);
+    ClassDB::bind_method(D_METHOD("get_lod_deflection_factor"), &OCCManager::get_lod_deflection_factor);
+    ClassDB::bind_method(D_METHOD("get_shape_occluder", "shape_index"), &OCCManager::get_shape_occluder);
+    ClassDB::bind_method(D_METHOD("set_occluder_deflection_factor", "factor"), &OCCManager::set_occluder_deflection_factor);
+    ClassDB::bind_method(D_METHOD("get_occluder_deflection_factor"), &OCCManager::get_occluder_deflection_factor);
+    ClassDB::bind_method(D_METHOD("set_occluder_simplify_ratio", "ratio"), &OCCManager::set_occluder_simplify_ratio);
+    ClassDB::bind_method(D_METHOD("get_occluder_simplify_ratio"), &OCCManager::get_occluder_simplify_ratio);
+    ClassDB::bind_method(D_METHOD("get_part_count", "shape_index"), &OCCManager::get_part_count);
+    ClassDB::bind_method(D_METHOD("get_part_mesh_arrays", "shape_index", "part_id"), &OCCManager::get_part_mesh_arrays);
+    ClassDB::bind_method(D_METHOD("get_part_instances", "shape_index"), &OCCManager::get_part_instances);
+    ClassDB::bind_method(D_METHOD("get_part_instance_buffer", "shape_index", "part_id"), &OCCManager::get_part_instance_buffer);
+    ClassDB::bind_method(D_METHOD("get_assembly_tree", "shape_index"), &OCCManager::get_assembly_tree);
+    ClassDB::bind_method(D_METHOD("get_shape_generation", "shape_index"), &OCCManager::get_shape_generation);
+    ClassDB::bind_method(D_METHOD("get_changes_since", "shape_index", "generation"), &OCCManager::get_changes_since);
+    ClassDB::bind_method(D_METHOD("get_edge_polylines", "shape_index", "first_edge"), &OCCManager::get_edge_polylines, DEFVAL(0));
+    ClassDB::bind_method(D_METHOD("pick_nearest", "ray_origin", "ray_dir", "tolerance", "element_type"), &OCCManager::pick_nearest);
+    ClassDB::bind_method(D_METHOD("select_in_volume", "planes", "element_type"), &OCCManager::select_in_volume);
+
+    ClassDB::bind_method(D_METHOD("import_step_async", "path"), &OCCManager::import_step_async);
+    ClassDB::bind_method(D_METHOD("cancel_import", "task_id"), &OCCManager::cancel_import);
+    ClassDB::bind_method(D_METHOD("set_import_cache_enabled", "enabled"), &OCCManager::set_import_cache_enabled);
+    ClassDB::bind_method(D_METHOD("is_import_cache_enabled"), &OCCManager::is_import_cache_enabled);
+    ADD_SIGNAL(MethodInfo("import_progress", PropertyInfo(Variant::INT, "task_id"), PropertyInfo(Variant::STRING, "phase"), PropertyInfo(Variant::FLOAT, "progress")));
+    ADD_SIGNAL(MethodInfo("import_finished", PropertyInfo(Variant::INT, "task_id"), PropertyInfo(Variant::INT, "shape_index")));
+
+    BIND_ENUM_CONSTANT(ELEMENT_POINT);
+    BIND_ENUM_CONSTANT(ELEMENT_EDGE);
+    BIND_ENUM_CONSTANT(ELEMENT_FACE);
     ClassDB::bind_method(D_METHOD("add_point", "shape_index", "x", "y", "z"), &OCCManager::add_point);
     ClassDB::bind_method(D_METHOD("add_edge", "shape_index", "firstPointID", "secondPointID"), &OCCManager::add_edge);
     ClassDB::bind_method(D_METHOD("add_arc", "shape_index", "startPointID", "centerPointID", "endPointID"), &OCCManager::add_arc_circle);
@@ -797,12 +2595,26 @@ void OCCManager::_bind_methods() {
     ClassDB::bind_method(D_METHOD("visualize"), &OCCManager::visualize);
     ClassDB::bind_method(D_METHOD("end_visualization"), &OCCManager::end_visualization);
     ClassDB::bind_method(D_METHOD("add_surface", "shape_index", "verticeIDs"), &OCCManager::add_surface);
+    ClassDB::bind_method(D_METHOD("begin_batch", "shape_index"), &OCCManager::begin_batch);
+    ClassDB::bind_method(D_METHOD("commit_batch", "state_name"), &OCCManager::commit_batch, DEFVAL(""));
+    ClassDB::bind_method(D_METHOD("is_batch_open"), &OCCManager::is_batch_open);
+    ClassDB::bind_method(D_METHOD("apply_operations", "shape_index", "operations", "state_name"), &OCCManager::apply_operations, DEFVAL(""));
     ClassDB::bind_method(D_METHOD("save_state", "state_name"), &OCCManager::save_state);
     ClassDB::bind_method(D_METHOD("load_state", "position"), &OCCManager::load_state);
     ClassDB::bind_method(D_METHOD("undo"), &OCCManager::undo);
     ClassDB::bind_method(D_METHOD("redo"), &OCCManager::redo);
     ClassDB::bind_method(D_METHOD("get_undo_stack"), &OCCManager::get_undo_stack);
     ClassDB::bind_method(D_METHOD("get_current_state_position"), &OCCManager::get_current_state_position);
+    ClassDB::bind_method(D_METHOD("set_linear_deflection", "deflection"), &OCCManager::set_linear_deflection);
+    ClassDB::bind_method(D_METHOD("get_linear_deflection"), &OCCManager::get_linear_deflection);
+    ClassDB::bind_method(D_METHOD("set_angular_deflection", "deflection"), &OCCManager::set_angular_deflection);
+    ClassDB::bind_method(D_METHOD("get_angular_deflection"), &OCCManager::get_angular_deflection);
+    ClassDB::bind_method(D_METHOD("set_undo_memory_budget", "bytes"), &OCCManager::set_undo_memory_budget);
+    ClassDB::bind_method(D_METHOD("get_undo_memory_budget"), &OCCManager::get_undo_memory_budget);
+    ClassDB::bind_method(D_METHOD("get_undo_memory_usage"), &OCCManager::get_undo_memory_usage);
+    ClassDB::bind_method(D_METHOD("set_undo_hot_state_count", "count"), &OCCManager::set_undo_hot_state_count);
+    ClassDB::bind_method(D_METHOD("get_undo_hot_state_count"), &OCCManager::get_undo_hot_state_count);
+    ClassDB::bind_method(D_METHOD("get_undo_file_size"), &OCCManager::get_undo_file_size);
 
 }
 
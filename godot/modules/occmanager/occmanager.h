@@ -2,13 +2,39 @@
 #define GODOT_OCCManager_H
 
 #include <vector>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <atomic>
 #include "core/object/ref_counted.h"
+#include "core/object/worker_thread_pool.h"
+#include "scene/resources/mesh.h"
+#include "scene/3d/occluder_instance_3d.h"
+#include "topology_hash.h"
+#include "picking_index.h"
+#include "shape_assembly.h"
+#include "undo_file.h"
 
 #include <TopoDS_Shape.hxx>
 #include <TopoDS_Edge.hxx>
+#include <TopoDS_Face.hxx>
+#include <Poly_Triangulation.hxx>
+#include <gp_Trsf.hxx>
+#include <TopoDS_TShape.hxx>
+#include <Message_ProgressRange.hxx>
 
 class OCCManager : public RefCounted {
 	GDCLASS(OCCManager, RefCounted);
+	//Lets the benchmarks time the steps of an import on their own
+	friend class BenchmarkOCCManagerInternalsAccessor;
+
+public:
+	//Same order as ElementType in the frontend
+	enum ElementType {
+		ELEMENT_POINT,
+		ELEMENT_EDGE,
+		ELEMENT_FACE,
+	};
 
 private:
 	//Contains a list of OCC shapes
@@ -19,22 +45,334 @@ private:
 	std::vector<std::vector<TopoDS_Edge>> shape_edges;
 
 	//---------------------------UNDO STUFF---------------------------
-	//Basically contains a list of all the previous lists for each point in the undo stack
-	std::vector<std::vector<TopoDS_Shape>> undo_shapes;
-	std::vector<std::vector<std::vector<gp_Pnt>>> undo_shape_vertices;
-	std::vector<std::vector<std::vector<TopoDS_Edge>>> undo_shape_edges;
+	//A saved copy of a single shape (its OCC shape + its vertices and edges lists)
+	//What a snapshot holds never changes after it is made, so every state in which a shape didn't change points to the same snapshot
+	//This way saving a state only copies the shapes that were actually edited instead of everything
+	//Only where it is kept changes: snapshots of states far from the current one are moved to undo_file (they're "cold")
+	struct ShapeSnapshot {
+		//Empty while the snapshot is cold
+		TopoDS_Shape shape;
+		std::vector<gp_Pnt> vertices;
+		std::vector<TopoDS_Edge> edges;
+		//Approximate amount of memory this snapshot keeps alive, used for the undo memory budget
+		int64_t memory_cost = 0;
+		//The states pointing to this snapshot, always consecutive. Counted from the first state ever saved (see undo_state_base)
+		int64_t first_state = 0;
+		int64_t last_state = 0;
+		bool cold = false;
+		//Where it is in undo_file, once it was written there (it stays valid after the snapshot is loaded back)
+		UndoFile::Record record;
+		//The deflections every face of the shape was meshed with when it was written to undo_file, 0 if they weren't all the same
+		//Reading the shape back gives it new TShapes, so they're recorded again in meshed_faces instead of meshing the whole shape
+		double linear_deflection = 0;
+		double angular_deflection = 0;
+	};
+	//A state in the undo stack, the ith entry is the snapshot of the ith shape
+	typedef std::vector<std::shared_ptr<ShapeSnapshot>> UndoState;
+
+	std::vector<UndoState> undo_states;
 	std::vector<String> undo_state_names;
 	int position_in_stack = -1;
 
+	//Parallel to shapes. Holds the snapshot that each shape currently matches
+	//nullptr means the shape was modified since the last save so a new snapshot has to be made for it
+	std::vector<std::shared_ptr<ShapeSnapshot>> shape_snapshots;
+
+	//Maximum amount of memory (in bytes) the undo stack is allowed to use, the oldest states are dropped when it is exceeded
+	//0 means no limit
+	int64_t undo_memory_budget = 0;
+
+	//Only the snapshots of the states at most undo_hot_state_count - 1 away from the current one (either way) stay in memory,
+	//the others are written to undo_file and loaded back when they're needed. 0 keeps everything in memory
+	int undo_hot_state_count = 4;
+	UndoFile undo_file;
+	//Number of states dropped from the front of the stack, undo_states[i] is state undo_state_base + i
+	int64_t undo_state_base = 0;
+	//Every snapshot in memory, so finding the ones to move to the file doesn't go through the whole stack
+	std::vector<std::shared_ptr<ShapeSnapshot>> hot_snapshots;
+	//Printing the stack only shows this many states on each side of the current one
+	static const int UNDO_PRINT_RADIUS = 5;
+
 	bool visualization_active = false;
 
+	//Points closer than this are considered to be the same point (Same goes for edges with matching endpoints and curves)
+	static constexpr double VERTEX_TOLERANCE = 1e-6;
+
+	//Lookup structures over the stored vertices and edges of a shape
+	//They let us deduplicate the vertices/edges of a newly added element against the existing ones without extracting the whole shape again
+	struct TopologyIndex {
+		PointWelder vertices;
+		EdgeDeduplicator edges;
+		//Number of triangulated faces in the shape, which is also the next face ID. -1 until it's needed
+		int face_count = -1;
+
+		TopologyIndex() :
+				vertices(VERTEX_TOLERANCE), edges(VERTEX_TOLERANCE) {}
+	};
+	//Parallel to shapes. nullptr means the index is out of date and has to be rebuilt from shape_vertices/shape_edges before use
+	std::vector<std::unique_ptr<TopologyIndex>> topology_indices;
+
 	//A 2d vector of ints.
 	//The outer vector is for each shape.
 	//The inner vector. Its index is the curve ID, its value is the last index of the visual edges that correspond to that curve.
 	//So [0][0] = 20, means the first 
 
+	//---------------------------CHANGE TRACKING---------------------------
+	//Every change to a shape gives it a new generation (unique across all shapes)
+	//So the frontend can tell which shapes changed since it last drew them, and what was added to them
+	struct ShapeChange {
+		uint64_t generation = 0;
+		//The IDs added by this change are [first, first + count) for each element type
+		int first_vertex = 0, vertex_count = 0;
+		int first_edge = 0, edge_count = 0;
+		int first_face = 0, face_count = 0;
+		//The triangulated faces with the IDs [first_face, first_face + face_count), so catching up doesn't have to go through the whole shape
+		std::vector<TopoDS_Face> faces;
+	};
+	struct ShapeChangeLog {
+		uint64_t generation = 0;
+		//The oldest generation that can be brought up to date using the changes below, anything else needs a full redraw
+		uint64_t history_start = 0;
+		std::vector<ShapeChange> changes;
+	};
+	//Parallel to shapes
+	std::vector<ShapeChangeLog> shape_change_logs;
+	uint64_t next_generation = 1;
+	//Older changes are forgotten, asking for them gives a full redraw
+	static const int MAX_TRACKED_CHANGES = 256;
+
+	//Used when the whole shape is replaced (import, undo/redo, re-meshing...), anything drawn before has to be redrawn entirely
+	void reset_shape_changes(int shape_index);
+	void record_shape_change(int shape_index, ShapeChange change);
+	//Puts everything added to the shape since generation in r_added (as a single range per element type)
+	//Returns false if that can't be done and the shape has to be treated as entirely new
+	bool get_added_since(int shape_index, uint64_t generation, ShapeChange &r_added) const;
+
+	//---------------------------PICKING---------------------------
+	//Parallel to shapes (may be shorter). Built the first time a shape is picked from, then caught up with its changes
+	std::vector<std::unique_ptr<ShapePickingIndex>> picking_indices;
+
+	ShapePickingIndex &get_picking_index(int shape_index);
+
+	//---------------------------ASSEMBLIES---------------------------
+	//Parallel to shapes (may be shorter). Built the first time the parts of a shape are asked for, rebuilt when the shape changes
+	std::vector<std::unique_ptr<ShapeAssembly>> assemblies;
+
+	//Returns nullptr if the index is invalid
+	const ShapeAssembly *get_assembly(int shape_index);
+
+	//Appends the edge's polyline to r_points, this is what the edges are drawn as and what picking tests against
+	//The number of points adapts to the curvature (within the mesher's deflections)
+	//Returns false if the edge has no curve
+	bool sample_edge(const TopoDS_Edge &edge, std::vector<Vector3> &r_points) const;
+
+	//---------------------------MESHING---------------------------
+	//Deflections used by the mesher. Lower values mean finer (and slower) triangulations
+	double linear_deflection = 0.1;
+	double angular_deflection = 0.5;
+
+	//Which deflections each face was last meshed with
+	//The triangulation itself lives on the face's TShape, which is shared by every shape and undo state the face is part of,
+	//so a face only ever needs to be meshed once per deflection
+	struct MeshedFace {
+		//Keeps the TShape alive so its address (the key) can't be reused by another face while it's in the cache
+		Handle(TopoDS_TShape) tshape;
+		double linear_deflection;
+		double angular_deflection;
+	};
+	std::unordered_map<const TopoDS_TShape *, MeshedFace> meshed_faces;
+	//The cache is pruned of faces that don't exist anymore whenever it doubles in size
+	size_t meshed_faces_prune_size = 1024;
+
+	void prune_meshed_faces();
+
 	void mesh_shape(int shape_index);
 
+	//A triangulated face of a shape, along with what's needed to put its nodes in the shape's space
+	struct FaceTriangulation {
+		TopoDS_Face face;
+		Handle(Poly_Triangulation) triangulation;
+		gp_Trsf transform;
+		//Reversed faces need their triangles' winding (and normals) flipped
+		bool reversed = false;
+	};
+	//Lists the triangulated faces of the shape, the index in the list is the face ID
+	void collect_face_triangulations(int shape_index, std::vector<FaceTriangulation> &r_faces) const;
+	static void collect_face_triangulations(const TopoDS_Shape &shape, std::vector<FaceTriangulation> &r_faces);
+	//Look at get_mesh_arrays for the format, the face IDs are the indices in faces
+	//Only the faces from first_face on are in the arrays
+	static Array build_mesh_arrays(const std::vector<FaceTriangulation> &faces, int first_face = 0);
+
+	//Face extraction is done in two passes: the first works out where each face's nodes and triangles go in the buffers (prefix sums),
+	//the second fills them, every face on its own since their ranges don't overlap
+	struct FaceBufferJob {
+		const std::vector<FaceTriangulation> *faces = nullptr;
+		int first_face = 0;
+		//Face first_face + i starts at vertex_offsets[i] and index_offsets[i], the last entries are the totals
+		std::vector<int> vertex_offsets;
+		std::vector<int> index_offsets;
+		//The buffers to fill (sized from the totals), null ones are skipped
+		Vector3 *vertices = nullptr;
+		Vector3 *normals = nullptr;
+		float *face_ids = nullptr;
+		int32_t *indices = nullptr;
+		//Unindexed: the 3 vertices of each triangle (as many as indices), and the face ID of each triangle
+		Vector3 *triangle_vertices = nullptr;
+		int32_t *triangle_face_ids = nullptr;
+	};
+	//Below this many faces the passes run on the calling thread
+	static const int MIN_PARALLEL_FACES = 64;
+	//The first pass. With with_normals the faces' missing normals are computed too (in parallel)
+	static void prepare_face_buffer_job(FaceBufferJob &r_job, const std::vector<FaceTriangulation> &faces, int first_face, bool with_normals);
+	//The second pass, spread over the WorkerThreadPool
+	static void run_face_buffer_job(FaceBufferJob &job);
+	static void run_parallel(void (*func)(void *, uint32_t), void *userdata, int elements, const String &description);
+	static void fill_face_buffers(void *p_job, uint32_t p_index);
+	static void compute_face_normals(void *p_faces, uint32_t p_index);
+
+	//ARRAY_VERTEX holds the points from first_point on, ARRAY_CUSTOM0 their IDs
+	Array get_point_arrays(int shape_index, int first_point) const;
+	//The elements from first_id on as a surface in the renderer's own format
+	//Returns false if there is nothing to draw
+	//Faces get the LODs (when there are some) if all of them are in the surface
+	bool make_surface_data(int shape_index, ElementType element_type, int first_id, RS::SurfaceData &r_surface);
+	//Triangulates the faces of shape that aren't already triangulated with the current deflections
+	//The faces are meshed in parallel
+	void mesh(const TopoDS_Shape &shape);
+	//Triangulates every face of shape with the given deflections, without looking at the cache
+	static void mesh_faces(const TopoDS_Shape &shape, double p_linear_deflection, double p_angular_deflection, const Message_ProgressRange &progress = Message_ProgressRange());
+	//Remembers that the faces of shape were meshed with these deflections
+	void record_meshed_faces(const TopoDS_Shape &shape, double p_linear_deflection, double p_angular_deflection);
+	//True if every face of shape is triangulated and was meshed with these deflections
+	bool is_meshed_with(const TopoDS_Shape &shape, double p_linear_deflection, double p_angular_deflection) const;
+
+	//---------------------------LOD---------------------------
+	//Coarser triangulations of the shapes, used as the LODs of the face surfaces so far away shapes draw fewer triangles
+	//Level k is meshed with the deflections times lod_deflection_factor^k (level 0 being the shape itself)
+	int lod_level_count = 0;
+	double lod_deflection_factor = 4.0;
+	//The angular deflection of the levels stops growing here, past it curved faces collapse
+	static constexpr double MAX_LOD_ANGULAR_DEFLECTION = 1.0;
+	struct ShapeLods {
+		uint64_t generation = 0;
+		//The triangulated faces of the shape with the level's triangulations, starting at level 1. The index in a level is the face ID
+		//Faces that the coarser meshing couldn't triangulate keep the shape's triangulation
+		std::vector<std::vector<FaceTriangulation>> levels;
+		//The linear deflection of each level, it is the error of the level so Godot uses it as the LOD's edge length
+		std::vector<double> deflections;
+	};
+	//Parallel to shapes (may be shorter). Built the first time a shape's faces are drawn, rebuilt when the shape changes
+	std::vector<std::unique_ptr<ShapeLods>> shape_lods;
+
+	//The coarse triangulations of the faces, so a shape that changed only has its new faces meshed again
+	struct LodFace {
+		//Keeps the TShape alive so its address (the key) can't be reused by another face while it's in the cache
+		Handle(TopoDS_TShape) tshape;
+		//One per level starting at level 1, in the face's own space. Null where the face couldn't be triangulated
+		std::vector<Handle(Poly_Triangulation)> levels;
+	};
+	std::unordered_map<const TopoDS_TShape *, LodFace> lod_faces;
+	//The deflections of the levels in lod_faces, the cache is dropped when they change
+	std::vector<double> lod_face_linear_deflections;
+	std::vector<double> lod_face_angular_deflections;
+	//Pruned the same way as meshed_faces
+	size_t lod_faces_prune_size = 1024;
+
+	//Returns nullptr if there are no LODs
+	const ShapeLods *get_shape_lods(int shape_index);
+	//Meshes the faces that aren't in lod_faces yet, for every level
+	void mesh_lod_faces(const std::vector<FaceTriangulation> &faces);
+	void prune_lod_faces();
+	//Fills r_face_triangulation, returns false if the face isn't triangulated
+	static bool make_face_triangulation(const TopoDS_Face &face, FaceTriangulation &r_face_triangulation);
+
+	//---------------------------OCCLUDERS---------------------------
+	//The occluder of a shape is made of its closed shells (the outside of its solids), anything behind them is hidden
+	//Open shells and lone faces can be seen through from some side so they're left out
+	//An occluder must stay inside the material, otherwise it hides what can be seen through a hole or a hollow
+	//Convex shells are meshed with deflections occluder_deflection_factor times the shape's, then simplified with meshoptimizer:
+	//every triangle of those has its corners on the shell, so it can't leave it
+	//Other shells keep the shape's triangulation as it is, a coarser one would cut across their concave faces
+	double occluder_deflection_factor = 8.0;
+	//Fraction of a shell's triangles the simplification tries to get down to
+	double occluder_simplify_ratio = 0.25;
+	//The most the simplification may move the surface, relative to the size of the shell
+	static constexpr float OCCLUDER_SIMPLIFY_ERROR = 0.01f;
+	struct ShapeOccluder {
+		uint64_t generation = 0;
+		//Handed out once and refilled when the shape changes, so the OccluderInstance3D using it follows the shape
+		Ref<ArrayOccluder3D> occluder;
+	};
+	//Parallel to shapes (may be shorter). Built when a shape's occluder is first asked for, rebuilt when the shape changes
+	std::vector<std::unique_ptr<ShapeOccluder>> shape_occluders;
+
+	//The occluder triangles of the closed shells by shell TShape, in the shells' own space
+	//So a shape that changed only has its new shells meshed again, and shells placed several times (assembly parts) are only meshed once
+	struct ShellMesh {
+		//Keeps the TShape alive so its address (the key) can't be reused by another shell while it's in the cache
+		Handle(TopoDS_TShape) tshape;
+		PackedVector3Array vertices;
+		PackedInt32Array indices;
+	};
+	std::unordered_map<const TopoDS_TShape *, ShellMesh> shell_meshes;
+	//What shell_meshes were built with, the cache is dropped when any of it changes
+	double shell_meshes_linear_deflection = 0;
+	double shell_meshes_angular_deflection = 0;
+	double shell_meshes_deflection_factor = 0;
+	double shell_meshes_simplify_ratio = 0;
+	//Pruned the same way as meshed_faces
+	size_t shell_meshes_prune_size = 1024;
+
+	//Appends the occluder triangles of the closed shells of shape to r_vertices and r_indices
+	void build_occluder_arrays(const TopoDS_Shape &shape, PackedVector3Array &r_vertices, PackedInt32Array &r_indices);
+	void prune_shell_meshes();
+	//Simplifies a welded triangle mesh in place, dropping the vertices no triangle uses anymore. Does nothing without meshoptimizer
+	static void simplify_occluder_arrays(PackedVector3Array &r_vertices, PackedInt32Array &r_indices, double ratio);
+	//Welds the triangulations of the faces of shell into one mesh, in the shell's space. The faces of a shell share their edges' nodes so it comes out closed
+	static void weld_shell_triangulation(const TopoDS_Shape &shell, PackedVector3Array &r_vertices, PackedInt32Array &r_indices);
+	//True if no two neighbouring triangles of the closed mesh fold inward by more than tolerance (a closed mesh that is convex at every edge is convex)
+	//A mesh that isn't closed (an edge without a neighbour) is never convex
+	static bool is_convex_mesh(const PackedVector3Array &vertices, const PackedInt32Array &indices, double tolerance);
+
+	//---------------------------IMPORT---------------------------
+	//An import in progress. Everything it produces is built on the side (off the main thread for import_step_async)
+	//and only added to the shapes once it's done
+	struct ImportTask {
+		int64_t id = 0;
+		String path;
+		//The deflections when the import started, since they may be changed on the main thread while it runs
+		double linear_deflection = 0;
+		double angular_deflection = 0;
+		//False for import_step, which runs on the caller's thread and doesn't emit signals
+		bool asynchronous = false;
+		bool use_cache = false;
+		WorkerThreadPool::TaskID pool_task = WorkerThreadPool::INVALID_TASK_ID;
+		std::atomic<bool> cancelled{ false };
+		bool succeeded = false;
+
+		TopoDS_Shape shape;
+		std::unique_ptr<TopologyIndex> topology_index;
+		std::vector<gp_Pnt> vertices;
+		std::vector<TopoDS_Edge> edges;
+	};
+	//Imports are cached next to the STEP file (see ShapeCache) and loaded from there when nothing changed
+	bool import_cache_enabled = true;
+
+	//Imports started with import_step_async that haven't finished yet, by ID
+	std::unordered_map<int64_t, std::unique_ptr<ImportTask>> import_tasks;
+	int64_t next_import_id = 1;
+
+	//Runs the import, asynchronous imports then queue _finish_async_import on the main thread
+	void run_import(ImportTask *task);
+	//Reads, transfers, deduplicates and meshes the STEP file, checking for cancellation between (and during) each phase
+	void run_import_phases(ImportTask *task);
+	//Adds the imported shape to the shapes, returns its index (-1 if the import failed or was cancelled)
+	int finish_import(ImportTask &task);
+	void _finish_async_import(int64_t task_id);
+	//Emits import_progress on the main thread (only for asynchronous imports)
+	void report_import_progress(ImportTask *task, const String &phase, double progress);
+	void _emit_import_progress(int64_t task_id, const String &phase, double progress);
+
 	//Saves the shape in the list + its points in the shape_points vector
 	//By default it saves it in a new index, but if shape_index is specified, it saves it in that index (Updating information of a prexisting shape)
 	void store_shape(const TopoDS_Shape &shape,int shape_index = -1);
@@ -45,7 +383,51 @@ private:
 
 	void store_edges(int shape_index = -1);
 
+	//Welds all the vertices of shape into r_welder
+	static void index_vertices(const TopoDS_Shape &shape, PointWelder &r_welder);
+	//Adds all the edges of shape to r_deduplicator, the ones that aren't duplicates are appended to r_edges
+	static void index_edges(const TopoDS_Shape &shape, EdgeDeduplicator &r_deduplicator, std::vector<TopoDS_Edge> &r_edges);
+
+	TopologyIndex &get_topology_index(int shape_index);
+
+	//Adds sub_shape (a new point, edge, face...) to the shape at shape_index
+	//Only the vertices and edges of sub_shape are extracted (they're appended after the existing ones) and only sub_shape is meshed
+	//So the cost of an edit doesn't depend on the size of the model
+	void append_sub_shape(int shape_index, const TopoDS_Shape &sub_shape);
+
+	//append_sub_shape split in its steps, so a batch can do the first for every addition and the rest once
+	//Where the IDs of the change start
+	ShapeChange start_change(int shape_index);
+	//Welds the vertices and dedups the edges of sub_shape into the shape's tables, so they get their IDs right away
+	void index_sub_shape(int shape_index, const TopoDS_Shape &sub_shape);
+	//Adds the sub shapes to the shape's compound, meshes them together and records the change
+	void finish_change(int shape_index, const std::vector<TopoDS_Shape> &sub_shapes, ShapeChange change);
+
+	//---------------------------BATCHING---------------------------
+	//-1 if no batch is open
+	int batch_shape_index = -1;
+	//What was added to the batch's shape since begin_batch, not part of its compound or meshed yet
+	std::vector<TopoDS_Shape> batch_sub_shapes;
+	ShapeChange batch_change;
+	//Closes the batch without applying it, the points and edges added to it are removed from the shape's tables
+	void discard_batch();
 
+	static int count_triangulated_faces(const TopoDS_Shape &shape);
+
+	//Flags the shape as changed so that the next save_state makes a new snapshot for it
+	void mark_shape_modified(int shape_index);
+
+	std::shared_ptr<ShapeSnapshot> make_snapshot(int shape_index) const;
+
+	//Moves the snapshots that are out of the hot states to undo_file, and forgets the ones no state points to anymore
+	void update_hot_snapshots();
+	//Returns false if it couldn't be written (it stays in memory then)
+	bool make_snapshot_cold(ShapeSnapshot &snapshot);
+	//Reads a cold snapshot back from undo_file and adds it to hot_snapshots
+	bool load_cold_snapshot(const std::shared_ptr<ShapeSnapshot> &snapshot);
+
+	//Drops the oldest states until the undo stack fits in undo_memory_budget
+	void enforce_undo_memory_budget();
 
 	void print_undo_stack();
 
@@ -57,6 +439,18 @@ public:
 	//Imports a step file and stores in shapes
 	void import_step(const String &p_path);
 
+	//Same as import_step but runs on the WorkerThreadPool and returns right away with the ID of the import
+	//import_progress(task_id, phase, progress) is emitted as it goes through the "parse", "transfer", "dedup" and "mesh" phases (progress goes from 0 to 1 in each phase)
+	//import_finished(task_id, shape_index) is emitted once it's done, shape_index is -1 if it failed or was cancelled
+	int64_t import_step_async(const String &p_path);
+	//Returns false if there is no import running with this ID
+	bool cancel_import(int64_t task_id);
+
+	//When enabled, an import writes a binary cache next to the STEP file (<file>.occache) and later imports of the same file,
+	//with the same deflections, load it instead of redoing the whole import. Then there is a single "cache" phase
+	void set_import_cache_enabled(bool enabled);
+	bool is_import_cache_enabled() const;
+
 	int get_shape_count() const;
 
 	PackedVector3Array get_visual_vertices(int shape_index) const;
@@ -69,7 +463,85 @@ public:
 	Array get_faces(int shape_index) const;
 	
 
+	//Returns everything needed to draw the shape's faces in one go, as an array of size Mesh::ARRAY_MAX that can be passed to ArrayMesh.add_surface_from_arrays
+	//ARRAY_VERTEX and ARRAY_NORMAL hold the nodes of every face, ARRAY_INDEX the triangles
+	//ARRAY_CUSTOM0 holds the face ID of each vertex as a single float (use the ARRAY_CUSTOM_R_FLOAT format)
+	Array get_mesh_arrays(int shape_index) const;
+
+	//Adds the elements (of element_type) from first_id on to mesh as a single surface, without going through script arrays
+	//The buffers are packed here in the renderer's format and handed over as they are
+	//Faces are triangles (with normals), edges lines and points points. CUSTOM0 holds the element ID (ARRAY_CUSTOM_R_FLOAT)
+	//Returns false if there is nothing to add
+	bool add_mesh_surface(const Ref<ArrayMesh> &mesh, int shape_index, ElementType element_type, int first_id = 0);
+	//Same as add_mesh_surface, for a mesh created with RenderingServer.mesh_create()
+	bool add_rendering_surface(const RID &mesh, int shape_index, ElementType element_type, int first_id = 0);
+
+	//Number of coarser triangulations made for the LODs of the face surfaces (0 disables them)
+	//Each level is meshed with deflections lod_deflection_factor times bigger than the one before, and its linear deflection is its LOD edge length,
+	//so Godot switches to it once that error is small enough on screen (see mesh_lod_threshold)
+	void set_lod_level_count(int count);
+	int get_lod_level_count() const;
+	void set_lod_deflection_factor(double factor);
+	double get_lod_deflection_factor() const;
+
+	//An occluder for the shape's solids, to put in an OccluderInstance3D for occlusion culling
+	//The same occluder is returned every time and gets the new triangles when the shape changes (once it's asked for again)
+	//Returns null if the index is invalid, the occluder is empty if the shape has no closed solid
+	Ref<ArrayOccluder3D> get_shape_occluder(int shape_index);
+	//The deflection factor and simplify ratio only apply to convex solids, the others keep the shape's triangulation so the occluder stays inside them
+	void set_occluder_deflection_factor(double factor);
+	double get_occluder_deflection_factor() const;
+	void set_occluder_simplify_ratio(double ratio);
+	double get_occluder_simplify_ratio() const;
+
+	//Assemblies: the same part placed many times is only meshed (and should only be drawn) once, with a transform per placement
+	//The parts are the shapes that aren't compounds, the compounds above them are the (sub)assemblies of the STEP product tree
+	int get_part_count(int shape_index);
+	//Same format as get_mesh_arrays, in the part's own space. ARRAY_CUSTOM0 holds the face ID within the part
+	Array get_part_mesh_arrays(int shape_index, int part_id);
+	//Returns every placement of every part:
+	//"parts" = PackedInt32Array, the part of each instance
+	//"transforms" = Array of Transform3D, where each instance is in the shape
+	//"face_offsets" = PackedInt32Array, add it to a face ID of the part to get the face ID in the shape (-1 if there's no such mapping)
+	Dictionary get_part_instances(int shape_index);
+	//The transforms of the instances of a part, in the layout of MultiMesh.buffer (TRANSFORM_3D, no colors or custom data)
+	//So a MultiMesh with the part's mesh and instance_count = size / 12 draws all of them
+	PackedFloat32Array get_part_instance_buffer(int shape_index, int part_id);
+	//The product tree, one entry per node (the root is node 0):
+	//"parents" = PackedInt32Array, the parent node (-1 for the root)
+	//"parts" = PackedInt32Array, the part placed by the node (-1 for (sub)assemblies)
+	//"transforms" = Array of Transform3D, relative to the parent
+	Dictionary get_assembly_tree(int shape_index);
+
+	//Changes whenever the shape changes, if it is the same as when the shape was last drawn there's nothing to redraw
+	int64_t get_shape_generation(int shape_index) const;
+
+	//Returns what changed in the shape since it was at the given generation:
+	//"generation" = the current generation
+	//"full" = true if the changes can't be described as additions (the shape was replaced, or generation is too old/unknown) so everything must be redrawn
+	//"vertices", "edges", "faces" = PackedInt32Arrays of the IDs that were added since, when "full" is false
+	Dictionary get_changes_since(int shape_index, int64_t generation) const;
+
+	//Returns the element (of element_type) that is closest to the ray and within tolerance of it, among all shapes
+	//Faces have to be hit by the ray, the first one hit is returned
+	//{"shape_index", "element_id", "distance" (from the ray), "depth" (along the ray), "position"}, shape_index and element_id are -1 if nothing was found
+	Dictionary pick_nearest(const Vector3 &ray_origin, const Vector3 &ray_dir, double tolerance, ElementType element_type);
+
+	//Box selection, returns the IDs of the elements (of element_type) that are entirely inside the convex volume given by planes
+	//The planes point outwards, like the ones from Camera3D.get_frustum()
+	//Returns an Array with a PackedInt32Array of IDs for each shape
+	Array select_in_volume(const TypedArray<Plane> &planes, ElementType element_type);
+
 	PackedVector3Array get_edges(int shape_index) const;
+
+	//Returns the polylines of the edges from first_edge onwards (to only get the ones added since the last draw):
+	//"arrays" = an array of size Mesh::ARRAY_MAX that can be passed to ArrayMesh.add_surface_from_arrays with PRIMITIVE_LINES
+	//	ARRAY_VERTEX holds the polyline points, ARRAY_INDEX the segments (pairs of indices)
+	//	ARRAY_CUSTOM0 holds the edge ID of each point as a single float (use the ARRAY_CUSTOM_R_FLOAT format)
+	//"offsets" = PackedInt32Array, the points of edge first_edge + i are [offsets[i], offsets[i + 1]) (empty for edges without a curve)
+	Dictionary get_edge_polylines(int shape_index, int first_edge = 0) const;
+	//Number of (deduplicated) OCC edges in the shape, this is the range of valid edge IDs
+	int get_edge_count(int shape_index) const;
 	PackedVector3Array get_vertices(int shape_index) const;
 
 	void add_point(int shape_index,double x,double y, double z);
@@ -79,6 +551,25 @@ public:
 
 
 	void add_surface(int shape_index, Array edgeIds);
+
+	//Between begin_batch and commit_batch, the add_* functions on shape_index only give the new points/edges their IDs (so later additions can use them)
+	//Rebuilding the shape, meshing and recording the change are done once by commit_batch for everything that was added
+	//The shape's faces don't show what was added until then. Saving a state commits the batch first, loading one (undo/redo) drops it
+	//Returns false if a batch is already open or the index is invalid
+	bool begin_batch(int shape_index);
+	//If state_name isn't empty a single undo state is saved for the whole batch
+	void commit_batch(const String &state_name = "");
+	bool is_batch_open() const;
+
+	//Applies the operations to the shape as one batch, each operation is a Dictionary:
+	//{"type": "point", "position": Vector3}
+	//{"type": "edge", "points": [first, second]}
+	//{"type": "arc", "points": [start, center, end]}
+	//{"type": "spline", "points": [...]}
+	//{"type": "surface", "edges": [...]}
+	//Points/edges are IDs, so an operation can use the IDs of the points added by the operations before it
+	//Invalid operations are skipped. Returns false if the batch couldn't be opened
+	bool apply_operations(int shape_index, const Array &operations, const String &state_name = "");
 	
 	//Adds a shape that will be used purely for visualization
 	//If currently visualizing then this is called, it'll delete the previous visualization then visualize once more
@@ -103,7 +594,27 @@ public:
 	PackedStringArray get_undo_stack() const;
 
 	int get_current_state_position() const;
+
+	//Changing the deflections re-meshes every shape
+	void set_linear_deflection(double deflection);
+	double get_linear_deflection() const;
+	void set_angular_deflection(double deflection);
+	double get_angular_deflection() const;
+
+	void set_undo_memory_budget(int64_t bytes);
+	int64_t get_undo_memory_budget() const;
+	//Returns the memory used by the undo stack, snapshots shared by multiple states are only counted once
+	//Cold snapshots (in the undo file) don't count
+	int64_t get_undo_memory_usage() const;
+	//See undo_hot_state_count
+	void set_undo_hot_state_count(int count);
+	int get_undo_hot_state_count() const;
+	//Size of the file the cold snapshots are in
+	int64_t get_undo_file_size() const;
 	OCCManager();
+	~OCCManager();
 };
 
+VARIANT_ENUM_CAST(OCCManager::ElementType);
+
 #endif // GODOT_OCCManager_H
\ No newline at end of file
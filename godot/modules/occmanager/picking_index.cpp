@@ -0,0 +1,302 @@
+#include "picking_index.h"
+
+#include "core/math/geometry_3d.h"
+
+static inline void *leaf_data(int index) {
+    return (void *)(intptr_t)index;
+}
+
+static inline int leaf_index(void *data) {
+    return (int)(intptr_t)data;
+}
+
+void ShapePickingIndex::grow_bounds(const AABB &box) {
+    if (has_bounds) {
+        bounds.merge_with(box);
+    } else {
+        bounds = box;
+        has_bounds = true;
+    }
+}
+
+void ShapePickingIndex::add_point(int point_id, const Vector3 &position) {
+    point_tree.insert(AABB(position, Vector3()), leaf_data(points.size()));
+    points.push_back(Point{ position, point_id });
+    grow_bounds(AABB(position, Vector3()));
+}
+
+void ShapePickingIndex::add_edge(int edge_id, const Vector3 *polyline, int point_count) {
+    if (edge_id >= (int)edge_segment_counts.size()) {
+        edge_segment_counts.resize(edge_id + 1, 0);
+    }
+    for (int i = 0; i + 1 < point_count; i++) {
+        AABB box(polyline[i], Vector3());
+        box.expand_to(polyline[i + 1]);
+        segment_tree.insert(box, leaf_data(segments.size()));
+        segments.push_back(Segment{ polyline[i], polyline[i + 1], edge_id });
+        grow_bounds(box);
+    }
+    edge_segment_counts[edge_id] += MAX(point_count - 1, 0);
+}
+
+void ShapePickingIndex::add_face_triangle(int face_id, const Vector3 &a, const Vector3 &b, const Vector3 &c) {
+    if (face_id >= (int)face_triangle_counts.size()) {
+        face_triangle_counts.resize(face_id + 1, 0);
+    }
+    AABB box(a, Vector3());
+    box.expand_to(b);
+    box.expand_to(c);
+    triangle_tree.insert(box, leaf_data(triangles.size()));
+    triangles.push_back(Triangle{ { a, b, c }, face_id });
+    face_triangle_counts[face_id]++;
+    grow_bounds(box);
+}
+
+void ShapePickingIndex::clear() {
+    point_tree.clear();
+    segment_tree.clear();
+    triangle_tree.clear();
+    points.clear();
+    segments.clear();
+    triangles.clear();
+    edge_segment_counts.clear();
+    face_triangle_counts.clear();
+    has_bounds = false;
+    generation = 0;
+}
+
+bool ShapePickingIndex::clip_ray(const Vector3 &from, const Vector3 &dir, real_t tolerance, Vector3 &r_to) const {
+    if (!has_bounds) {
+        return false;
+    }
+    //Anything further than this from the origin is outside the bounds
+    real_t length = from.distance_to(bounds.get_center()) + bounds.size.length() * 0.5 + tolerance;
+    r_to = from + dir * length;
+    return true;
+}
+
+void ShapePickingIndex::make_ray_box(const Vector3 &from, const Vector3 &to, real_t tolerance, Plane r_planes[6], Vector3 r_corners[8]) {
+    Vector3 dir = (to - from).normalized();
+    Vector3 u = dir.get_any_perpendicular();
+    Vector3 v = dir.cross(u);
+
+    r_planes[0] = Plane(u, u.dot(from) + tolerance);
+    r_planes[1] = Plane(-u, -u.dot(from) + tolerance);
+    r_planes[2] = Plane(v, v.dot(from) + tolerance);
+    r_planes[3] = Plane(-v, -v.dot(from) + tolerance);
+    r_planes[4] = Plane(-dir, -dir.dot(from) + tolerance);
+    r_planes[5] = Plane(dir, dir.dot(to) + tolerance);
+
+    const Vector3 ends[2] = { from - dir * tolerance, to + dir * tolerance };
+    int corner = 0;
+    for (const Vector3 &end : ends) {
+        for (int su = -1; su <= 1; su += 2) {
+            for (int sv = -1; sv <= 1; sv += 2) {
+                r_corners[corner++] = end + u * (su * tolerance) + v * (sv * tolerance);
+            }
+        }
+    }
+}
+
+bool ShapePickingIndex::is_inside(const Plane *planes, int plane_count, const Vector3 &point) {
+    for (int i = 0; i < plane_count; i++) {
+        if (planes[i].is_point_over(point)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//Keeps the best hit: the closest to the ray, then the closest to the origin
+static inline bool is_better_hit(const ShapePickingIndex::Hit &hit, const ShapePickingIndex::Hit &best) {
+    if (best.element_id == -1) {
+        return true;
+    }
+    if (hit.distance != best.distance) {
+        return hit.distance < best.distance;
+    }
+    return hit.depth < best.depth;
+}
+
+ShapePickingIndex::Hit ShapePickingIndex::pick_point(const Vector3 &from, const Vector3 &dir, real_t tolerance) {
+    Hit best;
+    Vector3 to;
+    if (!clip_ray(from, dir, tolerance, to)) {
+        return best;
+    }
+    Plane planes[6];
+    Vector3 corners[8];
+    make_ray_box(from, to, tolerance, planes, corners);
+
+    struct Query {
+        const std::vector<Point> *points;
+        Vector3 ray[2];
+        real_t tolerance;
+        Hit *best;
+
+        bool operator()(void *data) {
+            const Point &point = (*points)[leaf_index(data)];
+            Vector3 closest = Geometry3D::get_closest_point_to_segment(point.position, ray);
+            Hit hit;
+            hit.element_id = point.point_id;
+            hit.distance = closest.distance_to(point.position);
+            hit.depth = closest.distance_to(ray[0]);
+            hit.position = point.position;
+            if (hit.distance <= tolerance && is_better_hit(hit, *best)) {
+                *best = hit;
+            }
+            return false;
+        }
+    } query{ &points, { from, to }, tolerance, &best };
+
+    point_tree.convex_query(planes, 6, corners, 8, query);
+    return best;
+}
+
+ShapePickingIndex::Hit ShapePickingIndex::pick_edge(const Vector3 &from, const Vector3 &dir, real_t tolerance) {
+    Hit best;
+    Vector3 to;
+    if (!clip_ray(from, dir, tolerance, to)) {
+        return best;
+    }
+    Plane planes[6];
+    Vector3 corners[8];
+    make_ray_box(from, to, tolerance, planes, corners);
+
+    struct Query {
+        const std::vector<Segment> *segments;
+        Vector3 from, to;
+        real_t tolerance;
+        Hit *best;
+
+        bool operator()(void *data) {
+            const Segment &segment = (*segments)[leaf_index(data)];
+            Vector3 on_ray, on_segment;
+            Geometry3D::get_closest_points_between_segments(from, to, segment.from, segment.to, on_ray, on_segment);
+            Hit hit;
+            hit.element_id = segment.edge_id;
+            hit.distance = on_ray.distance_to(on_segment);
+            hit.depth = on_ray.distance_to(from);
+            hit.position = on_segment;
+            if (hit.distance <= tolerance && is_better_hit(hit, *best)) {
+                *best = hit;
+            }
+            return false;
+        }
+    } query{ &segments, from, to, tolerance, &best };
+
+    segment_tree.convex_query(planes, 6, corners, 8, query);
+    return best;
+}
+
+ShapePickingIndex::Hit ShapePickingIndex::pick_face(const Vector3 &from, const Vector3 &dir) {
+    Hit best;
+    Vector3 to;
+    if (!clip_ray(from, dir, 0, to)) {
+        return best;
+    }
+
+    struct Query {
+        const std::vector<Triangle> *triangles;
+        Vector3 from, dir;
+        Hit *best;
+
+        bool operator()(void *data) {
+            const Triangle &triangle = (*triangles)[leaf_index(data)];
+            Vector3 position;
+            if (!Geometry3D::ray_intersects_triangle(from, dir, triangle.vertices[0], triangle.vertices[1], triangle.vertices[2], &position)) {
+                return false;
+            }
+            real_t depth = position.distance_to(from);
+            if (best->element_id == -1 || depth < best->depth) {
+                best->element_id = triangle.face_id;
+                best->distance = 0;
+                best->depth = depth;
+                best->position = position;
+            }
+            return false;
+        }
+    } query{ &triangles, from, dir, &best };
+
+    triangle_tree.ray_query(from, to, query);
+    return best;
+}
+
+void ShapePickingIndex::select_points(const Plane *planes, int plane_count, const Vector3 *hull_points, int hull_point_count, std::vector<int> &r_ids) {
+    struct Query {
+        const std::vector<Point> *points;
+        const Plane *planes;
+        int plane_count;
+        std::vector<int> *ids;
+
+        bool operator()(void *data) {
+            const Point &point = (*points)[leaf_index(data)];
+            if (is_inside(planes, plane_count, point.position)) {
+                ids->push_back(point.point_id);
+            }
+            return false;
+        }
+    } query{ &points, planes, plane_count, &r_ids };
+
+    point_tree.convex_query(planes, plane_count, hull_points, hull_point_count, query);
+}
+
+void ShapePickingIndex::select_edges(const Plane *planes, int plane_count, const Vector3 *hull_points, int hull_point_count, std::vector<int> &r_ids) {
+    //An edge is selected once all of its segments were found inside
+    std::vector<int> inside_counts(edge_segment_counts.size(), 0);
+
+    struct Query {
+        const std::vector<Segment> *segments;
+        const Plane *planes;
+        int plane_count;
+        std::vector<int> *inside_counts;
+
+        bool operator()(void *data) {
+            const Segment &segment = (*segments)[leaf_index(data)];
+            //The volume is convex, so a segment is inside if both its ends are
+            if (is_inside(planes, plane_count, segment.from) && is_inside(planes, plane_count, segment.to)) {
+                (*inside_counts)[segment.edge_id]++;
+            }
+            return false;
+        }
+    } query{ &segments, planes, plane_count, &inside_counts };
+
+    segment_tree.convex_query(planes, plane_count, hull_points, hull_point_count, query);
+
+    for (int edge_id = 0; edge_id < (int)inside_counts.size(); edge_id++) {
+        if (edge_segment_counts[edge_id] > 0 && inside_counts[edge_id] == edge_segment_counts[edge_id]) {
+            r_ids.push_back(edge_id);
+        }
+    }
+}
+
+void ShapePickingIndex::select_faces(const Plane *planes, int plane_count, const Vector3 *hull_points, int hull_point_count, std::vector<int> &r_ids) {
+    //A face is selected once all of its triangles were found inside
+    std::vector<int> inside_counts(face_triangle_counts.size(), 0);
+
+    struct Query {
+        const std::vector<Triangle> *triangles;
+        const Plane *planes;
+        int plane_count;
+        std::vector<int> *inside_counts;
+
+        bool operator()(void *data) {
+            const Triangle &triangle = (*triangles)[leaf_index(data)];
+            for (const Vector3 &vertex : triangle.vertices) {
+                if (!is_inside(planes, plane_count, vertex)) {
+                    return false;
+                }
+            }
+            (*inside_counts)[triangle.face_id]++;
+            return false;
+        }
+    } query{ &triangles, planes, plane_count, &inside_counts };
+
+    triangle_tree.convex_query(planes, plane_count, hull_points, hull_point_count, query);
+
+    for (int face_id = 0; face_id < (int)inside_counts.size(); face_id++) {
+        if (face_triangle_counts[face_id] > 0 && inside_counts[face_id] == face_triangle_counts[face_id]) {
+            r_ids.push_back(face_id);
+        }
+    }
+}
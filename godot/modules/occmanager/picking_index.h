@@ -0,0 +1,90 @@
+#ifndef GODOT_PICKING_INDEX_H
+#define GODOT_PICKING_INDEX_H
+
+#include <vector>
+#include <cstdint>
+
+#include "core/math/aabb.h"
+#include "core/math/dynamic_bvh.h"
+#include "core/math/plane.h"
+
+//Finds the points, edges and faces of a shape near a ray (picking) or inside a convex volume (box selection).
+//Every element is split into primitives (the point itself, the segments of an edge's polyline, the triangles of a face)
+//which are kept in DynamicBVHs, so a query only looks at the primitives around the ray or volume instead of all of them.
+//Elements can be added at any time, the trees are updated in place.
+class ShapePickingIndex {
+public:
+	struct Hit {
+		//-1 if nothing was hit
+		int element_id = -1;
+		//Distance between the ray and the element (0 for faces since the ray has to hit them)
+		real_t distance = 0;
+		//How far along the ray the closest point to the element is
+		real_t depth = 0;
+		Vector3 position;
+	};
+
+private:
+	struct Point {
+		Vector3 position;
+		int point_id;
+	};
+	struct Segment {
+		Vector3 from, to;
+		int edge_id;
+	};
+	struct Triangle {
+		Vector3 vertices[3];
+		int face_id;
+	};
+
+	//The userdata of each leaf is the index of its primitive in the matching vector below
+	DynamicBVH point_tree;
+	DynamicBVH segment_tree;
+	DynamicBVH triangle_tree;
+	std::vector<Point> points;
+	std::vector<Segment> segments;
+	std::vector<Triangle> triangles;
+
+	//How many primitives each element is made of, indexed by element ID
+	//Box selection uses it to tell if all of an element is inside the volume
+	std::vector<int> edge_segment_counts;
+	std::vector<int> face_triangle_counts;
+
+	//Bounds of everything that was added, used to give rays a finite length
+	AABB bounds;
+	bool has_bounds = false;
+
+	void grow_bounds(const AABB &box);
+
+	//Returns the end of the ray once cut to the length that can reach anything in the index, false if the index is empty
+	bool clip_ray(const Vector3 &from, const Vector3 &dir, real_t tolerance, Vector3 &r_to) const;
+
+	//Box around the ray segment that is tolerance wide in every direction, as the planes and corners convex_query wants
+	static void make_ray_box(const Vector3 &from, const Vector3 &to, real_t tolerance, Plane r_planes[6], Vector3 r_corners[8]);
+
+	static bool is_inside(const Plane *planes, int plane_count, const Vector3 &point);
+
+public:
+	//Generation of the shape this index was built for, to know when it has to catch up
+	uint64_t generation = 0;
+
+	void add_point(int point_id, const Vector3 &position);
+	void add_edge(int edge_id, const Vector3 *polyline, int point_count);
+	void add_face_triangle(int face_id, const Vector3 &a, const Vector3 &b, const Vector3 &c);
+	void clear();
+
+	//The closest element that is within tolerance of the ray, ties are broken by taking the one closest to the ray origin
+	Hit pick_point(const Vector3 &from, const Vector3 &dir, real_t tolerance);
+	Hit pick_edge(const Vector3 &from, const Vector3 &dir, real_t tolerance);
+	//The first face the ray hits
+	Hit pick_face(const Vector3 &from, const Vector3 &dir);
+
+	//Adds to r_ids the IDs of the elements that are entirely inside the convex volume
+	//Planes point outwards (like Camera3D::get_frustum()), hull_points are the corners of the volume
+	void select_points(const Plane *planes, int plane_count, const Vector3 *hull_points, int hull_point_count, std::vector<int> &r_ids);
+	void select_edges(const Plane *planes, int plane_count, const Vector3 *hull_points, int hull_point_count, std::vector<int> &r_ids);
+	void select_faces(const Plane *planes, int plane_count, const Vector3 *hull_points, int hull_point_count, std::vector<int> &r_ids);
+};
+
+#endif // GODOT_PICKING_INDEX_H
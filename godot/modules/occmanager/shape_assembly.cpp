@@ -0,0 +1,138 @@
+#include "shape_assembly.h"
+
+#include <BRep_Tool.hxx>
+#include <Poly_Triangulation.hxx>
+#include <TopExp.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Iterator.hxx>
+#include <TopoDS_TShape.hxx>
+
+#include <map>
+
+namespace {
+
+struct AssemblyBuilder {
+    ShapeAssembly *assembly;
+    //Face map of the whole shape, and the face ID of each of its faces (-1 if not triangulated)
+    TopTools_IndexedMapOfShape face_map;
+    std::vector<int> face_ids;
+    //Parts by TShape and orientation, a reversed placement flips the winding of the faces so it is another part
+    std::map<std::pair<const TopoDS_TShape *, int>, int> part_ids;
+    //The first and last triangulated face of each part, in its own space
+    std::vector<TopoDS_Face> first_faces;
+    std::vector<TopoDS_Face> last_faces;
+
+    int get_part(const TopoDS_Shape &shape) {
+        auto key = std::make_pair(shape.TShape().get(), (int)shape.Orientation());
+        auto found = part_ids.find(key);
+        if (found != part_ids.end()) {
+            return found->second;
+        }
+
+        ShapeAssembly::Part part;
+        part.shape = shape.Located(TopLoc_Location());
+        TopTools_IndexedMapOfShape part_faces;
+        TopExp::MapShapes(part.shape, TopAbs_FACE, part_faces);
+        TopoDS_Face first_face, last_face;
+        for (int i = 1; i <= part_faces.Extent(); ++i) {
+            TopLoc_Location loc;
+            if (!BRep_Tool::Triangulation(TopoDS::Face(part_faces.FindKey(i)), loc).IsNull()) {
+                if (part.face_count == 0) {
+                    first_face = TopoDS::Face(part_faces.FindKey(i));
+                }
+                last_face = TopoDS::Face(part_faces.FindKey(i));
+                part.face_count++;
+            }
+        }
+
+        const int part_id = assembly->parts.size();
+        assembly->parts.push_back(part);
+        first_faces.push_back(first_face);
+        last_faces.push_back(last_face);
+        part_ids[key] = part_id;
+        return part_id;
+    }
+
+    //The face IDs of an instance are consecutive as long as the faces of its part are only reached through it,
+    //this checks it by looking at where the part's first and last faces ended up
+    int get_face_offset(int part_id, const TopLoc_Location &location) const {
+        const int face_count = assembly->parts[part_id].face_count;
+        if (face_count == 0) {
+            return -1;
+        }
+        const int first = face_ids[face_map.FindIndex(first_faces[part_id].Moved(location))];
+        const int last = face_ids[face_map.FindIndex(last_faces[part_id].Moved(location))];
+        if (first == -1 || last != first + face_count - 1) {
+            return -1;
+        }
+        return first;
+    }
+
+    void add_node(const TopoDS_Shape &shape, int parent, const TopLoc_Location &parent_location) {
+        ShapeAssembly::Node node;
+        node.parent = parent;
+        node.location = shape.Location();
+        const TopLoc_Location location = parent_location * shape.Location();
+
+        const int node_id = assembly->nodes.size();
+        if (shape.ShapeType() != TopAbs_COMPOUND) {
+            node.part = get_part(shape);
+            assembly->nodes.push_back(node);
+
+            ShapeAssembly::Instance instance;
+            instance.part = node.part;
+            instance.node = node_id;
+            instance.location = location;
+            instance.face_offset = get_face_offset(node.part, location);
+            assembly->instances.push_back(instance);
+            return;
+        }
+
+        assembly->nodes.push_back(node);
+        //Locations aren't accumulated by the iterator, each child's location stays relative to this node
+        for (TopoDS_Iterator it(shape, Standard_True, Standard_False); it.More(); it.Next()) {
+            add_node(it.Value(), node_id, location);
+        }
+    }
+};
+
+} // namespace
+
+void ShapeAssembly::build(const TopoDS_Shape &shape) {
+    clear();
+    if (shape.IsNull()) {
+        return;
+    }
+
+    AssemblyBuilder builder;
+    builder.assembly = this;
+    TopExp::MapShapes(shape, TopAbs_FACE, builder.face_map);
+    // Index 0 is what FindIndex returns for faces that aren't in the map
+    builder.face_ids.resize(builder.face_map.Extent() + 1, -1);
+    int next_face_id = 0;
+    for (int i = 1; i <= builder.face_map.Extent(); ++i) {
+        TopLoc_Location loc;
+        if (!BRep_Tool::Triangulation(TopoDS::Face(builder.face_map.FindKey(i)), loc).IsNull()) {
+            builder.face_ids[i] = next_face_id++;
+        }
+    }
+
+    builder.add_node(shape, -1, TopLoc_Location());
+}
+
+void ShapeAssembly::clear() {
+    nodes.clear();
+    parts.clear();
+    instances.clear();
+    generation = 0;
+}
+
+Transform3D ShapeAssembly::to_transform(const gp_Trsf &trsf) {
+    // OCC matrices are 1-based, column 4 is the translation
+    return Transform3D(
+            trsf.Value(1, 1), trsf.Value(1, 2), trsf.Value(1, 3),
+            trsf.Value(2, 1), trsf.Value(2, 2), trsf.Value(2, 3),
+            trsf.Value(3, 1), trsf.Value(3, 2), trsf.Value(3, 3),
+            trsf.Value(1, 4), trsf.Value(2, 4), trsf.Value(3, 4));
+}
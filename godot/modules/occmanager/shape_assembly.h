@@ -0,0 +1,58 @@
+#ifndef GODOT_SHAPE_ASSEMBLY_H
+#define GODOT_SHAPE_ASSEMBLY_H
+
+#include <vector>
+#include <cstdint>
+
+#include "core/math/transform_3d.h"
+
+#include <gp_Trsf.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Shape.hxx>
+
+//The product tree of a shape, and the distinct parts it is made of.
+//STEP assemblies place the same product many times, the reader transfers it once and every placement shares its TShape
+//(and so its triangulation) under a different location. The compounds of the shape are the (sub)assemblies,
+//anything else is a part, and placements of the same TShape are instances of the same part.
+//So a part only has to be turned into a mesh once, and each instance is just a transform.
+class ShapeAssembly {
+public:
+	struct Node {
+		//-1 for the root
+		int parent = -1;
+		//-1 for (sub)assemblies
+		int part = -1;
+		//Relative to the parent
+		TopLoc_Location location;
+	};
+	struct Part {
+		//Without its location, so it is in its own space
+		TopoDS_Shape shape;
+		//Number of triangulated faces, the part's face IDs are [0, face_count)
+		int face_count = 0;
+	};
+	struct Instance {
+		int part = -1;
+		int node = -1;
+		//Relative to the shape
+		TopLoc_Location location;
+		//The face ID (in the whole shape) of the part's face 0, so a face ID of the part is face_offset + its ID in the whole shape
+		//-1 if the instance's faces don't have consecutive IDs in the shape
+		int face_offset = -1;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Part> parts;
+	std::vector<Instance> instances;
+
+	//Generation of the shape this was built for
+	uint64_t generation = 0;
+
+	void build(const TopoDS_Shape &shape);
+	void clear();
+
+	static Transform3D to_transform(const gp_Trsf &trsf);
+};
+
+#endif // GODOT_SHAPE_ASSEMBLY_H
@@ -0,0 +1,320 @@
+#include "shape_cache.h"
+
+#include "core/config/project_settings.h"
+#include "core/io/file_access.h"
+#include "core/io/marshalls.h"
+
+#include <BinTools.hxx>
+#include <BRep_Tool.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Standard_ArrayStreamBuffer.hxx>
+#include <Standard_Failure.hxx>
+#include <TopExp.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopTools_IndexedMapOfShape.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Face.hxx>
+
+#include <cstring>
+#include <sstream>
+
+#ifdef UNIX_ENABLED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char CACHE_MAGIC[4] = { 'O', 'C', 'C', 'C' };
+//Bump whenever the format changes, caches made with another version are ignored
+static const uint32_t CACHE_VERSION = 1;
+
+bool MappedFile::open(const String &p_path) {
+    close();
+
+#ifdef UNIX_ENABLED
+    const String path = ProjectSettings::get_singleton()->globalize_path(p_path);
+    int fd = ::open(path.utf8().get_data(), O_RDONLY);
+    if (fd != -1) {
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+            void *mapped = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                mapping = mapped;
+                data = (const uint8_t *)mapped;
+                size = file_stat.st_size;
+            }
+        }
+        // The mapping stays valid once the file is closed
+        ::close(fd);
+        if (mapping) {
+            return true;
+        }
+    }
+#endif
+
+    // Without mmap (or if it failed) the whole file is read instead
+    Ref<FileAccess> file = FileAccess::open(p_path, FileAccess::READ);
+    if (file.is_null()) {
+        return false;
+    }
+    buffer.resize(file->get_length());
+    if (file->get_buffer(buffer.ptrw(), buffer.size()) != (uint64_t)buffer.size()) {
+        buffer.clear();
+        return false;
+    }
+    data = buffer.ptr();
+    size = buffer.size();
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef UNIX_ENABLED
+    if (mapping) {
+        munmap(mapping, size);
+        mapping = nullptr;
+    }
+#endif
+    buffer.clear();
+    data = nullptr;
+    size = 0;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+static void put_u32(std::vector<uint8_t> &r_data, uint32_t p_value) {
+    uint8_t bytes[4];
+    encode_uint32(p_value, bytes);
+    r_data.insert(r_data.end(), bytes, bytes + 4);
+}
+
+static void put_u64(std::vector<uint8_t> &r_data, uint64_t p_value) {
+    uint8_t bytes[8];
+    encode_uint64(p_value, bytes);
+    r_data.insert(r_data.end(), bytes, bytes + 8);
+}
+
+static void put_double(std::vector<uint8_t> &r_data, double p_value) {
+    uint8_t bytes[8];
+    encode_double(p_value, bytes);
+    r_data.insert(r_data.end(), bytes, bytes + 8);
+}
+
+static void put_string(std::vector<uint8_t> &r_data, const String &p_value) {
+    CharString utf8 = p_value.utf8();
+    put_u32(r_data, utf8.length());
+    r_data.insert(r_data.end(), (const uint8_t *)utf8.get_data(), (const uint8_t *)utf8.get_data() + utf8.length());
+}
+
+//Reads values back in the order they were put
+//Reading past the end fails, and every read after that fails too, so the result only has to be checked once at the end
+struct ByteReader {
+    const uint8_t *ptr;
+    const uint8_t *end;
+    bool failed = false;
+
+    const uint8_t *take(uint64_t p_count) {
+        if (failed || (uint64_t)(end - ptr) < p_count) {
+            failed = true;
+            return nullptr;
+        }
+        const uint8_t *bytes = ptr;
+        ptr += p_count;
+        return bytes;
+    }
+    uint32_t get_u32() {
+        const uint8_t *bytes = take(4);
+        return bytes ? decode_uint32(bytes) : 0;
+    }
+    uint64_t get_u64() {
+        const uint8_t *bytes = take(8);
+        return bytes ? decode_uint64(bytes) : 0;
+    }
+    double get_double() {
+        const uint8_t *bytes = take(8);
+        return bytes ? decode_double(bytes) : 0;
+    }
+    String get_string() {
+        uint32_t length = get_u32();
+        const uint8_t *bytes = take(length);
+        return bytes ? String::utf8((const char *)bytes, length) : String();
+    }
+};
+
+//For each face ID, the index of the face in the shape's face map (face IDs only count the triangulated faces)
+static void get_face_id_mapping(const TopoDS_Shape &p_shape, std::vector<int> &r_mapping) {
+    TopTools_IndexedMapOfShape face_map;
+    TopExp::MapShapes(p_shape, TopAbs_FACE, face_map);
+    for (int i = 1; i <= face_map.Extent(); ++i) {
+        TopLoc_Location loc;
+        if (!BRep_Tool::Triangulation(TopoDS::Face(face_map.FindKey(i)), loc).IsNull()) {
+            r_mapping.push_back(i);
+        }
+    }
+}
+
+String ShapeCache::get_cache_path(const String &p_source_path) {
+    return p_source_path + ".occache";
+}
+
+void ShapeCache::serialize(const TopoDS_Shape &p_shape, const std::vector<gp_Pnt> &p_vertices, const std::vector<TopoDS_Edge> &p_edges, std::vector<uint8_t> &r_data) {
+    put_u32(r_data, p_vertices.size());
+    for (const gp_Pnt &vertex : p_vertices) {
+        put_double(r_data, vertex.X());
+        put_double(r_data, vertex.Y());
+        put_double(r_data, vertex.Z());
+    }
+
+    // The BRep along with the triangulation of its faces
+    std::ostringstream brep;
+    BinTools::Write(p_shape, brep, Standard_True, Standard_False, BinTools_FormatVersion_CURRENT);
+    const std::string brep_data = brep.str();
+    put_u64(r_data, brep_data.size());
+    r_data.insert(r_data.end(), brep_data.begin(), brep_data.end());
+
+    // Edges are stored as their index in the shape's edge map, which comes out the same once the BRep is read back
+    TopTools_IndexedMapOfShape edge_map;
+    TopExp::MapShapes(p_shape, TopAbs_EDGE, edge_map);
+    put_u32(r_data, p_edges.size());
+    for (const TopoDS_Edge &edge : p_edges) {
+        put_u32(r_data, edge_map.FindIndex(edge));
+        put_u32(r_data, edge.Orientation());
+    }
+
+    std::vector<int> face_ids;
+    get_face_id_mapping(p_shape, face_ids);
+    put_u32(r_data, face_ids.size());
+    for (int face_index : face_ids) {
+        put_u32(r_data, face_index);
+    }
+}
+
+bool ShapeCache::deserialize(const uint8_t *p_data, uint64_t p_size, TopoDS_Shape &r_shape, std::vector<gp_Pnt> &r_vertices, std::vector<TopoDS_Edge> &r_edges) {
+    ByteReader reader{ p_data, p_data + p_size };
+
+    const uint32_t vertex_count = reader.get_u32();
+    if (reader.failed || (uint64_t)vertex_count * 24 > p_size) {
+        return false;
+    }
+    r_vertices.clear();
+    r_vertices.reserve(vertex_count);
+    for (uint32_t i = 0; i < vertex_count; i++) {
+        double x = reader.get_double();
+        double y = reader.get_double();
+        double z = reader.get_double();
+        r_vertices.push_back(gp_Pnt(x, y, z));
+    }
+
+    const uint64_t brep_size = reader.get_u64();
+    const uint8_t *brep_data = reader.take(brep_size);
+    if (reader.failed) {
+        return false;
+    }
+    try {
+        // Reads straight from the (mapped) bytes, without copying them into a stream first
+        Standard_ArrayStreamBuffer buffer((const char *)brep_data, brep_size);
+        std::istream stream(&buffer);
+        BinTools::Read(r_shape, stream);
+    } catch (const Standard_Failure &e) {
+        ERR_PRINT("Invalid BRep in shape cache: " + String(e.GetMessageString()));
+        return false;
+    }
+    if (r_shape.IsNull()) {
+        return false;
+    }
+
+    TopTools_IndexedMapOfShape edge_map;
+    TopExp::MapShapes(r_shape, TopAbs_EDGE, edge_map);
+    const uint32_t edge_count = reader.get_u32();
+    if (reader.failed || edge_count > (uint32_t)edge_map.Extent()) {
+        return false;
+    }
+    r_edges.clear();
+    r_edges.reserve(edge_count);
+    for (uint32_t i = 0; i < edge_count; i++) {
+        const uint32_t edge_index = reader.get_u32();
+        const uint32_t orientation = reader.get_u32();
+        if (reader.failed || edge_index < 1 || edge_index > (uint32_t)edge_map.Extent() || orientation > TopAbs_EXTERNAL) {
+            return false;
+        }
+        r_edges.push_back(TopoDS::Edge(edge_map.FindKey(edge_index).Oriented((TopAbs_Orientation)orientation)));
+    }
+
+    // The face IDs are worked out from the shape, make sure they still point to the same faces
+    std::vector<int> face_ids;
+    get_face_id_mapping(r_shape, face_ids);
+    const uint32_t face_count = reader.get_u32();
+    if (reader.failed || face_count != face_ids.size()) {
+        return false;
+    }
+    for (uint32_t i = 0; i < face_count; i++) {
+        if (reader.get_u32() != (uint32_t)face_ids[i]) {
+            return false;
+        }
+    }
+    return !reader.failed;
+}
+
+bool ShapeCache::load(const String &p_source_path, double p_linear_deflection, double p_angular_deflection, TopoDS_Shape &r_shape, std::vector<gp_Pnt> &r_vertices, std::vector<TopoDS_Edge> &r_edges) {
+    const String cache_path = get_cache_path(p_source_path);
+    if (!FileAccess::exists(cache_path)) {
+        return false;
+    }
+    MappedFile file;
+    if (!file.open(cache_path)) {
+        return false;
+    }
+
+    ByteReader reader{ file.get_data(), file.get_data() + file.get_size() };
+    const uint8_t *magic = reader.take(4);
+    if (!magic || memcmp(magic, CACHE_MAGIC, 4) != 0 || reader.get_u32() != CACHE_VERSION) {
+        return false;
+    }
+    const uint64_t source_size = reader.get_u64();
+    const uint64_t source_modified_time = reader.get_u64();
+    const String source_md5 = reader.get_string();
+    const double linear_deflection = reader.get_double();
+    const double angular_deflection = reader.get_double();
+    if (reader.failed || linear_deflection != p_linear_deflection || angular_deflection != p_angular_deflection) {
+        return false;
+    }
+
+    Ref<FileAccess> source = FileAccess::open(p_source_path, FileAccess::READ);
+    if (source.is_null() || source->get_length() != source_size) {
+        return false;
+    }
+    source.unref();
+    // Hashing the source is only needed if it was touched since the cache was made
+    if (FileAccess::get_modified_time(p_source_path) != source_modified_time && FileAccess::get_md5(p_source_path) != source_md5) {
+        return false;
+    }
+
+    return deserialize(reader.ptr, reader.end - reader.ptr, r_shape, r_vertices, r_edges);
+}
+
+bool ShapeCache::save(const String &p_source_path, double p_linear_deflection, double p_angular_deflection, const TopoDS_Shape &p_shape, const std::vector<gp_Pnt> &p_vertices, const std::vector<TopoDS_Edge> &p_edges) {
+    Ref<FileAccess> source = FileAccess::open(p_source_path, FileAccess::READ);
+    if (source.is_null()) {
+        return false;
+    }
+    const uint64_t source_size = source->get_length();
+    source.unref();
+
+    std::vector<uint8_t> data;
+    data.insert(data.end(), CACHE_MAGIC, CACHE_MAGIC + 4);
+    put_u32(data, CACHE_VERSION);
+    put_u64(data, source_size);
+    put_u64(data, FileAccess::get_modified_time(p_source_path));
+    put_string(data, FileAccess::get_md5(p_source_path));
+    put_double(data, p_linear_deflection);
+    put_double(data, p_angular_deflection);
+    serialize(p_shape, p_vertices, p_edges, data);
+
+    Ref<FileAccess> file = FileAccess::open(get_cache_path(p_source_path), FileAccess::WRITE);
+    if (file.is_null()) {
+        return false;
+    }
+    return file->store_buffer(data.data(), data.size());
+}
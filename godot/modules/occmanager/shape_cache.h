@@ -0,0 +1,56 @@
+#ifndef GODOT_SHAPE_CACHE_H
+#define GODOT_SHAPE_CACHE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "core/string/ustring.h"
+#include "core/templates/vector.h"
+
+#include <gp_Pnt.hxx>
+#include <TopoDS_Shape.hxx>
+#include <TopoDS_Edge.hxx>
+
+//Read-only view of a whole file's bytes.
+//The file is memory mapped where the platform supports it (so only the pages that are actually read get loaded),
+//otherwise it is read into memory.
+class MappedFile {
+	const uint8_t *data = nullptr;
+	uint64_t size = 0;
+#ifdef UNIX_ENABLED
+	void *mapping = nullptr;
+#endif
+	Vector<uint8_t> buffer;
+
+public:
+	bool open(const String &p_path);
+	void close();
+
+	const uint8_t *get_data() const { return data; }
+	uint64_t get_size() const { return size; }
+
+	MappedFile() {}
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+	~MappedFile();
+};
+
+//Everything OCCManager stores for a shape that is expensive to rebuild: the BRep (with its triangulation),
+//the deduplicated vertex and edge tables, and which face each face ID is.
+//serialize/deserialize turn it into bytes and back, load/save keep it in a cache file next to an imported STEP file.
+class ShapeCache {
+public:
+	//The cache file of a STEP file
+	static String get_cache_path(const String &p_source_path);
+
+	static void serialize(const TopoDS_Shape &p_shape, const std::vector<gp_Pnt> &p_vertices, const std::vector<TopoDS_Edge> &p_edges, std::vector<uint8_t> &r_data);
+	//Returns false if the data is invalid
+	static bool deserialize(const uint8_t *p_data, uint64_t p_size, TopoDS_Shape &r_shape, std::vector<gp_Pnt> &r_vertices, std::vector<TopoDS_Edge> &r_edges);
+
+	//The cache is only used if it was made from the same source file (same size and modification time or contents) with the same deflections
+	//Returns false if there is no valid cache
+	static bool load(const String &p_source_path, double p_linear_deflection, double p_angular_deflection, TopoDS_Shape &r_shape, std::vector<gp_Pnt> &r_vertices, std::vector<TopoDS_Edge> &r_edges);
+	static bool save(const String &p_source_path, double p_linear_deflection, double p_angular_deflection, const TopoDS_Shape &p_shape, const std::vector<gp_Pnt> &p_vertices, const std::vector<TopoDS_Edge> &p_edges);
+};
+
+#endif // GODOT_SHAPE_CACHE_H
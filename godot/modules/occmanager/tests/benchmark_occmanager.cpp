@@ -0,0 +1,177 @@
+#include "benchmark_occmanager.h"
+#include "test_occmanager_fixtures.h"
+
+#include "../occmanager.h"
+
+#include "core/io/file_access.h"
+#include "core/io/json.h"
+#include "core/os/memory.h"
+#include "core/os/os.h"
+#include "tests/test_utils.h"
+
+#ifdef UNIX_ENABLED
+#include <sys/resource.h>
+#endif
+
+class BenchmarkOCCManagerInternalsAccessor {
+public:
+	static void store_vertices(OCCManager &p_occ_manager, int p_shape_index) {
+		p_occ_manager.get_topology_index(p_shape_index);
+		p_occ_manager.store_vertices(p_shape_index);
+	}
+	static void store_edges(OCCManager &p_occ_manager, int p_shape_index) {
+		p_occ_manager.get_topology_index(p_shape_index);
+		p_occ_manager.store_edges(p_shape_index);
+	}
+};
+
+namespace BenchmarkOCCManager {
+
+//Peak resident memory of the process, this is where the OCC allocations show up since they don't go through Memory
+static int64_t get_peak_process_memory() {
+#ifdef UNIX_ENABLED
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef MACOS_ENABLED
+		return usage.ru_maxrss; // Already in bytes
+#else
+		return int64_t(usage.ru_maxrss) * 1024;
+#endif
+	}
+#endif
+	return -1;
+}
+
+//The synthetic models, see write_grid_step
+enum GridModel {
+	//Boxes with a cylinder on top, nothing shared between them
+	GRID_PARTS,
+	//Boxes touching each other, the import has to deduplicate their shared vertices and edges
+	GRID_TOUCHING_BOXES,
+};
+
+static const char *get_grid_model_name(GridModel p_model) {
+	return p_model == GRID_PARTS ? "parts" : "touching_boxes";
+}
+
+static int get_grid_solid_count(GridModel p_model, int p_grid_size) {
+	return p_model == GRID_PARTS ? p_grid_size * p_grid_size * 2 : p_grid_size * p_grid_size;
+}
+
+static String write_grid_model_step(GridModel p_model, int p_grid_size) {
+	return p_model == GRID_PARTS ? TestOCCManager::write_grid_step(p_grid_size, 2, true) : TestOCCManager::write_grid_step(p_grid_size);
+}
+
+//Runs p_step p_iterations times (p_setup before each, untimed) and adds its timings to r_results
+template <typename S, typename F>
+static void measure(Array &r_results, const String &p_operation, GridModel p_model, int p_grid_size, int p_iterations, S p_setup, F p_step) {
+	uint64_t total = 0;
+	uint64_t best = UINT64_MAX;
+	for (int i = 0; i < p_iterations; i++) {
+		p_setup();
+		const uint64_t begin = OS::get_singleton()->get_ticks_usec();
+		p_step();
+		const uint64_t elapsed = OS::get_singleton()->get_ticks_usec() - begin;
+		total += elapsed;
+		best = MIN(best, elapsed);
+	}
+
+	Dictionary result;
+	result["operation"] = p_operation;
+	result["model"] = get_grid_model_name(p_model);
+	result["grid_size"] = p_grid_size;
+	result["iterations"] = p_iterations;
+	result["min_usec"] = best;
+	result["mean_usec"] = total / p_iterations;
+	r_results.push_back(result);
+	MESSAGE(vformat("%s on %d %s: %.2f ms (min), %.2f ms (mean)",
+			p_operation, get_grid_solid_count(p_model, p_grid_size), get_grid_model_name(p_model), best / 1000.0, total / p_iterations / 1000.0));
+}
+
+static Dictionary describe_model(const Ref<OCCManager> &p_occ_manager, GridModel p_model, int p_grid_size) {
+	Dictionary model;
+	model["model"] = get_grid_model_name(p_model);
+	model["grid_size"] = p_grid_size;
+	const PackedInt32Array triangle_faces = Array(p_occ_manager->get_faces(0))[1];
+	model["faces"] = triangle_faces.is_empty() ? 0 : triangle_faces[triangle_faces.size() - 1] + 1;
+	model["vertices"] = p_occ_manager->get_vertices(0).size();
+	model["edges"] = p_occ_manager->get_edge_count(0);
+	model["triangles"] = triangle_faces.size();
+	model["undo_memory_bytes"] = p_occ_manager->get_undo_memory_usage();
+	return model;
+}
+
+void benchmark_operations(int p_max_grid_size, int p_max_import_grid_size, int p_iterations) {
+	Array results;
+	Array models;
+	Ref<OCCManager> occ_manager;
+	auto no_setup = []() {};
+	auto new_manager = [&]() {
+		occ_manager.instantiate();
+		//Timing the cache instead of the import would be pointless
+		occ_manager->set_import_cache_enabled(false);
+	};
+
+	for (int size = 2; size <= p_max_grid_size; size *= 2) {
+		const String path = write_grid_model_step(GRID_PARTS, size);
+		measure(results, "import_step", GRID_PARTS, size, p_iterations, new_manager, [&]() { occ_manager->import_step(path); });
+		REQUIRE(occ_manager->get_shape_count() == 1);
+
+		measure(results, "store_vertices", GRID_PARTS, size, p_iterations, no_setup, [&]() {
+			BenchmarkOCCManagerInternalsAccessor::store_vertices(*occ_manager.ptr(), 0);
+		});
+		measure(results, "store_edges", GRID_PARTS, size, p_iterations, no_setup, [&]() {
+			BenchmarkOCCManagerInternalsAccessor::store_edges(*occ_manager.ptr(), 0);
+		});
+
+		//Meshing is skipped for faces already meshed with the same deflections, switching between two makes every run a full re-mesh
+		double deflection = occ_manager->get_linear_deflection();
+		measure(results, "mesh_shape", GRID_PARTS, size, p_iterations, no_setup, [&]() {
+			deflection = deflection == 0.1 ? 0.05 : 0.1;
+			occ_manager->set_linear_deflection(deflection);
+		});
+
+		measure(results, "get_vertices", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->get_vertices(0); });
+		measure(results, "get_edges", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->get_edges(0); });
+		measure(results, "get_faces", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->get_faces(0); });
+		measure(results, "get_visual_vertices", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->get_visual_vertices(0); });
+		measure(results, "get_visual_indices", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->get_visual_indices(0); });
+		measure(results, "get_mesh_arrays", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->get_mesh_arrays(0); });
+
+		//Every state gets a new snapshot of the shape, as it would after an edit
+		int state = 0;
+		measure(results, "save_state", GRID_PARTS, size, p_iterations, [&]() { occ_manager->add_point(0, -1, -1, state); }, [&]() {
+			occ_manager->save_state("State " + itos(state++));
+		});
+		measure(results, "undo", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->undo(); });
+		measure(results, "redo", GRID_PARTS, size, p_iterations, no_setup, [&]() { occ_manager->redo(); });
+
+		models.push_back(describe_model(occ_manager, GRID_PARTS, size));
+	}
+
+	//Imports alone go to bigger models, with the shared topology that the parts above don't have
+	for (int size = 4; size <= p_max_import_grid_size; size *= 2) {
+		const String path = write_grid_model_step(GRID_TOUCHING_BOXES, size);
+		measure(results, "import_step", GRID_TOUCHING_BOXES, size, p_iterations, new_manager, [&]() { occ_manager->import_step(path); });
+		REQUIRE(occ_manager->get_shape_count() == 1);
+		models.push_back(describe_model(occ_manager, GRID_TOUCHING_BOXES, size));
+	}
+
+	Dictionary report;
+	report["models"] = models;
+	report["results"] = results;
+	//Both are peaks over the whole run, so they're set by the biggest model
+	report["peak_process_memory_bytes"] = get_peak_process_memory();
+	report["peak_engine_memory_bytes"] = (int64_t)Memory::get_mem_max_usage();
+
+	String output_path = OS::get_singleton()->get_environment("OCC_BENCHMARK_OUTPUT");
+	if (output_path.is_empty()) {
+		output_path = TestUtils::get_temp_path("occmanager_benchmark.json");
+	}
+	Ref<FileAccess> file = FileAccess::open(output_path, FileAccess::WRITE);
+	REQUIRE(file.is_valid());
+	file->store_string(JSON::stringify(report, "\t"));
+	MESSAGE(vformat("Benchmark results written to %s", output_path));
+}
+
+} // namespace BenchmarkOCCManager
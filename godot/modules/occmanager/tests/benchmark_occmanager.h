@@ -0,0 +1,21 @@
+#ifndef BENCHMARK_OCCMANAGER_H
+#define BENCHMARK_OCCMANAGER_H
+
+#include "tests/test_macros.h"
+
+//Timings of the OCCManager operations on synthetic models of growing size, written as JSON so runs can be compared
+//They're skipped by default, run them with --test-case="*[Benchmark]*"
+//The output goes to the path in the OCC_BENCHMARK_OUTPUT environment variable, or to the test temp folder
+
+namespace BenchmarkOCCManager {
+
+//Every operation runs on the part grids up to p_max_grid_size, the import also on grids of touching boxes up to p_max_import_grid_size
+void benchmark_operations(int p_max_grid_size, int p_max_import_grid_size, int p_iterations);
+
+TEST_CASE("[OCCManager][Benchmark] Operations on growing synthetic models" * doctest::skip()) {
+	benchmark_operations(16, 64, 5);
+}
+
+} // namespace BenchmarkOCCManager
+
+#endif // BENCHMARK_OCCMANAGER_H
@@ -0,0 +1,379 @@
+#include "test_occmanager.h"
+#include "test_occmanager_fixtures.h"
+
+#include "../occmanager.h"
+#include "../shape_assembly.h"
+
+#include "scene/3d/occluder_instance_3d.h"
+#include "scene/resources/mesh.h"
+
+#include "core/io/dir_access.h"
+#include "core/io/file_access.h"
+
+#include <BRepBuilderAPI_MakeEdge.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_MakeWire.hxx>
+#include <BRepClass3d_SolidClassifier.hxx>
+#include <BRepMesh_IncrementalMesh.hxx>
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepPrimAPI_MakePrism.hxx>
+#include <BRep_Builder.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp.hxx>
+#include <gp_Ax2.hxx>
+#include <gp_Circ.hxx>
+#include <gp_Trsf.hxx>
+
+namespace TestOCCManager {
+
+//The import cache is on by default, and the tests share their STEP paths (a grid of the same size is the same file),
+//so anything but the cache test turns it off to never be served a cache written by another test or run
+static Ref<OCCManager> make_occ_manager() {
+	Ref<OCCManager> occ_manager;
+	occ_manager.instantiate();
+	occ_manager->set_import_cache_enabled(false);
+	return occ_manager;
+}
+
+void test_import_deduplication(int p_grid_size) {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->import_step(write_grid_step(p_grid_size));
+
+	REQUIRE(occ_manager->get_shape_count() == 1);
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == (p_grid_size + 1) * (p_grid_size + 1) * 2,
+			"Vertices shared by neighbouring boxes should only be stored once.");
+	//Edges along x and y on the top and bottom layers + the vertical edges
+	CHECK_MESSAGE(occ_manager->get_edge_count(0) == 4 * p_grid_size * (p_grid_size + 1) + (p_grid_size + 1) * (p_grid_size + 1),
+			"Edges shared by neighbouring boxes should only be stored once.");
+}
+
+void test_incremental_append() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->import_step(write_grid_step(1));
+	REQUIRE(occ_manager->get_vertices(0).size() == 8);
+	REQUIRE(occ_manager->get_edge_count(0) == 12);
+
+	occ_manager->add_point(0, 5, 5, 5);
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 9, "A new point should be appended.");
+	CHECK_MESSAGE(occ_manager->get_vertices(0)[8] == Vector3(5, 5, 5), "A new point should get the next ID.");
+
+	occ_manager->add_point(0, 0, 0, 0);
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 9, "A point on top of an existing one should be merged with it.");
+
+	occ_manager->add_edge(0, 0, 8);
+	CHECK_MESSAGE(occ_manager->get_edge_count(0) == 13, "A new edge should be appended.");
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 9, "The endpoints of the new edge already exist.");
+
+	occ_manager->add_edge(0, 0, 8);
+	CHECK_MESSAGE(occ_manager->get_edge_count(0) == 13, "The same edge added twice should only be stored once.");
+}
+
+void test_batch_operations() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->import_step(write_grid_step(1));
+	const int64_t generation = occ_manager->get_shape_generation(0);
+	const int state_count = occ_manager->get_undo_stack().size();
+
+	Array operations;
+	Dictionary operation;
+	operation["type"] = "point";
+	operation["position"] = Vector3(3, 0, 0);
+	operations.push_back(operation.duplicate());
+	operation["position"] = Vector3(4, 1, 0);
+	operations.push_back(operation.duplicate());
+	operation["position"] = Vector3(5, 0, 0);
+	operations.push_back(operation.duplicate());
+	operation.clear();
+	Array arc_points;
+	arc_points.push_back(8);
+	arc_points.push_back(9);
+	arc_points.push_back(10);
+	operation["type"] = "arc";
+	operation["points"] = arc_points;
+	operations.push_back(operation.duplicate());
+	Array edge_points;
+	edge_points.push_back(8);
+	edge_points.push_back(10);
+	operation["type"] = "edge";
+	operation["points"] = edge_points;
+	operations.push_back(operation);
+
+	REQUIRE(occ_manager->apply_operations(0, operations, "Batch"));
+	CHECK_FALSE(occ_manager->is_batch_open());
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 11, "Operations should be able to use the points added before them.");
+	CHECK_MESSAGE(occ_manager->get_edge_count(0) == 14, "The arc and the edge should be appended.");
+	CHECK_MESSAGE(occ_manager->get_undo_stack().size() == state_count + 1, "The batch should save a single state.");
+
+	Dictionary changes = occ_manager->get_changes_since(0, generation);
+	CHECK_FALSE(bool(changes["full"]));
+	CHECK_MESSAGE(int64_t(changes["generation"]) == occ_manager->get_shape_generation(0), "The batch should be a single change.");
+	CHECK_MESSAGE(PackedInt32Array(changes["vertices"]) == PackedInt32Array({ 8, 9, 10 }), "The change should cover every point of the batch.");
+	CHECK_MESSAGE(PackedInt32Array(changes["edges"]) == PackedInt32Array({ 12, 13 }), "The change should cover every edge of the batch.");
+
+	CHECK_FALSE_MESSAGE(occ_manager->begin_batch(5), "A batch can't be opened on a shape that doesn't exist.");
+	REQUIRE(occ_manager->begin_batch(0));
+	CHECK_FALSE_MESSAGE(occ_manager->begin_batch(0), "Only one batch can be open at a time.");
+	occ_manager->add_point(0, 7, 7, 7);
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 12, "Points added in a batch get their ID right away.");
+	occ_manager->commit_batch();
+	CHECK_FALSE(occ_manager->is_batch_open());
+}
+
+void test_batch_undo() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->import_step(write_grid_step(1));
+	occ_manager->save_state("Import");
+	occ_manager->add_point(0, 5, 5, 5);
+	occ_manager->save_state("Point");
+	REQUIRE(occ_manager->get_vertices(0).size() == 9);
+
+	REQUIRE(occ_manager->begin_batch(0));
+	occ_manager->add_point(0, 6, 6, 6);
+	occ_manager->add_point(0, 7, 7, 7);
+	REQUIRE(occ_manager->get_vertices(0).size() == 11);
+
+	occ_manager->undo();
+	CHECK_FALSE(occ_manager->is_batch_open());
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 8, "Undoing should go back to the state before the last one.");
+	occ_manager->redo();
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 9, "The points of the dropped batch shouldn't come back.");
+	occ_manager->add_point(0, 6, 6, 6);
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == 10, "A point of the dropped batch should be new again.");
+}
+
+void test_assembly_parts() {
+	//The same box placed three times (like a part used three times in an assembly), and another box
+	TopoDS_Shape box = BRepPrimAPI_MakeBox(1, 1, 1).Shape();
+	TopoDS_Shape other_box = BRepPrimAPI_MakeBox(gp_Pnt(0, 2, 0), 1, 1, 1).Shape();
+	BRep_Builder builder;
+	TopoDS_Compound placements;
+	builder.MakeCompound(placements);
+	for (int i = 0; i < 3; i++) {
+		gp_Trsf translation;
+		translation.SetTranslation(gp_Vec(2 * i, 0, 0));
+		builder.Add(placements, box.Located(TopLoc_Location(translation)));
+	}
+	TopoDS_Compound compound;
+	builder.MakeCompound(compound);
+	builder.Add(compound, placements);
+	builder.Add(compound, other_box);
+	BRepMesh_IncrementalMesh(compound, 0.1);
+
+	ShapeAssembly assembly;
+	assembly.build(compound);
+	CHECK_MESSAGE(assembly.parts.size() == 2, "Placements of the same box should be a single part.");
+	REQUIRE(assembly.instances.size() == 4);
+	CHECK_MESSAGE(assembly.nodes.size() == 6, "The tree should have the root, the sub assembly and a node per placement.");
+	CHECK(assembly.nodes[1].parent == 0);
+	CHECK(assembly.nodes[2].parent == 1);
+	CHECK(assembly.nodes[2].part == 0);
+
+	for (int i = 0; i < 3; i++) {
+		CHECK(assembly.instances[i].part == 0);
+		CHECK_MESSAGE(ShapeAssembly::to_transform(assembly.instances[i].location.Transformation()).origin.is_equal_approx(Vector3(2 * i, 0, 0)),
+				"Each instance should keep its placement.");
+		CHECK_MESSAGE(assembly.instances[i].face_offset == i * 6, "The faces of each placement should follow the ones before.");
+	}
+	CHECK(assembly.instances[3].part == 1);
+	CHECK(assembly.instances[3].face_offset == 18);
+}
+
+void test_picking() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->import_step(write_grid_step(1));
+
+	Dictionary hit = occ_manager->pick_nearest(Vector3(0.5, 0.5, 5), Vector3(0, 0, -1), 0.1, OCCManager::ELEMENT_FACE);
+	CHECK_MESSAGE(int(hit["element_id"]) != -1, "The top face should be hit.");
+	CHECK_MESSAGE(double(hit["depth"]) == doctest::Approx(4), "The first face along the ray should be hit.");
+
+	hit = occ_manager->pick_nearest(Vector3(0, 0, 5), Vector3(0, 0, -1), 0.1, OCCManager::ELEMENT_POINT);
+	REQUIRE(int(hit["element_id"]) != -1);
+	CHECK_MESSAGE(Vector3(hit["position"]).is_equal_approx(Vector3(0, 0, 1)),
+			"Of two points on the ray, the one closest to its origin should be picked.");
+
+	hit = occ_manager->pick_nearest(Vector3(0.5, 0, 5), Vector3(0, 0, -1), 0.1, OCCManager::ELEMENT_EDGE);
+	CHECK_MESSAGE(int(hit["element_id"]) != -1, "The top edge under the ray should be picked.");
+	CHECK_MESSAGE(double(hit["depth"]) == doctest::Approx(4), "The top edge under the ray should be picked.");
+
+	hit = occ_manager->pick_nearest(Vector3(3, 3, 5), Vector3(0, 0, -1), 0.1, OCCManager::ELEMENT_POINT);
+	CHECK_MESSAGE(int(hit["shape_index"]) == -1, "Nothing should be picked away from the box.");
+
+	//The index has to catch up with elements added after it was built
+	occ_manager->add_point(0, 3, 3, 3);
+	hit = occ_manager->pick_nearest(Vector3(3, 3, 5), Vector3(0, 0, -1), 0.1, OCCManager::ELEMENT_POINT);
+	CHECK_MESSAGE(int(hit["element_id"]) == 8, "A point added after the last pick should be pickable.");
+
+	TypedArray<Plane> box;
+	box.push_back(Plane(Vector3(1, 0, 0), 1.5));
+	box.push_back(Plane(Vector3(-1, 0, 0), 0.5));
+	box.push_back(Plane(Vector3(0, 1, 0), 1.5));
+	box.push_back(Plane(Vector3(0, -1, 0), 0.5));
+	box.push_back(Plane(Vector3(0, 0, 1), 1.5));
+	box.push_back(Plane(Vector3(0, 0, -1), 0.5));
+	Array selected = occ_manager->select_in_volume(box, OCCManager::ELEMENT_POINT);
+	REQUIRE(selected.size() == 1);
+	CHECK_MESSAGE(PackedInt32Array(selected[0]).size() == 8, "Only the points of the box should be inside the volume.");
+	selected = occ_manager->select_in_volume(box, OCCManager::ELEMENT_EDGE);
+	CHECK_MESSAGE(PackedInt32Array(selected[0]).size() == 12, "All the edges of the box should be inside the volume.");
+	selected = occ_manager->select_in_volume(box, OCCManager::ELEMENT_FACE);
+	CHECK_MESSAGE(PackedInt32Array(selected[0]).size() == 6, "All the faces of the box should be inside the volume.");
+}
+
+void test_face_extraction() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	//Enough faces for the buffers to be filled on the WorkerThreadPool
+	const int grid_size = 4;
+	occ_manager->import_step(write_grid_step(grid_size));
+	const int face_count = grid_size * grid_size * 6;
+
+	const PackedVector3Array vertices = occ_manager->get_visual_vertices(0);
+	const PackedInt32Array indices = occ_manager->get_visual_indices(0);
+	const Array faces = occ_manager->get_faces(0);
+	const PackedVector3Array tris = faces[0];
+	const PackedInt32Array tri_id = faces[1];
+	REQUIRE(indices.size() % 3 == 0);
+	REQUIRE(tris.size() == indices.size());
+	REQUIRE(tri_id.size() == indices.size() / 3);
+
+	bool indices_match = true;
+	for (int i = 0; i < indices.size(); i++) {
+		if (indices[i] < 0 || indices[i] >= vertices.size() || !tris[i].is_equal_approx(vertices[indices[i]])) {
+			indices_match = false;
+			break;
+		}
+	}
+	CHECK_MESSAGE(indices_match, "The unindexed triangles should be the indexed ones.");
+
+	bool ids_in_order = tri_id[0] == 0;
+	for (int i = 1; i < tri_id.size(); i++) {
+		ids_in_order = ids_in_order && (tri_id[i] == tri_id[i - 1] || tri_id[i] == tri_id[i - 1] + 1);
+	}
+	CHECK_MESSAGE(ids_in_order, "Each face's triangles should follow the previous face's.");
+	CHECK_MESSAGE(tri_id[tri_id.size() - 1] == face_count - 1, "Every face should have triangles.");
+}
+
+void test_shape_occluder() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->import_step(write_grid_step(2));
+
+	Ref<ArrayOccluder3D> occluder = occ_manager->get_shape_occluder(0);
+	REQUIRE(occluder.is_valid());
+	const PackedVector3Array vertices = occluder->get_vertices();
+	const PackedInt32Array indices = occluder->get_indices();
+	CHECK_MESSAGE(vertices.size() == 4 * 8, "The faces of each box should be welded into one closed mesh.");
+	REQUIRE(indices.size() % 3 == 0);
+	CHECK_MESSAGE(indices.size() / 3 >= 4 * 4, "Simplifying can't go below a tetrahedron per box.");
+	bool indices_valid = true;
+	for (int i = 0; i < indices.size(); i++) {
+		indices_valid = indices_valid && indices[i] >= 0 && indices[i] < vertices.size();
+	}
+	CHECK(indices_valid);
+
+	//A lone point doesn't close anything, the occluder is the same one and keeps the boxes
+	occ_manager->add_point(0, 5, 5, 5);
+	CHECK_MESSAGE(occ_manager->get_shape_occluder(0) == occluder, "The shape's occluder should be reused when the shape changes.");
+	CHECK(occluder->get_vertices().size() == 4 * 8);
+
+	//A plate with a round hole through it isn't convex, coarse chords or simplified triangles would cut across the hole
+	BRepBuilderAPI_MakeFace plate_face(BRepBuilderAPI_MakePolygon(gp_Pnt(0, 0, 0), gp_Pnt(3, 0, 0), gp_Pnt(3, 3, 0), gp_Pnt(0, 3, 0), Standard_True).Wire());
+	const TopoDS_Edge hole_edge = BRepBuilderAPI_MakeEdge(gp_Circ(gp_Ax2(gp_Pnt(1.5, 1.5, 0), gp::DZ()), 1));
+	plate_face.Add(TopoDS::Wire(BRepBuilderAPI_MakeWire(hole_edge).Wire().Reversed()));
+	const TopoDS_Shape plate = BRepPrimAPI_MakePrism(plate_face.Face(), gp_Vec(0, 0, 1)).Shape();
+
+	Ref<OCCManager> plate_manager = make_occ_manager();
+	plate_manager->import_step(write_step(plate, "occ_holed_plate"));
+	const Ref<ArrayOccluder3D> plate_occluder = plate_manager->get_shape_occluder(0);
+	const PackedVector3Array plate_vertices = plate_occluder->get_vertices();
+	const PackedInt32Array plate_indices = plate_occluder->get_indices();
+	REQUIRE(plate_indices.size() > 0);
+	REQUIRE(plate_indices.size() % 3 == 0);
+
+	//The corners, edge midpoints and center of every triangle have to be in the plate
+	//The shape's own triangulation strays from the surface by up to its deflection, anything going further would hide what's seen through the hole
+	const double tolerance = 2 * plate_manager->get_linear_deflection();
+	bool contained = true;
+	for (int i = 0; i < plate_indices.size() && contained; i += 3) {
+		const Vector3 a = plate_vertices[plate_indices[i]];
+		const Vector3 b = plate_vertices[plate_indices[i + 1]];
+		const Vector3 c = plate_vertices[plate_indices[i + 2]];
+		const Vector3 samples[] = { a, b, c, (a + b) / 2, (b + c) / 2, (c + a) / 2, (a + b + c) / 3 };
+		for (const Vector3 &sample : samples) {
+			BRepClass3d_SolidClassifier classifier(plate, gp_Pnt(sample.x, sample.y, sample.z), tolerance);
+			if (classifier.State() == TopAbs_OUT) {
+				contained = false;
+				break;
+			}
+		}
+	}
+	CHECK_MESSAGE(contained, "The occluder of a solid with a hole should stay inside the solid.");
+}
+
+void test_cold_undo_states() {
+	Ref<OCCManager> occ_manager = make_occ_manager();
+	occ_manager->set_undo_hot_state_count(1);
+	occ_manager->import_step(write_grid_step(1));
+	occ_manager->save_state("Import");
+
+	Vector<int> vertex_counts;
+	vertex_counts.push_back(occ_manager->get_vertices(0).size());
+	for (int i = 0; i < 6; i++) {
+		occ_manager->add_point(0, 10 + i, 0, 0);
+		occ_manager->save_state("Point " + itos(i));
+		vertex_counts.push_back(occ_manager->get_vertices(0).size());
+	}
+	const int last = occ_manager->get_current_state_position();
+	const int first = last - (vertex_counts.size() - 1);
+	REQUIRE(first >= 0);
+	CHECK_MESSAGE(occ_manager->get_undo_file_size() > 0, "The older states should have been moved to the undo file.");
+
+	//Going back through every state reads each of them back from the file
+	bool states_match = true;
+	for (int i = vertex_counts.size() - 1; i >= 0; i--) {
+		occ_manager->load_state(first + i);
+		states_match = states_match && occ_manager->get_vertices(0).size() == vertex_counts[i];
+	}
+	CHECK_MESSAGE(states_match, "Undoing to a cold state should bring its shape back.");
+
+	occ_manager->load_state(last);
+	CHECK_MESSAGE(occ_manager->get_vertices(0).size() == vertex_counts[vertex_counts.size() - 1], "Redoing to a cold state should bring its shape back.");
+	CHECK_MESSAGE(PackedInt32Array(occ_manager->get_faces(0)[1]).size() == 12, "A shape read back from the file should keep its triangulation.");
+}
+
+void test_import_cache() {
+	const String path = write_grid_step(2);
+	const String cache_path = path + ".occache";
+	DirAccess::remove_absolute(cache_path);
+
+	Ref<OCCManager> first;
+	first.instantiate();
+	first->import_step(path);
+	REQUIRE(first->get_shape_count() == 1);
+	CHECK_MESSAGE(FileAccess::exists(cache_path), "The import should write a cache next to the STEP file.");
+
+	Ref<OCCManager> second;
+	second.instantiate();
+	second->import_step(path);
+	REQUIRE(second->get_shape_count() == 1);
+	CHECK_MESSAGE(second->get_vertices(0) == first->get_vertices(0), "The cached vertices should be the same as the imported ones.");
+	CHECK_MESSAGE(second->get_edge_count(0) == first->get_edge_count(0), "The cached edges should be the same as the imported ones.");
+	const Array first_arrays = first->get_mesh_arrays(0);
+	const Array second_arrays = second->get_mesh_arrays(0);
+	CHECK_MESSAGE(PackedInt32Array(second_arrays[Mesh::ARRAY_INDEX]) == PackedInt32Array(first_arrays[Mesh::ARRAY_INDEX]),
+			"The cached triangulation should be the same as the imported one.");
+	CHECK_MESSAGE(PackedFloat32Array(second_arrays[Mesh::ARRAY_CUSTOM0]) == PackedFloat32Array(first_arrays[Mesh::ARRAY_CUSTOM0]),
+			"The cached faces should keep their IDs.");
+
+	//Different deflections can't use the cache, the import has to be done again
+	Ref<OCCManager> third;
+	third.instantiate();
+	third->set_linear_deflection(0.05);
+	third->import_step(path);
+	CHECK_MESSAGE(third->get_vertices(0) == first->get_vertices(0), "Importing with other deflections should still work.");
+
+	DirAccess::remove_absolute(cache_path);
+}
+
+} // namespace TestOCCManager
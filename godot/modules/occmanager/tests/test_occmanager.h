@@ -0,0 +1,64 @@
+#ifndef TEST_OCCMANAGER_H
+#define TEST_OCCMANAGER_H
+
+#include "tests/test_macros.h"
+
+//The test bodies live in test_occmanager.cpp because they need the OCC headers,
+//which are only available (with exceptions enabled) to the module's own build environment
+
+namespace TestOCCManager {
+
+void test_import_deduplication(int p_grid_size);
+void test_incremental_append();
+void test_batch_operations();
+void test_batch_undo();
+void test_assembly_parts();
+void test_picking();
+void test_face_extraction();
+void test_shape_occluder();
+void test_cold_undo_states();
+void test_import_cache();
+
+TEST_CASE("[OCCManager] Importing deduplicates shared vertices and edges") {
+	test_import_deduplication(3);
+}
+
+TEST_CASE("[OCCManager] Adding elements appends only the new vertices and edges") {
+	test_incremental_append();
+}
+
+TEST_CASE("[OCCManager] A batch of operations is applied as a single change") {
+	test_batch_operations();
+}
+
+TEST_CASE("[OCCManager] Undoing while a batch is open drops the batch") {
+	test_batch_undo();
+}
+
+TEST_CASE("[OCCManager] Placements of the same part share a single part") {
+	test_assembly_parts();
+}
+
+TEST_CASE("[OCCManager] Picking and box selection find elements through the BVH") {
+	test_picking();
+}
+
+TEST_CASE("[OCCManager] Face buffers filled in parallel match the shape's faces") {
+	test_face_extraction();
+}
+
+TEST_CASE("[OCCManager] Closed solids make an occluder that follows the shape") {
+	test_shape_occluder();
+}
+
+TEST_CASE("[OCCManager] Undo states moved to the undo file can be loaded back") {
+	test_cold_undo_states();
+}
+
+TEST_CASE("[OCCManager] A second import of the same file is loaded from the cache") {
+	test_import_cache();
+}
+
+} // namespace TestOCCManager
+
+#endif // TEST_OCCMANAGER_H
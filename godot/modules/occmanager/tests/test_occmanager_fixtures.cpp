@@ -0,0 +1,43 @@
+#include "test_occmanager_fixtures.h"
+
+#include "core/variant/variant.h"
+#include "tests/test_utils.h"
+
+#include <BRepPrimAPI_MakeBox.hxx>
+#include <BRepPrimAPI_MakeCylinder.hxx>
+#include <BRep_Builder.hxx>
+#include <STEPControl_Writer.hxx>
+#include <TopLoc_Location.hxx>
+#include <TopoDS_Compound.hxx>
+#include <gp_Trsf.hxx>
+
+namespace TestOCCManager {
+
+String write_step(const TopoDS_Shape &p_shape, const String &p_name) {
+	const String path = TestUtils::get_temp_path(p_name + ".step");
+	STEPControl_Writer writer;
+	writer.Transfer(p_shape, STEPControl_AsIs);
+	writer.Write(path.utf8().get_data());
+	return path;
+}
+
+String write_grid_step(int p_size, double p_spacing, bool p_with_cylinders) {
+	BRep_Builder builder;
+	TopoDS_Compound compound;
+	builder.MakeCompound(compound);
+	for (int x = 0; x < p_size; x++) {
+		for (int y = 0; y < p_size; y++) {
+			builder.Add(compound, BRepPrimAPI_MakeBox(gp_Pnt(x * p_spacing, y * p_spacing, 0), 1, 1, 1).Shape());
+			if (p_with_cylinders) {
+				gp_Trsf placement;
+				placement.SetTranslation(gp_Vec(x * p_spacing + 0.5, y * p_spacing + 0.5, 1));
+				builder.Add(compound, BRepPrimAPI_MakeCylinder(0.4, 1).Shape().Moved(TopLoc_Location(placement)));
+			}
+		}
+	}
+
+	//Every variant gets its own file, so tests never import a grid written with other parameters
+	return write_step(compound, vformat("occ_%s_grid_%d_%s", p_with_cylinders ? "part" : "box", p_size, String::num(p_spacing).replace(".", "_")));
+}
+
+} // namespace TestOCCManager
@@ -0,0 +1,22 @@
+#ifndef TEST_OCCMANAGER_FIXTURES_H
+#define TEST_OCCMANAGER_FIXTURES_H
+
+#include "core/string/ustring.h"
+
+//The STEP files the tests and benchmarks import, written to the test temp folder
+//Only the declarations are here since every header of this folder is also included by tests/test_main.cpp, which doesn't have the OCC headers
+
+class TopoDS_Shape;
+
+namespace TestOCCManager {
+
+//Writes p_shape to <temp folder>/<p_name>.step and returns the path
+String write_step(const TopoDS_Shape &p_shape, const String &p_name);
+//Writes a size x size grid of unit boxes, p_spacing apart
+//With a spacing of 1 neighbouring boxes touch and share their vertices and edges, so the import has to deduplicate them
+//With p_with_cylinders each box gets a cylinder on top, so there are curved faces to mesh too
+String write_grid_step(int p_size, double p_spacing = 1, bool p_with_cylinders = false);
+
+} // namespace TestOCCManager
+
+#endif // TEST_OCCMANAGER_FIXTURES_H
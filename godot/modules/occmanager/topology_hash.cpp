@@ -0,0 +1,149 @@
+#include "topology_hash.h"
+
+#include "core/templates/hashfuncs.h"
+
+#include <BRep_Tool.hxx>
+#include <Geom_Curve.hxx>
+#include <TopExp.hxx>
+#include <TopoDS_Vertex.hxx>
+
+#include <cmath>
+
+size_t PointWelder::CellKeyHasher::operator()(const CellKey &key) const {
+    uint32_t h = hash_murmur3_one_64(key.x);
+    h = hash_murmur3_one_64(key.y, h);
+    h = hash_murmur3_one_64(key.z, h);
+    return hash_fmix32(h);
+}
+
+PointWelder::PointWelder(double p_tolerance) {
+    tolerance = p_tolerance;
+}
+
+PointWelder::CellKey PointWelder::cell_of(const gp_Pnt &point) const {
+    return CellKey{
+        (int64_t)std::floor(point.X() / tolerance),
+        (int64_t)std::floor(point.Y() / tolerance),
+        (int64_t)std::floor(point.Z() / tolerance)
+    };
+}
+
+int PointWelder::find(const gp_Pnt &point) const {
+    const CellKey center = cell_of(point);
+    int found = -1;
+
+    //Cells are as big as the tolerance, so any point within tolerance is in this cell or one of its neighbours
+    for (int64_t dx = -1; dx <= 1; dx++) {
+        for (int64_t dy = -1; dy <= 1; dy++) {
+            for (int64_t dz = -1; dz <= 1; dz++) {
+                auto cell = cells.find(CellKey{ center.x + dx, center.y + dy, center.z + dz });
+                if (cell == cells.end()) {
+                    continue;
+                }
+                for (int index : cell->second) {
+                    //Keep the earliest point so the result doesn't depend on the order the cells are visited in
+                    if ((found == -1 || index < found) && point.Distance(points[index]) < tolerance) {
+                        found = index;
+                    }
+                }
+            }
+        }
+    }
+    return found;
+}
+
+int PointWelder::weld(const gp_Pnt &point, bool *r_added) {
+    int index = find(point);
+    if (r_added) {
+        *r_added = index == -1;
+    }
+    if (index != -1) {
+        return index;
+    }
+
+    index = points.size();
+    points.push_back(point);
+    cells[cell_of(point)].push_back(index);
+    return index;
+}
+
+void PointWelder::reserve(size_t count) {
+    points.reserve(count);
+    cells.reserve(count);
+}
+
+void PointWelder::clear() {
+    points.clear();
+    cells.clear();
+}
+
+EdgeDeduplicator::EdgeDeduplicator(double p_tolerance) :
+        endpoints(p_tolerance) {
+    tolerance = p_tolerance;
+}
+
+EdgeDeduplicator::Fingerprint EdgeDeduplicator::make_fingerprint(const TopoDS_Edge &edge) const {
+    Fingerprint fingerprint;
+    Standard_Real first, last;
+    Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, first, last);
+    if (curve.IsNull()) {
+        return fingerprint;
+    }
+
+    fingerprint.has_curve = true;
+    for (int s = 0; s <= FINGERPRINT_SAMPLES; ++s) {
+        Standard_Real t = first + (last - first) * s / FINGERPRINT_SAMPLES;
+        fingerprint.samples[s] = curve->Value(t);
+    }
+    return fingerprint;
+}
+
+bool EdgeDeduplicator::fingerprints_match(const Fingerprint &a, const Fingerprint &b) const {
+    // If we can't get curves, fall back to endpoint-only comparison
+    // This handles degenerate cases
+    if (!a.has_curve || !b.has_curve) {
+        return true;
+    }
+    for (int s = 0; s <= FINGERPRINT_SAMPLES; ++s) {
+        if (a.samples[s].Distance(b.samples[s]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool EdgeDeduplicator::add(const TopoDS_Edge &edge) {
+    TopoDS_Vertex v1, v2;
+    TopExp::Vertices(edge, v1, v2);
+    int id1 = endpoints.weld(BRep_Tool::Pnt(v1));
+    int id2 = endpoints.weld(BRep_Tool::Pnt(v2));
+
+    //Order the endpoints so that the same edge in both directions gets the same key
+    if (id1 > id2) {
+        std::swap(id1, id2);
+    }
+    std::vector<int> &bucket = buckets[((uint64_t)id1 << 32) | (uint32_t)id2];
+
+    Fingerprint fingerprint = make_fingerprint(edge);
+    for (int existing : bucket) {
+        if (fingerprints_match(fingerprint, fingerprints[existing])) {
+            return false;
+        }
+    }
+
+    bucket.push_back(fingerprints.size());
+    fingerprints.push_back(fingerprint);
+    return true;
+}
+
+void EdgeDeduplicator::reserve(size_t count) {
+    endpoints.reserve(count * 2);
+    fingerprints.reserve(count);
+    buckets.reserve(count);
+}
+
+void EdgeDeduplicator::clear() {
+    endpoints.clear();
+    fingerprints.clear();
+    buckets.clear();
+}
@@ -0,0 +1,78 @@
+#ifndef GODOT_TOPOLOGY_HASH_H
+#define GODOT_TOPOLOGY_HASH_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <gp_Pnt.hxx>
+#include <TopoDS_Edge.hxx>
+
+//Merges points that are closer than a tolerance to each other.
+//Points are bucketed in a voxel grid whose cells are as big as the tolerance, so a lookup only has to check
+//the 27 cells around the point instead of every point added so far.
+class PointWelder {
+	struct CellKey {
+		int64_t x, y, z;
+		bool operator==(const CellKey &other) const {
+			return x == other.x && y == other.y && z == other.z;
+		}
+	};
+	struct CellKeyHasher {
+		size_t operator()(const CellKey &key) const;
+	};
+
+	double tolerance;
+	std::vector<gp_Pnt> points;
+	//Each cell holds the indices (in points) of the points inside it
+	std::unordered_map<CellKey, std::vector<int>, CellKeyHasher> cells;
+
+	CellKey cell_of(const gp_Pnt &point) const;
+
+public:
+	//Returns the index of a previously added point closer than tolerance to point, or -1 if there is none
+	int find(const gp_Pnt &point) const;
+
+	//Returns the index of the point that point was merged with
+	//If there was none, point is added and r_added is set to true
+	int weld(const gp_Pnt &point, bool *r_added = nullptr);
+
+	const std::vector<gp_Pnt> &get_points() const { return points; }
+	void reserve(size_t count);
+	void clear();
+
+	explicit PointWelder(double p_tolerance = 1e-6);
+};
+
+//Finds edges that are geometrically identical to an edge that was already added.
+//Edges are hashed by the welded IDs of their two endpoints, so only edges sharing both endpoints get compared.
+//Each edge's curve is sampled once when it is added (its fingerprint), so comparisons never go back to the curve.
+class EdgeDeduplicator {
+	static const int FINGERPRINT_SAMPLES = 4;
+
+	struct Fingerprint {
+		//False when the edge has no 3D curve (degenerate edges), in that case only the endpoints are compared
+		bool has_curve = false;
+		gp_Pnt samples[FINGERPRINT_SAMPLES + 1];
+	};
+
+	double tolerance;
+	PointWelder endpoints;
+	std::vector<Fingerprint> fingerprints;
+	//Key is the two welded endpoint IDs packed together (smallest first), value is the indices in fingerprints of the edges with these endpoints
+	std::unordered_map<uint64_t, std::vector<int>> buckets;
+
+	Fingerprint make_fingerprint(const TopoDS_Edge &edge) const;
+	bool fingerprints_match(const Fingerprint &a, const Fingerprint &b) const;
+
+public:
+	//Returns false if the edge is a duplicate of an edge that was already added, otherwise adds it and returns true
+	bool add(const TopoDS_Edge &edge);
+
+	void reserve(size_t count);
+	void clear();
+
+	explicit EdgeDeduplicator(double p_tolerance = 1e-6);
+};
+
+#endif // GODOT_TOPOLOGY_HASH_H
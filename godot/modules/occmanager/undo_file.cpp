@@ -0,0 +1,75 @@
+#include "undo_file.h"
+
+#include "core/io/compression.h"
+#include "core/io/dir_access.h"
+#include "core/os/os.h"
+
+#include <atomic>
+
+bool UndoFile::append(const std::vector<uint8_t> &p_data, Record &r_record) {
+    if (file.is_null()) {
+        // Several managers can be alive at once (and several editors running), each one gets its own file
+        static std::atomic<uint32_t> file_count{ 0 };
+        const String folder = OS::get_singleton()->get_cache_path().path_join("occmanager");
+        DirAccess::make_dir_recursive_absolute(folder);
+        path = folder.path_join(vformat("undo_%d_%d.bin", OS::get_singleton()->get_process_id(), file_count++));
+        file = FileAccess::open(path, FileAccess::WRITE);
+        if (file.is_null()) {
+            ERR_PRINT("Couldn't create the undo file " + path);
+            return false;
+        }
+        file_size = 0;
+    }
+
+    const int max_size = Compression::get_max_compressed_buffer_size(p_data.size(), Compression::MODE_ZSTD);
+    std::vector<uint8_t> compressed(max_size);
+    const int compressed_size = Compression::compress(compressed.data(), p_data.data(), p_data.size(), Compression::MODE_ZSTD);
+    if (compressed_size < 0) {
+        ERR_PRINT("Couldn't compress an undo snapshot");
+        return false;
+    }
+
+    file->store_buffer(compressed.data(), compressed_size);
+    // The records are read through a separate mapping, it has to see what was just written
+    file->flush();
+    if (file->get_error() != OK) {
+        ERR_PRINT("Couldn't write to the undo file " + path);
+        return false;
+    }
+
+    r_record.offset = file_size;
+    r_record.size = compressed_size;
+    r_record.uncompressed_size = p_data.size();
+    file_size += compressed_size;
+    return true;
+}
+
+bool UndoFile::read(const Record &p_record, std::vector<uint8_t> &r_data) {
+    if (p_record.size == 0 || p_record.offset + p_record.size > file_size) {
+        return false;
+    }
+    if (p_record.offset + p_record.size > mapped.get_size() && !mapped.open(path)) {
+        return false;
+    }
+    if (p_record.offset + p_record.size > mapped.get_size()) {
+        return false;
+    }
+
+    r_data.resize(p_record.uncompressed_size);
+    const int size = Compression::decompress(r_data.data(), r_data.size(), mapped.get_data() + p_record.offset, p_record.size, Compression::MODE_ZSTD);
+    return size == (int)p_record.uncompressed_size;
+}
+
+void UndoFile::clear() {
+    mapped.close();
+    file.unref();
+    if (!path.is_empty()) {
+        DirAccess::remove_absolute(path);
+        path = String();
+    }
+    file_size = 0;
+}
+
+UndoFile::~UndoFile() {
+    clear();
+}
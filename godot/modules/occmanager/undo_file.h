@@ -0,0 +1,46 @@
+#ifndef GODOT_UNDO_FILE_H
+#define GODOT_UNDO_FILE_H
+
+#include <vector>
+#include <cstdint>
+
+#include "core/io/file_access.h"
+#include "shape_cache.h"
+
+//Append-only file holding the undo snapshots that aren't kept in memory.
+//Each record is compressed with zstd, and read back through a MappedFile so only the records that are loaded get paged in.
+//The file is temporary: it is created by the first append (in the OS cache folder) and deleted with the UndoFile.
+//Records are never removed, the space of the states that were dropped is only given back once the file is deleted.
+class UndoFile {
+public:
+	struct Record {
+		uint64_t offset = 0;
+		//Compressed size, 0 for a record that wasn't written
+		uint64_t size = 0;
+		uint64_t uncompressed_size = 0;
+	};
+
+private:
+	String path;
+	Ref<FileAccess> file;
+	uint64_t file_size = 0;
+	//Remapped when a record past its end is read
+	MappedFile mapped;
+
+public:
+	//Returns false if the file couldn't be written
+	bool append(const std::vector<uint8_t> &p_data, Record &r_record);
+	//Returns false if the record couldn't be read
+	bool read(const Record &p_record, std::vector<uint8_t> &r_data);
+	//Deletes the file, the records written so far can't be read anymore
+	void clear();
+
+	uint64_t get_size() const { return file_size; }
+
+	UndoFile() {}
+	UndoFile(const UndoFile &) = delete;
+	UndoFile &operator=(const UndoFile &) = delete;
+	~UndoFile();
+};
+
+#endif // GODOT_UNDO_FILE_H
@@ -198,6 +198,7 @@ RID RaycastOcclusionCull::occluder_allocate() {
 
 void RaycastOcclusionCull::occluder_initialize(RID p_occluder) {
 	Occluder *occluder = memnew(Occluder);
+	occluder->version = ++occluder_version;
 	occluder_owner.initialize_rid(p_occluder, occluder);
 }
 
@@ -207,6 +208,7 @@ void RaycastOcclusionCull::occluder_set_mesh(RID p_occluder, const PackedVector3
 
 	occluder->vertices = p_vertices;
 	occluder->indices = p_indices;
+	occluder->version = ++occluder_version;
 
 	for (const InstanceID &E : occluder->users) {
 		RID scenario_rid = E.scenario;
@@ -284,7 +286,8 @@ void RaycastOcclusionCull::scenario_set_instance(RID p_scenario, RID p_instance,
 
 	if (instance.enabled != p_enabled) {
 		instance.enabled = p_enabled;
-		scenario.dirty = true; // The scenario needs a scene re-build, but the instance doesn't need update
+		scenario._mark_instance_pending(p_instance); // The geometry needs to be attached or detached, but the instance doesn't need update
+		scenario.dirty = true;
 	}
 
 	if (changed && !scenario.dirty_instances.has(p_instance)) {
@@ -352,8 +355,11 @@ void RaycastOcclusionCull::Scenario::_update_dirty_instance(int p_idx, RID *p_in
 		_transform_vertices_range(read_ptr, write_ptr, occ_inst->xform, 0, vertices_size);
 	}
 
-	occ_inst->indices.resize(occ->indices.size());
-	memcpy(occ_inst->indices.ptr(), occ->indices.ptr(), occ->indices.size() * sizeof(int32_t));
+	if (occ_inst->mesh_version != occ->version) {
+		occ_inst->indices.resize(occ->indices.size());
+		memcpy(occ_inst->indices.ptr(), occ->indices.ptr(), occ->indices.size() * sizeof(int32_t));
+		occ_inst->mesh_version = occ->version;
+	}
 }
 
 void RaycastOcclusionCull::Scenario::_transform_vertices_thread(uint32_t p_thread, TransformThreadData *p_data) {
@@ -389,7 +395,81 @@ void RaycastOcclusionCull::Scenario::free() {
 			rtcReleaseScene(ebr_scene[i]);
 			ebr_scene[i] = nullptr;
 		}
+		scene_geometries[i].clear();
+		pending_instances[i].clear();
+	}
+}
+
+void RaycastOcclusionCull::Scenario::_mark_instance_pending(RID p_instance) {
+	// Each scene gets the change the next time it's the one being committed.
+	pending_instances[0].insert(p_instance);
+	pending_instances[1].insert(p_instance);
+}
+
+void RaycastOcclusionCull::Scenario::_update_scene(int p_scene_idx) {
+	RTCScene &scene = ebr_scene[p_scene_idx];
+	HashMap<RID, SceneGeometry> &geometries = scene_geometries[p_scene_idx];
+	HashSet<RID> &pending = pending_instances[p_scene_idx];
+	RTCBuildQuality quality = RTCBuildQuality(raycast_singleton->build_quality);
+
+	if (scene && ebr_scene_quality[p_scene_idx] != quality) {
+		rtcReleaseScene(scene);
+		scene = nullptr;
+	}
+
+	if (!scene) {
+		scene = rtcNewScene(raycast_singleton->ebr_device);
+		// Dynamic scenes get a two-level BVH: one per geometry, and one over those.
+		// Committing only rebuilds the BVHs of the modified geometries before the top level.
+		rtcSetSceneFlags(scene, RTC_SCENE_FLAG_DYNAMIC);
+		rtcSetSceneBuildQuality(scene, quality);
+		ebr_scene_quality[p_scene_idx] = quality;
+
+		geometries.clear();
+		pending.clear();
+		for (const KeyValue<RID, OccluderInstance> &E : instances) {
+			pending.insert(E.key);
+		}
+	}
+
+	for (const RID &instance_rid : pending) {
+		const OccluderInstance *occ_inst = instances.getptr(instance_rid);
+		const Occluder *occ = occ_inst ? raycast_singleton->occluder_owner.get_or_null(occ_inst->occluder) : nullptr;
+		bool visible = occ && occ_inst->enabled && !occ_inst->removed && !occ_inst->indices.is_empty();
+
+		SceneGeometry *geometry = geometries.getptr(instance_rid);
+		if (geometry) {
+			if (visible && geometry->mesh_version == occ_inst->mesh_version && geometry->vertices == occ_inst->xformed_vertices.ptr() && geometry->indices == occ_inst->indices.ptr()) {
+				// Only the transform changed and the vertices were transformed in place, refitting the geometry's BVH is enough.
+				RTCGeometry geom = rtcGetGeometry(scene, geometry->id);
+				rtcUpdateGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0);
+				rtcCommitGeometry(geom);
+				continue;
+			}
+			rtcDetachGeometry(scene, geometry->id);
+			geometries.erase(instance_rid);
+		}
+
+		if (!visible) {
+			continue;
+		}
+
+		RTCGeometry geom = rtcNewGeometry(raycast_singleton->ebr_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+		rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, occ_inst->xformed_vertices.ptr(), 0, sizeof(float) * 3, occ_inst->xformed_vertices.size() / 3);
+		rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, occ_inst->indices.ptr(), 0, sizeof(uint32_t) * 3, occ_inst->indices.size() / 3);
+		rtcSetGeometryBuildQuality(geom, RTC_BUILD_QUALITY_REFIT);
+		rtcCommitGeometry(geom);
+
+		SceneGeometry new_geometry;
+		new_geometry.id = rtcAttachGeometry(scene, geom);
+		new_geometry.mesh_version = occ_inst->mesh_version;
+		new_geometry.vertices = occ_inst->xformed_vertices.ptr();
+		new_geometry.indices = occ_inst->indices.ptr();
+		geometries.insert(instance_rid, new_geometry);
+		rtcReleaseGeometry(geom);
 	}
+
+	pending.clear();
 }
 
 void RaycastOcclusionCull::Scenario::_commit_scene(void *p_ud) {
@@ -419,8 +499,9 @@ void RaycastOcclusionCull::Scenario::update() {
 		return;
 	}
 
-	for (const RID &scenario : removed_instances) {
-		instances.erase(scenario);
+	for (const RID &instance : removed_instances) {
+		instances.erase(instance);
+		_mark_instance_pending(instance);
 	}
 
 	if (dirty_instances_array.size() / WorkerThreadPool::get_singleton()->get_thread_count() > 128) {
@@ -435,6 +516,10 @@ void RaycastOcclusionCull::Scenario::update() {
 		}
 	}
 
+	for (const RID &instance : dirty_instances_array) {
+		_mark_instance_pending(instance);
+	}
+
 	dirty_instances.clear();
 	dirty_instances_array.clear();
 	removed_instances.clear();
@@ -443,31 +528,7 @@ void RaycastOcclusionCull::Scenario::update() {
 		raycast_singleton->_init_embree();
 	}
 
-	int next_scene_idx = 1 - current_scene_idx;
-	RTCScene &next_scene = ebr_scene[next_scene_idx];
-
-	if (next_scene) {
-		rtcReleaseScene(next_scene);
-	}
-
-	next_scene = rtcNewScene(raycast_singleton->ebr_device);
-	rtcSetSceneBuildQuality(next_scene, RTCBuildQuality(raycast_singleton->build_quality));
-
-	for (const KeyValue<RID, OccluderInstance> &E : instances) {
-		const OccluderInstance *occ_inst = &E.value;
-		const Occluder *occ = raycast_singleton->occluder_owner.get_or_null(occ_inst->occluder);
-
-		if (!occ || !occ_inst->enabled) {
-			continue;
-		}
-
-		RTCGeometry geom = rtcNewGeometry(raycast_singleton->ebr_device, RTC_GEOMETRY_TYPE_TRIANGLE);
-		rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, occ_inst->xformed_vertices.ptr(), 0, sizeof(float) * 3, occ_inst->xformed_vertices.size() / 3);
-		rtcSetSharedGeometryBuffer(geom, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, occ_inst->indices.ptr(), 0, sizeof(uint32_t) * 3, occ_inst->indices.size() / 3);
-		rtcCommitGeometry(geom);
-		rtcAttachGeometry(next_scene, geom);
-		rtcReleaseGeometry(geom);
-	}
+	_update_scene(1 - current_scene_idx);
 
 	dirty = false;
 	commit_done = false;
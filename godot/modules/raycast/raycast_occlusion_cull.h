@@ -100,6 +100,7 @@ private:
 		PackedVector3Array vertices;
 		PackedInt32Array indices;
 		HashSet<InstanceID, InstanceID> users;
+		uint64_t version = 0; // Changes every time the mesh is set, unique across occluders.
 	};
 
 	struct OccluderInstance {
@@ -107,6 +108,7 @@ private:
 		LocalVector<uint32_t> indices;
 		LocalVector<float> xformed_vertices;
 		Transform3D xform;
+		uint64_t mesh_version = 0; // Version of the occluder mesh in xformed_vertices and indices.
 		bool enabled = true;
 		bool removed = false;
 	};
@@ -125,11 +127,22 @@ private:
 			float *write = nullptr;
 		};
 
+		// Geometry of an instance in one of the scenes, kept across updates so only the instances that changed are rebuilt.
+		struct SceneGeometry {
+			unsigned int id = RTC_INVALID_GEOMETRY_ID;
+			uint64_t mesh_version = 0;
+			const float *vertices = nullptr;
+			const uint32_t *indices = nullptr;
+		};
+
 		Thread *commit_thread = nullptr;
 		bool commit_done = true;
 		bool dirty = false;
 
 		RTCScene ebr_scene[2] = { nullptr, nullptr };
+		RTCBuildQuality ebr_scene_quality[2] = { RTC_BUILD_QUALITY_MEDIUM, RTC_BUILD_QUALITY_MEDIUM };
+		HashMap<RID, SceneGeometry> scene_geometries[2];
+		HashSet<RID> pending_instances[2]; // Instances whose geometry is out of date in each scene.
 		int current_scene_idx = 0;
 
 		HashMap<RID, OccluderInstance> instances;
@@ -141,6 +154,8 @@ private:
 		void _update_dirty_instance(int p_idx, RID *p_instances);
 		void _transform_vertices_thread(uint32_t p_thread, TransformThreadData *p_data);
 		void _transform_vertices_range(const Vector3 *p_read, float *p_write, const Transform3D &p_xform, int p_from, int p_to);
+		void _mark_instance_pending(RID p_instance);
+		void _update_scene(int p_scene_idx);
 		static void _commit_scene(void *p_ud);
 		void free();
 		void update();
@@ -156,6 +171,7 @@ private:
 
 	RTCDevice ebr_device = nullptr;
 	RID_PtrOwner<Occluder> occluder_owner;
+	uint64_t occluder_version = 0;
 	HashMap<RID, Scenario> scenarios;
 	HashMap<RID, RaycastHZBuffer> buffers;
 	RS::ViewportOcclusionCullingBuildQuality build_quality;
@@ -43,8 +43,9 @@ void initialize_raycast_module(ModuleInitializationLevel p_level) {
 
 #ifdef TOOLS_ENABLED
 	LightmapRaycasterEmbree::make_default_raycaster();
-	StaticRaycasterEmbree::make_default_raycaster();
 #endif
+	GDREGISTER_INTERNAL_CLASS(StaticRaycasterEmbree);
+	StaticRaycasterEmbree::make_default_raycaster();
 	raycast_occlusion_cull = memnew(RaycastOcclusionCull);
 }
 
@@ -56,7 +57,5 @@ void uninitialize_raycast_module(ModuleInitializationLevel p_level) {
 	if (raycast_occlusion_cull) {
 		memdelete(raycast_occlusion_cull);
 	}
-#ifdef TOOLS_ENABLED
 	StaticRaycasterEmbree::free();
-#endif
 }
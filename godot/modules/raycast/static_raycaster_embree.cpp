@@ -30,7 +30,7 @@
 
 #include "static_raycaster_embree.h"
 
-#ifdef TOOLS_ENABLED
+#include "core/object/worker_thread_pool.h"
 
 #ifdef __SSE2__
 #include <pmmintrin.h>
@@ -63,22 +63,105 @@ bool StaticRaycasterEmbree::intersect(Ray &r_ray) {
 }
 
 void StaticRaycasterEmbree::intersect(Vector<Ray> &r_rays) {
-	Ray *rays = r_rays.ptrw();
-	for (int i = 0; i < r_rays.size(); ++i) {
-		intersect(rays[i]);
+	int ray_count = r_rays.size();
+	if (ray_count == 0) {
+		return;
 	}
+
+	IntersectThreadData td;
+	td.rays = r_rays.ptrw();
+	td.ray_count = ray_count;
+
+	int task_rays = PACKET_SIZE * PACKETS_PER_TASK;
+	int task_count = (ray_count + task_rays - 1) / task_rays;
+	if (task_count == 1) {
+		_intersect_packets(td.rays, 0, ray_count);
+		return;
+	}
+
+	WorkerThreadPool::GroupID group_task = WorkerThreadPool::get_singleton()->add_template_group_task(this, &StaticRaycasterEmbree::_intersect_threaded, &td, task_count, -1, true, SNAME("StaticRaycasterIntersect"));
+	WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group_task);
 }
 
-void StaticRaycasterEmbree::add_mesh(const PackedVector3Array &p_vertices, const PackedInt32Array &p_indices, unsigned int p_id) {
-	RTCGeometry embree_mesh = rtcNewGeometry(embree_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+void StaticRaycasterEmbree::_intersect_threaded(uint32_t p_task, const IntersectThreadData *p_data) {
+	int task_rays = PACKET_SIZE * PACKETS_PER_TASK;
+	int from = p_task * task_rays;
+	int to = MIN(from + task_rays, p_data->ray_count);
+	_intersect_packets(p_data->rays, from, to);
+}
 
+void StaticRaycasterEmbree::_intersect_packets(Ray *r_rays, int p_from, int p_to) const {
+	RTCRayQueryContext context;
+	rtcInitRayQueryContext(&context);
+	RTCIntersectArguments args;
+	rtcInitIntersectArguments(&args);
+	args.context = &context;
+
+	// Packets of 4 are the widest the bundled Embree has a packet intersector for, wider ones would be traced one ray at a time.
+	alignas(16) int valid[PACKET_SIZE];
+	RTCRayHit4 packet;
+
+	for (int i = p_from; i < p_to; i += PACKET_SIZE) {
+		int count = MIN(PACKET_SIZE, p_to - i);
+
+		for (int j = 0; j < PACKET_SIZE; j++) {
+			valid[j] = j < count ? -1 : 0;
+			if (j >= count) {
+				continue;
+			}
+			const Ray &ray = r_rays[i + j];
+			packet.ray.org_x[j] = ray.org.x;
+			packet.ray.org_y[j] = ray.org.y;
+			packet.ray.org_z[j] = ray.org.z;
+			packet.ray.tnear[j] = ray.tnear;
+			packet.ray.dir_x[j] = ray.dir.x;
+			packet.ray.dir_y[j] = ray.dir.y;
+			packet.ray.dir_z[j] = ray.dir.z;
+			packet.ray.time[j] = ray.time;
+			packet.ray.tfar[j] = ray.tfar;
+			packet.ray.mask[j] = ray.mask;
+			packet.ray.id[j] = ray.id;
+			packet.ray.flags[j] = 0;
+			packet.hit.geomID[j] = RTC_INVALID_GEOMETRY_ID;
+			packet.hit.primID[j] = RTC_INVALID_GEOMETRY_ID;
+			packet.hit.instID[0][j] = RTC_INVALID_GEOMETRY_ID;
+		}
+
+		rtcIntersect4(valid, embree_scene, &packet, &args);
+
+		for (int j = 0; j < count; j++) {
+			Ray &ray = r_rays[i + j];
+			ray.tfar = packet.ray.tfar[j];
+			ray.normal = Vector3(packet.hit.Ng_x[j], packet.hit.Ng_y[j], packet.hit.Ng_z[j]);
+			ray.u = packet.hit.u[j];
+			ray.v = packet.hit.v[j];
+			ray.primID = packet.hit.primID[j];
+			ray.geomID = packet.hit.geomID[j];
+			ray.instID = packet.hit.instID[0][j];
+		}
+	}
+}
+
+void StaticRaycasterEmbree::add_mesh(const PackedVector3Array &p_vertices, const PackedInt32Array &p_indices, unsigned int p_id) {
 	int vertex_count = p_vertices.size();
 
+	// Embree doesn't validate indices, so check everything before creating the geometry.
+	if (p_indices.is_empty()) {
+		ERR_FAIL_COND_MSG(vertex_count % 3 != 0, "The vertex count must be a multiple of 3 when no indices are given.");
+	} else {
+		ERR_FAIL_COND_MSG(p_indices.size() % 3 != 0, "The index count must be a multiple of 3.");
+		const int32_t *indices = p_indices.ptr();
+		for (int i = 0; i < p_indices.size(); i++) {
+			ERR_FAIL_COND_MSG(indices[i] < 0 || indices[i] >= vertex_count, vformat("Mesh index %d is out of range, the mesh has %d vertices.", indices[i], vertex_count));
+		}
+	}
+
+	RTCGeometry embree_mesh = rtcNewGeometry(embree_device, RTC_GEOMETRY_TYPE_TRIANGLE);
+
 	Vector3 *embree_vertices = (Vector3 *)rtcSetNewGeometryBuffer(embree_mesh, RTC_BUFFER_TYPE_VERTEX, 0, RTC_FORMAT_FLOAT3, sizeof(Vector3), vertex_count);
 	memcpy(embree_vertices, p_vertices.ptr(), sizeof(Vector3) * vertex_count);
 
 	if (p_indices.is_empty()) {
-		ERR_FAIL_COND(vertex_count % 3 != 0);
 		uint32_t *embree_triangles = (uint32_t *)rtcSetNewGeometryBuffer(embree_mesh, RTC_BUFFER_TYPE_INDEX, 0, RTC_FORMAT_UINT3, sizeof(uint32_t) * 3, vertex_count / 3);
 		for (int i = 0; i < vertex_count; i++) {
 			embree_triangles[i] = i;
@@ -137,4 +220,3 @@ StaticRaycasterEmbree::~StaticRaycasterEmbree() {
 	}
 }
 
-#endif // TOOLS_ENABLED
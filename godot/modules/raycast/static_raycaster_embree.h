@@ -31,8 +31,6 @@
 #ifndef STATIC_RAYCASTER_EMBREE_H
 #define STATIC_RAYCASTER_EMBREE_H
 
-#ifdef TOOLS_ENABLED
-
 #include "core/math/static_raycaster.h"
 
 #include <embree4/rtcore.h>
@@ -41,11 +39,22 @@ class StaticRaycasterEmbree : public StaticRaycaster {
 	GDCLASS(StaticRaycasterEmbree, StaticRaycaster);
 
 private:
+	static const int PACKET_SIZE = 4;
+	static const int PACKETS_PER_TASK = 256;
+
+	struct IntersectThreadData {
+		Ray *rays = nullptr;
+		int ray_count = 0;
+	};
+
 	static RTCDevice embree_device;
 	RTCScene embree_scene;
 
 	HashSet<int> filter_meshes;
 
+	void _intersect_packets(Ray *r_rays, int p_from, int p_to) const;
+	void _intersect_threaded(uint32_t p_task, const IntersectThreadData *p_data);
+
 public:
 	virtual bool intersect(Ray &p_ray) override;
 	virtual void intersect(Vector<Ray> &r_rays) override;
@@ -64,6 +73,4 @@ public:
 	~StaticRaycasterEmbree();
 };
 
-#endif // TOOLS_ENABLED
-
 #endif // STATIC_RAYCASTER_EMBREE_H
@@ -0,0 +1,128 @@
+/**************************************************************************/
+/*  test_static_raycaster.h                                               */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_STATIC_RAYCASTER_H
+#define TEST_STATIC_RAYCASTER_H
+
+#include "core/math/static_raycaster.h"
+
+#include "tests/test_macros.h"
+
+namespace TestStaticRaycaster {
+
+static Array intersect_center(const Ref<StaticRaycaster> &p_raycaster) {
+	PackedVector3Array origins = { Vector3(0, 0, -1) };
+	PackedVector3Array directions = { Vector3(0, 0, 1) };
+	Dictionary result = p_raycaster->call("intersect_rays", origins, directions, 10.0f);
+	return Array(result["geometry_ids"]);
+}
+
+TEST_CASE("[StaticRaycaster] Reject invalid meshes") {
+	Ref<StaticRaycaster> raycaster = StaticRaycaster::create();
+	REQUIRE(raycaster.is_valid());
+
+	const PackedVector3Array vertices = { Vector3(-1, -1, 0), Vector3(1, -1, 0), Vector3(0, 1, 0) };
+
+	ERR_PRINT_OFF;
+	// Not a whole number of triangles.
+	raycaster->call("add_mesh", vertices, PackedInt32Array({ 0, 1, 2, 0 }), 0);
+	raycaster->call("add_mesh", PackedVector3Array({ Vector3(), Vector3(1, 0, 0) }), PackedInt32Array(), 0);
+	// Indices outside of the vertex array.
+	raycaster->call("add_mesh", vertices, PackedInt32Array({ 0, 1, 3 }), 0);
+	raycaster->call("add_mesh", vertices, PackedInt32Array({ -1, 1, 2 }), 0);
+	ERR_PRINT_ON;
+
+	raycaster->call("commit");
+	CHECK_MESSAGE(int(intersect_center(raycaster)[0]) == -1, "Rejected meshes should not be added.");
+
+	raycaster->call("add_mesh", vertices, PackedInt32Array({ 0, 1, 2 }), 1);
+	raycaster->call("commit");
+	CHECK_MESSAGE(int(intersect_center(raycaster)[0]) == 1, "A valid mesh should be hit.");
+}
+
+TEST_CASE("[StaticRaycaster] Intersect a large batch of rays") {
+	Ref<StaticRaycaster> raycaster = StaticRaycaster::create();
+	REQUIRE(raycaster.is_valid());
+
+	// A unit square at z = 0, triangle 0 is below its diagonal (y < x) and triangle 1 above it.
+	const PackedVector3Array vertices = { Vector3(0, 0, 0), Vector3(1, 0, 0), Vector3(1, 1, 0), Vector3(0, 1, 0) };
+	raycaster->call("add_mesh", vertices, PackedInt32Array({ 0, 1, 2, 0, 2, 3 }), 3);
+	raycaster->call("commit");
+
+	// Not a multiple of the packet size, and enough rays to be split over several tasks.
+	const int ray_count = 3001;
+	const float max_distance = 3.75f;
+	PackedVector3Array origins;
+	PackedVector3Array directions;
+	PackedFloat32Array expected_distances;
+	PackedInt32Array expected_primitive_ids;
+	for (int i = 0; i < ray_count; i++) {
+		// Spread over a grid larger than the square, the offsets keep rays off its edges and diagonal.
+		const float x = -0.5f + ((i % 50) + 0.3f) / 25.0f;
+		const float y = -0.5f + ((i / 50 % 50) + 0.7f) / 25.0f;
+		// The farthest rays start past max_distance and have to miss.
+		const float distance = 1.0f + (i % 8) * 0.5f;
+		origins.push_back(Vector3(x, y, -distance));
+		directions.push_back(Vector3(0, 0, 1));
+
+		const bool hit = x > 0 && x < 1 && y > 0 && y < 1 && distance <= max_distance;
+		expected_distances.push_back(hit ? distance : -1.0f);
+		expected_primitive_ids.push_back(hit ? (y < x ? 0 : 1) : -1);
+	}
+
+	Dictionary result = raycaster->call("intersect_rays", origins, directions, max_distance);
+	const PackedFloat32Array distances = result["distances"];
+	const PackedInt32Array primitive_ids = result["primitive_ids"];
+	const PackedInt32Array geometry_ids = result["geometry_ids"];
+	REQUIRE(distances.size() == ray_count);
+	REQUIRE(primitive_ids.size() == ray_count);
+	REQUIRE(geometry_ids.size() == ray_count);
+
+	int hits = 0;
+	int wrong_distances = 0;
+	int wrong_primitives = 0;
+	int wrong_geometries = 0;
+	for (int i = 0; i < ray_count; i++) {
+		const bool hit = expected_primitive_ids[i] != -1;
+		hits += hit;
+		wrong_distances += !Math::is_equal_approx(distances[i], expected_distances[i], 1e-4f);
+		wrong_primitives += primitive_ids[i] != expected_primitive_ids[i];
+		wrong_geometries += geometry_ids[i] != (hit ? 3 : -1);
+	}
+	REQUIRE_MESSAGE(hits > 0, "Some of the rays should hit the square.");
+	REQUIRE_MESSAGE(hits < ray_count, "Some of the rays should miss the square.");
+	CHECK_MESSAGE(wrong_distances == 0, "Hits should be at the distance to the square, misses at -1.");
+	CHECK_MESSAGE(wrong_primitives == 0, "Hits should report the triangle they hit, misses -1.");
+	CHECK_MESSAGE(wrong_geometries == 0, "Hits should report the mesh ID, misses -1.");
+}
+
+} // namespace TestStaticRaycaster
+
+#endif // TEST_STATIC_RAYCASTER_H
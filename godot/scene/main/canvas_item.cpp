@@ -445,7 +445,7 @@ void CanvasItem::queue_redraw() {
 
 	pending_update = true;
 
-	callable_mp(this, &CanvasItem::_redraw_callback).call_deferred();
+	MessageQueue::get_singleton()->push_typed_call(this, &CanvasItem::_redraw_callback);
 }
 
 void CanvasItem::move_to_front() {
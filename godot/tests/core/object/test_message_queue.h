@@ -0,0 +1,116 @@
+/**************************************************************************/
+/*  test_message_queue.h                                                  */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_MESSAGE_QUEUE_H
+#define TEST_MESSAGE_QUEUE_H
+
+#include "core/object/message_queue.h"
+#include "core/os/thread.h"
+#include "tests/test_macros.h"
+
+namespace TestMessageQueue {
+
+class TypedCallTarget : public Object {
+public:
+	LocalVector<int> values;
+	String last_text;
+
+	void record(int p_value) { values.push_back(p_value); }
+	void record_text(const String &p_text, int p_value) {
+		last_text = p_text;
+		values.push_back(p_value);
+	}
+};
+
+TEST_CASE("[MessageQueue] Typed calls keep their arguments and run in order with other messages") {
+	TypedCallTarget *target = memnew(TypedCallTarget);
+
+	MessageQueue::get_singleton()->push_typed_call(target, &TypedCallTarget::record, 1);
+	callable_mp(target, &TypedCallTarget::record).call_deferred(2);
+	MessageQueue::get_singleton()->push_typed_call(target, &TypedCallTarget::record_text, String("typed"), 3);
+	CHECK(target->values.is_empty());
+
+	MessageQueue::get_singleton()->flush();
+
+	REQUIRE(target->values.size() == 3);
+	CHECK(target->values[0] == 1);
+	CHECK(target->values[1] == 2);
+	CHECK(target->values[2] == 3);
+	CHECK(target->last_text == "typed");
+
+	memdelete(target);
+}
+
+TEST_CASE("[MessageQueue] Typed calls to freed objects are skipped") {
+	TypedCallTarget *target = memnew(TypedCallTarget);
+	TypedCallTarget *freed_target = memnew(TypedCallTarget);
+
+	MessageQueue::get_singleton()->push_typed_call(freed_target, &TypedCallTarget::record, 1);
+	MessageQueue::get_singleton()->push_typed_call(target, &TypedCallTarget::record, 2);
+	memdelete(freed_target);
+
+	MessageQueue::get_singleton()->flush();
+
+	REQUIRE(target->values.size() == 1);
+	CHECK(target->values[0] == 2);
+
+	memdelete(target);
+}
+
+static void push_typed_calls_from_thread(void *p_target) {
+	TypedCallTarget *target = (TypedCallTarget *)p_target;
+	for (int i = 0; i < 1000; i++) {
+		MessageQueue::get_singleton()->push_typed_call(target, &TypedCallTarget::record, i);
+	}
+}
+
+TEST_CASE("[MessageQueue] Typed calls pushed from other threads are merged on flush") {
+	TypedCallTarget *target = memnew(TypedCallTarget);
+
+	Thread thread;
+	thread.start(&push_typed_calls_from_thread, target);
+	thread.wait_to_finish();
+
+	// The thread has exited, so its buffer is also released by this flush.
+	MessageQueue::get_singleton()->flush();
+
+	REQUIRE(target->values.size() == 1000);
+	bool in_order = true;
+	for (int i = 0; i < 1000; i++) {
+		in_order &= target->values[i] == i;
+	}
+	CHECK(in_order);
+
+	memdelete(target);
+}
+
+} // namespace TestMessageQueue
+
+#endif // TEST_MESSAGE_QUEUE_H
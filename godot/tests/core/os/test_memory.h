@@ -0,0 +1,77 @@
+/**************************************************************************/
+/*  test_memory.h                                                         */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_MEMORY_H
+#define TEST_MEMORY_H
+
+#include "core/os/engine_allocator.h"
+#include "core/os/memory.h"
+
+#include "tests/test_macros.h"
+
+namespace TestMemory {
+
+TEST_CASE("[Memory] Reallocation keeps contents across size classes") {
+	// Grows through every small size class into the system heap and back.
+	const size_t sizes[] = { 1, 17, 100, 128, 129, 500, 1000, 4000, 100000, 700, 40, 3 };
+
+	uint8_t *mem = (uint8_t *)memalloc(sizes[0]);
+	mem[0] = 0;
+	size_t prev_size = sizes[0];
+	bool kept = true;
+	for (size_t size : sizes) {
+		mem = (uint8_t *)memrealloc(mem, size);
+		REQUIRE(mem != nullptr);
+		CHECK(((uintptr_t)mem % alignof(max_align_t)) == 0);
+		for (size_t i = 0; i < MIN(prev_size, size); i++) {
+			kept &= mem[i] == uint8_t(i * 7);
+		}
+		for (size_t i = 0; i < size; i++) {
+			mem[i] = uint8_t(i * 7);
+		}
+		prev_size = size;
+	}
+	CHECK(kept);
+	memfree(mem);
+}
+
+TEST_CASE("[Memory] Size classes") {
+	for (size_t size = 1; size <= EngineAllocator::SMALL_MAX_SIZE; size++) {
+		const uint32_t size_class = EngineAllocator::get_size_class(size);
+		CHECK_MESSAGE(EngineAllocator::size_classes[size_class] >= size, "The size class must fit the block.");
+		if (size_class > 0) {
+			CHECK_MESSAGE(EngineAllocator::size_classes[size_class - 1] < size, "The smallest fitting size class must be used.");
+		}
+	}
+}
+
+} // namespace TestMemory
+
+#endif // TEST_MEMORY_H
@@ -0,0 +1,172 @@
+/**************************************************************************/
+/*  test_string_name.h                                                    */
+/**************************************************************************/
+/*                         This file is part of:                          */
+/*                             GODOT ENGINE                               */
+/*                        https://godotengine.org                         */
+/**************************************************************************/
+/* Copyright (c) 2014-present Godot Engine contributors (see AUTHORS.md). */
+/* Copyright (c) 2007-2014 Juan Linietsky, Ariel Manzur.                  */
+/*                                                                        */
+/* Permission is hereby granted, free of charge, to any person obtaining  */
+/* a copy of this software and associated documentation files (the        */
+/* "Software"), to deal in the Software without restriction, including    */
+/* without limitation the rights to use, copy, modify, merge, publish,    */
+/* distribute, sublicense, and/or sell copies of the Software, and to     */
+/* permit persons to whom the Software is furnished to do so, subject to  */
+/* the following conditions:                                              */
+/*                                                                        */
+/* The above copyright notice and this permission notice shall be         */
+/* included in all copies or substantial portions of the Software.        */
+/*                                                                        */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,        */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF     */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. */
+/* IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY   */
+/* CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,   */
+/* TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE      */
+/* SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.                 */
+/**************************************************************************/
+
+#ifndef TEST_STRING_NAME_H
+#define TEST_STRING_NAME_H
+
+#include "core/object/worker_thread_pool.h"
+#include "core/string/string_name.h"
+
+#include "tests/test_macros.h"
+#include "tests/test_utils.h"
+
+namespace TestStringName {
+
+TEST_CASE("[StringName] Interning") {
+	const String text = "test_string_name_interning";
+	const StringName from_string = StringName(text);
+	const StringName from_cstring = StringName("test_string_name_interning");
+	const StringName from_static = StringName(StaticCString::create("test_string_name_interning"));
+
+	CHECK(from_string == from_cstring);
+	CHECK(from_string == from_static);
+	CHECK(from_string == text);
+	CHECK(from_string.data_unique_pointer() == from_static.data_unique_pointer());
+	CHECK(StringName::search(text) == from_string);
+	CHECK(StringName::search(U"test_string_name_interning") == from_string);
+
+	CHECK(StringName::search("test_string_name_never_interned") == StringName());
+	CHECK(StringName() == String());
+}
+
+TEST_CASE("[StringName] Many names") {
+	// Enough names to make every shard grow a few times.
+	const int count = 200000;
+
+	LocalVector<StringName> names;
+	names.resize(count);
+	for (int i = 0; i < count; i++) {
+		names[i] = StringName("test_string_name_many_" + itos(i));
+	}
+
+	bool all_found = true;
+	for (int i = 0; i < count; i++) {
+		all_found &= StringName::search("test_string_name_many_" + itos(i)) == names[i];
+	}
+	CHECK(all_found);
+
+	names.clear();
+
+	bool none_found = true;
+	for (int i = 0; i < count; i += 97) {
+		none_found &= StringName::search("test_string_name_many_" + itos(i)) == StringName();
+	}
+	CHECK(none_found);
+}
+
+static LocalVector<String> concurrent_texts;
+static LocalVector<StringName> concurrent_held;
+static SafeNumeric<uint32_t> concurrent_errors;
+
+static void static_concurrent_test(void *p_arg, uint32_t p_index) {
+	const uint32_t count = concurrent_texts.size();
+	for (uint32_t i = 0; i < count; i++) {
+		const uint32_t idx = (p_index * 7919 + i) % count;
+		const StringName name = StringName(concurrent_texts[idx]);
+		if (idx < concurrent_held.size()) {
+			// Held by the main thread, so it must resolve to the same entry.
+			if (name != concurrent_held[idx] || StringName::search(concurrent_texts[idx]) != name) {
+				concurrent_errors.increment();
+			}
+		} else if (name != concurrent_texts[idx]) {
+			// Created and freed all the time by the other tasks.
+			concurrent_errors.increment();
+		}
+	}
+}
+
+TEST_CASE("[StringName] Concurrent interning") {
+	const uint32_t count = 20000;
+	concurrent_texts.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		concurrent_texts[i] = "test_string_name_concurrent_" + itos(i);
+	}
+	concurrent_held.resize(count / 2);
+	for (uint32_t i = 0; i < count / 2; i++) {
+		concurrent_held[i] = StringName(concurrent_texts[i]);
+	}
+	concurrent_errors.set(0);
+
+	WorkerThreadPool::GroupID group = WorkerThreadPool::get_singleton()->add_native_group_task(static_concurrent_test, nullptr, 64, -1, true);
+	WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group);
+
+	CHECK(concurrent_errors.get() == 0);
+
+	concurrent_held.clear();
+	concurrent_texts.clear();
+}
+
+static LocalVector<String> benchmark_texts;
+
+static void static_benchmark_intern(void *p_arg, uint32_t p_index) {
+	const uint32_t count = benchmark_texts.size();
+	for (uint32_t i = 0; i < count; i++) {
+		const StringName name = StringName(benchmark_texts[(p_index * 31 + i) % count]);
+	}
+}
+
+TEST_CASE("[StringName] Benchmark contended interning" * doctest::skip()) {
+	const uint32_t count = 50000;
+	const int tasks = 256;
+	const int runs = 5;
+
+	benchmark_texts.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		benchmark_texts[i] = "test_string_name_benchmark_" + itos(i);
+	}
+
+	// Existing names are the common case (method names, node paths, SNAME misses); transient
+	// ones are created and freed by whichever task gets there first and last.
+	LocalVector<StringName> held;
+	for (int mode = 0; mode < 2; mode++) {
+		const bool existing = mode == 0;
+		if (existing) {
+			held.resize(count);
+			for (uint32_t i = 0; i < count; i++) {
+				held[i] = StringName(benchmark_texts[i]);
+			}
+		} else {
+			held.clear();
+		}
+
+		const uint64_t best_usec = TestUtils::get_best_run_usec(runs, [&]() {
+			WorkerThreadPool::GroupID group = WorkerThreadPool::get_singleton()->add_native_group_task(static_benchmark_intern, nullptr, tasks, -1, true);
+			WorkerThreadPool::get_singleton()->wait_for_group_task_completion(group);
+		});
+
+		MESSAGE(TestUtils::format_pool_throughput(existing ? "Existing names" : "Transient names", (uint64_t)count * tasks, "constructions", best_usec));
+	}
+
+	benchmark_texts.clear();
+}
+
+} // namespace TestStringName
+
+#endif // TEST_STRING_NAME_H
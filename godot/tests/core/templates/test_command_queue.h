@@ -561,6 +561,121 @@ TEST_CASE("[CommandQueue] Test Parameter Passing Semantics") {
 
 	sts.destroy_threads();
 }
+
+class MultiProducerState {
+public:
+	static const int PRODUCER_COUNT = 4;
+	static const int COMMANDS_PER_PRODUCER = 4096;
+
+	// A tiny ring, so producers keep filling it up and falling back to the locked path.
+	CommandQueueMT command_queue{ 1 };
+	Thread producers[PRODUCER_COUNT];
+	SafeNumeric<int> producers_done;
+	int next_sequence[PRODUCER_COUNT] = {};
+	int out_of_order_count = 0;
+	int executed_count = 0;
+
+	void record(int p_producer, int p_sequence) {
+		if (next_sequence[p_producer] != p_sequence) {
+			out_of_order_count++;
+		}
+		next_sequence[p_producer] = p_sequence + 1;
+		executed_count++;
+	}
+
+	void producer_loop(int p_producer) {
+		for (int i = 0; i < COMMANDS_PER_PRODUCER; i++) {
+			if (i % 512 == 511) {
+				command_queue.sync();
+			}
+			command_queue.push(this, &MultiProducerState::record, p_producer, i);
+		}
+		producers_done.increment();
+	}
+};
+
+static MultiProducerState *multi_producer_state = nullptr;
+
+static void multi_producer_thread(void *p_producer) {
+	multi_producer_state->producer_loop((int)(intptr_t)p_producer);
+}
+
+TEST_CASE("[CommandQueue] Keep each producer's order with many producers") {
+	MultiProducerState mps;
+	multi_producer_state = &mps;
+
+	for (int i = 0; i < MultiProducerState::PRODUCER_COUNT; i++) {
+		mps.producers[i].start(&multi_producer_thread, (void *)(intptr_t)i);
+	}
+
+	// This thread is the consumer.
+	while (mps.producers_done.get() < MultiProducerState::PRODUCER_COUNT) {
+		mps.command_queue.flush_all();
+	}
+	for (int i = 0; i < MultiProducerState::PRODUCER_COUNT; i++) {
+		mps.producers[i].wait_to_finish();
+	}
+	mps.command_queue.flush_all();
+	multi_producer_state = nullptr;
+
+	CHECK_MESSAGE(mps.out_of_order_count == 0, "Commands from each producer should run in the order they were pushed.");
+	CHECK_MESSAGE(mps.executed_count == MultiProducerState::PRODUCER_COUNT * MultiProducerState::COMMANDS_PER_PRODUCER, "Every command should have run exactly once.");
+}
+class StarvationState {
+public:
+	CommandQueueMT command_queue;
+	Thread spammer;
+	Thread syncer;
+	SafeFlag stop_spamming;
+	SafeFlag synced;
+	int executed_count = 0;
+	int pushed_count = 0;
+
+	void count() {
+		executed_count++;
+	}
+
+	void spammer_loop() {
+		while (!stop_spamming.is_set()) {
+			command_queue.push(this, &StarvationState::count);
+			pushed_count++;
+		}
+	}
+
+	void syncer_loop() {
+		command_queue.sync();
+		synced.set();
+	}
+};
+
+static StarvationState *starvation_state = nullptr;
+
+TEST_CASE("[CommandQueue] A producer that keeps pushing to the ring doesn't hold back sync commands") {
+	StarvationState ss;
+	starvation_state = &ss;
+
+	ss.spammer.start([](void *) { starvation_state->spammer_loop(); }, nullptr);
+	// Let the ring fill with commands before the sync command goes to the locked path.
+	OS::get_singleton()->delay_usec(1000);
+	ss.syncer.start([](void *) { starvation_state->syncer_loop(); }, nullptr);
+
+	// Every flush only drains what the ring had when it started, so each of them returns
+	// even though the spammer never stops, and the sync command runs in one of them.
+	int flushes = 0;
+	while (!ss.synced.is_set()) {
+		ss.command_queue.flush_all();
+		flushes++;
+	}
+	ss.stop_spamming.set();
+	ss.syncer.wait_to_finish();
+	ss.spammer.wait_to_finish();
+	ss.command_queue.flush_all();
+	starvation_state = nullptr;
+
+	CHECK(flushes > 0);
+	CHECK_MESSAGE(ss.executed_count == ss.pushed_count, "Every command pushed to the ring should have run.");
+}
+
 } // namespace TestCommandQueue
 
 #endif // TEST_COMMAND_QUEUE_H
@@ -34,6 +34,7 @@
 #include "core/object/worker_thread_pool.h"
 
 #include "tests/test_macros.h"
+#include "tests/test_utils.h"
 
 namespace TestWorkerThreadPool {
 
@@ -173,6 +174,55 @@ TEST_CASE("[WorkerThreadPool] Run a yielding daemon as the only hope for other t
 	CHECK_MESSAGE(all_needed_yield, "All legit tasks should have needed the daemon yielding to run.");
 }
 
+static SafeNumeric<uint64_t> benchmark_leaf_count;
+
+static void static_benchmark_leaf(void *p_arg) {
+	benchmark_leaf_count.increment();
+}
+
+static void static_benchmark_spawner(void *p_arg) {
+	const int children = (int)(uintptr_t)p_arg;
+	LocalVector<WorkerThreadPool::TaskID> child_ids;
+	child_ids.resize(children);
+	for (int i = 0; i < children; i++) {
+		child_ids[i] = WorkerThreadPool::get_singleton()->add_native_task(static_benchmark_leaf, nullptr, true);
+	}
+	for (int i = 0; i < children; i++) {
+		WorkerThreadPool::get_singleton()->wait_for_task_completion(child_ids[i]);
+	}
+}
+
+TEST_CASE("[WorkerThreadPool] Benchmark work stealing against the shared queue" * doctest::skip()) {
+	const int spawners = 512;
+	const int children = 64;
+	const int runs = 5;
+	const bool work_stealing_backup = WorkerThreadPool::get_singleton()->is_work_stealing_enabled();
+
+	// Tasks spawning more tasks from pool threads, which is where the deques are used.
+	for (int mode = 0; mode < 2; mode++) {
+		const bool work_stealing = mode == 1;
+		WorkerThreadPool::get_singleton()->set_work_stealing_enabled(work_stealing);
+
+		const uint64_t best_usec = TestUtils::get_best_run_usec(runs, [&]() {
+			benchmark_leaf_count.set(0);
+
+			LocalVector<WorkerThreadPool::TaskID> spawner_ids;
+			spawner_ids.resize(spawners);
+			for (int i = 0; i < spawners; i++) {
+				spawner_ids[i] = WorkerThreadPool::get_singleton()->add_native_task(static_benchmark_spawner, (void *)(uintptr_t)children, true);
+			}
+			for (int i = 0; i < spawners; i++) {
+				WorkerThreadPool::get_singleton()->wait_for_task_completion(spawner_ids[i]);
+			}
+		});
+		CHECK(benchmark_leaf_count.get() == (uint64_t)spawners * children);
+
+		MESSAGE(TestUtils::format_pool_throughput(work_stealing ? "Work stealing" : "Shared queue", (uint64_t)spawners * (children + 1), "tasks", best_usec));
+	}
+
+	WorkerThreadPool::get_singleton()->set_work_stealing_enabled(work_stealing_backup);
+}
+
 } // namespace TestWorkerThreadPool
 
 #endif // TEST_WORKER_THREAD_POOL_H
@@ -31,6 +31,7 @@
 #include "tests/test_utils.h"
 
 #include "core/io/dir_access.h"
+#include "core/object/worker_thread_pool.h"
 #include "core/os/os.h"
 
 String TestUtils::get_data_path(const String &p_file) {
@@ -47,3 +48,12 @@ String TestUtils::get_temp_path(const String &p_suffix) {
 	DirAccess::make_dir_absolute(temp_base); // Ensure the directory exists.
 	return temp_base.path_join(p_suffix);
 }
+
+uint64_t TestUtils::get_ticks_usec() {
+	return OS::get_singleton()->get_ticks_usec();
+}
+
+String TestUtils::format_pool_throughput(const String &p_label, uint64_t p_count, const String &p_what, uint64_t p_usec) {
+	return vformat("%s: %d %s in %d usec (%d/s) on %d threads.", p_label, p_count, p_what, p_usec,
+			p_count * 1000000 / MAX(p_usec, (uint64_t)1), WorkerThreadPool::get_singleton()->get_thread_count());
+}
@@ -10,11 +10,22 @@ public partial class VisualizationManager : Node3D {
 
     private List<MeshInstance3D> visualizationMeshes = new List<MeshInstance3D>();
  
+    //The mesh lists are indexed by shape, a shape's entry is null if it has nothing to draw
+
+    //Generation of each shape when it was last drawn, -1 if it was never drawn
+    //Used to only redraw what changed in a shape since then
+    private List<long> drawnGenerations = new List<long>();
+
+    //A mesh gets a new surface each time elements are appended to it, once it has this many it's rebuilt from scratch instead
+    private const int MaxAppendedSurfaces = 64;
+
+    private bool meshesVisible = false;
+    private bool surfacesVisible = true;
+    private bool edgesVisible = true;
+    private bool pointsVisible = true;
 
     //Single mesh for edges per shape
     public List<MeshInstance3D> curveMeshes = new List<MeshInstance3D>();
-    //Outerlist is the shape, inner list is the curves in that shape
-    public List<List<CurveStruct>> curves = new List<List<CurveStruct>>();
 
     //Single mesh for points per shape
     public List<MeshInstance3D> pointMeshes = new List<MeshInstance3D>();
@@ -23,8 +34,6 @@ public partial class VisualizationManager : Node3D {
 
     //Single mesh for surfaces per shape
     public List <MeshInstance3D> surfaceMeshes = new List<MeshInstance3D>();
-    //Outerlist is the shape, inner list is the surfaces in that shape
-    public List<List<SurfaceStruct>> surfaces = new List<List<SurfaceStruct>>();
     [Export] public ShaderMaterial curveShaderMaterial;
     [Export] public ShaderMaterial curveVisualizationShaderMaterial;
 
@@ -43,72 +52,164 @@ public partial class VisualizationManager : Node3D {
     [Export] public ShaderMaterial surfaceShaderMaterial;
     [Export] private ShaderMaterial surfaceVisualizationShaderMaterial;
 
-    private void DrawMesh(int shapeIndex = 0) {
-        Vector3[] vertices = occManager.GetVisualVertices(shapeIndex);
-        int[] indices = occManager.GetVisualIndices(shapeIndex);
+    //The face/edge ID is stored in CUSTOM0.r as a single float
+    private const Mesh.ArrayFormat ElementIDFormat = (Mesh.ArrayFormat)((long)Mesh.ArrayCustomFormat.RFloat << (int)Mesh.ArrayFormat.FormatCustom0Shift);
 
-        // Check if we have valid data to create a mesh
-        if (vertices == null || vertices.Length == 0 || indices == null || indices.Length == 0) {
-            GD.Print($"No mesh data available for shape {shapeIndex}");
+    private void DrawMesh(int shapeIndex = 0) {
+        //Assemblies that place the same part several times draw each part once, instanced
+        var instances = occManager.GetPartInstances(shapeIndex);
+        int partCount = occManager.GetPartCount(shapeIndex);
+        if (partCount < ((int[])instances["parts"]).Length) {
+            DrawInstancedMesh(shapeIndex, partCount);
             return;
         }
 
+        //The surface is packed by OCCManager and handed to the mesh as it is
         var mesh = new ArrayMesh();
-        var arrays = new Godot.Collections.Array();
-        arrays.Resize((int)Mesh.ArrayType.Max);
-        arrays[(int)Mesh.ArrayType.Vertex] = vertices;
-        arrays[(int)Mesh.ArrayType.Index] = indices;
-
+        if (!occManager.AddMeshSurface(mesh, shapeIndex, OccManager.ElementType.Face)) {
+            GD.Print($"No mesh data available for shape {shapeIndex}");
+            SetShapeMesh(visualizationMeshes, shapeIndex, null);
+            return;
+        }
 
         var material = new StandardMaterial3D {
             ShadingMode = BaseMaterial3D.ShadingModeEnum.Unshaded,
             Transparency = BaseMaterial3D.TransparencyEnum.Alpha,
             AlbedoColor = new Color(1, 1, 1, 0.2f) // White color for the material
         };
-
-        mesh.AddSurfaceFromArrays(Mesh.PrimitiveType.Triangles, arrays);
         mesh.SurfaceSetMaterial(0, material);
 
 
         var mesh_instance = new MeshInstance3D();
         mesh_instance.Mesh = mesh;
+        AddShapeOccluder(mesh_instance, shapeIndex);
         AddChild(mesh_instance);
 
-        visualizationMeshes.Add(mesh_instance);
-        mesh_instance.Visible = false; // By default, the mesh is not visible
+        SetShapeMesh(visualizationMeshes, shapeIndex, mesh_instance);
+        mesh_instance.Visible = meshesVisible; // By default, the mesh is not visible
     }
 
-    //For now this updates alll shapes, later make it only update the desired shape
-    public void Draw(bool debug = false) {
+    //Draws every part of the shape once, with a MultiMesh holding the transforms of its instances
+    //The parts are children of an empty MeshInstance3D that takes the shape's slot, so hiding or freeing it does the same to them
+    private void DrawInstancedMesh(int shapeIndex, int partCount) {
+        var material = new StandardMaterial3D {
+            ShadingMode = BaseMaterial3D.ShadingModeEnum.Unshaded,
+            Transparency = BaseMaterial3D.TransparencyEnum.Alpha,
+            AlbedoColor = new Color(1, 1, 1, 0.2f) // White color for the material
+        };
+
+        var container = new MeshInstance3D();
+        for (int part = 0; part < partCount; part++) {
+            var arrays = occManager.GetPartMeshArrays(shapeIndex, part);
+            int[] indices = (int[])arrays[(int)Mesh.ArrayType.Index];
+            if (indices == null || indices.Length == 0) {
+                continue;
+            }
+
+            var mesh = new ArrayMesh();
+            mesh.AddSurfaceFromArrays(Mesh.PrimitiveType.Triangles, arrays, null, null, ElementIDFormat);
 
-        foreach (var mesh in visualizationMeshes) {
-            mesh.QueueFree();
+            float[] buffer = occManager.GetPartInstanceBuffer(shapeIndex, part);
+            var multiMesh = new MultiMesh {
+                TransformFormat = MultiMesh.TransformFormatEnum.Transform3D,
+                Mesh = mesh,
+                InstanceCount = buffer.Length / 12
+            };
+            multiMesh.Buffer = buffer;
+
+            container.AddChild(new MultiMeshInstance3D { Multimesh = multiMesh, MaterialOverride = material });
         }
-        visualizationMeshes.Clear();
+        AddShapeOccluder(container, shapeIndex);
+        AddChild(container);
+
+        SetShapeMesh(visualizationMeshes, shapeIndex, container);
+        container.Visible = meshesVisible;
+    }
 
-        foreach (var mesh in curveMeshes) {
-            mesh.QueueFree();
+    //The shape's solids hide what's behind them, the occluder is a child of the mesh so it goes away (or is hidden) with it
+    private void AddShapeOccluder(MeshInstance3D mesh, int shapeIndex) {
+        var occluder = occManager.GetShapeOccluder(shapeIndex);
+        if (occluder != null) {
+            mesh.AddChild(new OccluderInstance3D { Occluder = occluder });
         }
-        curveMeshes.Clear();
+    }
 
-        foreach (var mesh in pointMeshes) {
-            mesh.QueueFree();
+    //Puts mesh in the shape's slot, freeing whatever was drawn there before
+    private void SetShapeMesh(List<MeshInstance3D> meshes, int shapeIndex, MeshInstance3D mesh) {
+        while (meshes.Count <= shapeIndex) {
+            meshes.Add(null);
         }
-        pointMeshes.Clear();
-        
-        foreach (var mesh in surfaceMeshes) {
-            mesh.QueueFree();
+        meshes[shapeIndex]?.QueueFree();
+        meshes[shapeIndex] = mesh;
+    }
+
+    //Frees the meshes of shapes past shapeCount (like the visualization shape once the visualization ends)
+    private void RemoveShapeMeshes(List<MeshInstance3D> meshes, int shapeCount) {
+        for (int i = shapeCount; i < meshes.Count; i++) {
+            meshes[i]?.QueueFree();
+        }
+        if (meshes.Count > shapeCount) {
+            meshes.RemoveRange(shapeCount, meshes.Count - shapeCount);
         }
-        surfaceMeshes.Clear();
+    }
 
-        for (int i = 0; i < occManager.GetShapeCount(); i++) {
-            DrawMesh(i);
+    //Returns the mesh elements can be appended to, or null if the shape's mesh has to be rebuilt
+    private static ArrayMesh GetAppendableMesh(List<MeshInstance3D> meshes, int shapeIndex) {
+        if (shapeIndex >= meshes.Count || meshes[shapeIndex] == null) {
+            return null;
+        }
+        var mesh = meshes[shapeIndex].Mesh as ArrayMesh;
+        if (mesh == null || mesh.GetSurfaceCount() >= MaxAppendedSurfaces) {
+            return null;
+        }
+        return mesh;
+    }
+
+    //Only redraws the shapes that changed since they were last drawn
+    //When elements were only added to a shape, the new points and edges are appended to its existing meshes
+    public void Draw(bool debug = false) {
+        int shapeCount = occManager.GetShapeCount();
+
+        RemoveShapeMeshes(visualizationMeshes, shapeCount);
+        RemoveShapeMeshes(curveMeshes, shapeCount);
+        RemoveShapeMeshes(pointMeshes, shapeCount);
+        RemoveShapeMeshes(surfaceMeshes, shapeCount);
+        if (points.Count > shapeCount) {
+            points.RemoveRange(shapeCount, points.Count - shapeCount);
+        }
+        if (drawnGenerations.Count > shapeCount) {
+            drawnGenerations.RemoveRange(shapeCount, drawnGenerations.Count - shapeCount);
+        }
+
+        for (int i = 0; i < shapeCount; i++) {
+            if (drawnGenerations.Count <= i) {
+                drawnGenerations.Add(-1);
+            }
+            long generation = occManager.GetShapeGeneration(i);
+            if (generation == drawnGenerations[i]) {
+                continue;
+            }
+
+            var changes = occManager.GetChangesSince(i, drawnGenerations[i]);
+            bool full = (bool)changes["full"];
+            int[] newVertices = (int[])changes["vertices"];
+            int[] newEdges = (int[])changes["edges"];
+            int[] newFaces = (int[])changes["faces"];
 
             //The visualization parameter is used when visualizing an addition
             //Here using the i == 1 we'll only visualize the second shape which is indeed used for visualization
-            DrawEdges(i, i == 1);
-            DrawPoints(i);
-            DrawSurfaces(i, i == 1);
+            if (full || newFaces.Length > 0) {
+                DrawMesh(i);
+                DrawSurfaces(i, i == 1);
+            }
+            if (full || newEdges.Length > 0) {
+                //The new IDs are always the last ones, so everything from the first new ID on is new
+                DrawEdges(i, i == 1, full ? 0 : newEdges[0]);
+            }
+            if (full || newVertices.Length > 0) {
+                DrawPoints(i, full ? 0 : newVertices[0]);
+            }
+            drawnGenerations[i] = generation;
 
             if (debug) {
                 GD.Print($"Drawing shape {i}");
@@ -120,43 +221,18 @@ public partial class VisualizationManager : Node3D {
         }
 
     }
-    private void DrawEdges(int shapeIndex = 0, bool visualization = false, bool debug = false) {
-        Vector3[] edgePoints = occManager.GetEdges(shapeIndex);
-
-        SurfaceTool st = new SurfaceTool();
-        st.Begin(Mesh.PrimitiveType.Lines);
-
-        //The R will hold the edge ID
-        st.SetCustomFormat(0, SurfaceTool.CustomFormat.RFloat);
-        int edgeID = 0;
-
-        //Clears the appropriate shape in the curves list
-        if (shapeIndex < curves.Count) {
-            curves[shapeIndex].Clear();
-        }
-        for (int i = 0; i < edgePoints.Length; i += 2) {
-
-            //Every edge is divided into 16 segments, so we increase the edgeID every 16 segments
-            //This is to make sure that the edgeID is unique for each edge
-            if (i % (32 * 2) == 0 && i > 0) {
-                edgeID++;
-            }
-
-
-            //Add this shape (outer list) to the curves if not done yet
-            if (curves.Count < occManager.GetShapeCount()) {
-                curves.Add(new List<CurveStruct>());
-            }
-            curves[shapeIndex].Add(
-                new CurveStruct(edgePoints[i], edgePoints[i + 1], edgeID));
-
-            var property = new Color(edgeID, 0, 0, 0);
-            st.SetCustom(0, property);
-            st.AddVertex(edgePoints[i]);
-            st.AddVertex(edgePoints[i + 1]);
+    //Edges before firstEdgeID are already drawn, only the ones after it are added to the shape's mesh
+    private void DrawEdges(int shapeIndex = 0, bool visualization = false, int firstEdgeID = 0, bool debug = false) {
+        ArrayMesh existingMesh = firstEdgeID > 0 ? GetAppendableMesh(curveMeshes, shapeIndex) : null;
+        if (existingMesh != null) {
+            //Adds the new edges as another surface of the mesh that's already displayed
+            occManager.AddMeshSurface(existingMesh, shapeIndex, OccManager.ElementType.Edge, firstEdgeID);
+            return;
         }
 
-        var lineMesh = st.Commit();
+        //Each edge is sampled according to its curvature, the edge ID of every point is in CUSTOM0
+        var lineMesh = new ArrayMesh();
+        occManager.AddMeshSurface(lineMesh, shapeIndex, OccManager.ElementType.Edge);
 
         MeshInstance3D curveMeshInstance = new MeshInstance3D();
         curveMeshInstance.Mesh = lineMesh;
@@ -166,90 +242,62 @@ public partial class VisualizationManager : Node3D {
             curveMeshInstance.MaterialOverride = curveShaderMaterial;
         }
 
+        curveMeshInstance.Visible = edgesVisible;
+
         AddChild(curveMeshInstance);
-        curveMeshes.Add(curveMeshInstance);
+        SetShapeMesh(curveMeshes, shapeIndex, curveMeshInstance);
 
-        //Print the curves for debugging
         if (debug) {
-            // GD.Print($"Shape {shapeIndex} has {curves[shapeIndex].Count} curves:");
-            // foreach (var curve in curves[shapeIndex]) {
-            //     GD.Print($"Curve ID: {curve.ElementID}, Start: {curve.start}, End: {curve.end}");
-            // }
-            //Print the number of curves in the shape
-            GD.Print($"Shape {shapeIndex} has {curves[shapeIndex].Count} curves.");
+            GD.Print($"Shape {shapeIndex} has {occManager.GetEdgeCount(shapeIndex)} curves.");
         }
 
     }
 
-    private void DrawPoints(int shapeIndex = 0) {
+    //Points before firstPointID are already drawn, only the ones after it are added to the shape's mesh
+    private void DrawPoints(int shapeIndex = 0, int firstPointID = 0) {
         Vector3[] listOfPoints = occManager.GetVertices(shapeIndex);
-        SurfaceTool st = new SurfaceTool();
-        st.Begin(Mesh.PrimitiveType.Points);
-        //The R will hold the point ID
-        st.SetCustomFormat(0, SurfaceTool.CustomFormat.RFloat);
 
+        ArrayMesh existingMesh = firstPointID > 0 ? GetAppendableMesh(pointMeshes, shapeIndex) : null;
+        if (existingMesh == null) {
+            firstPointID = 0;
+        }
+
+        //Add this shape (outer list) to the points if not done yet
+        while (points.Count <= shapeIndex) {
+            points.Add(new List<PointStruct>());
+        }
         //Clears the appropriate shape in the points list
-        if (shapeIndex < points.Count) {
+        if (firstPointID == 0) {
             points[shapeIndex].Clear();
         }
-        for (int i = 0; i < listOfPoints.Length; i++) {
-
-            //Add this shape (outer list) to the points if not done yet
-            if (points.Count < occManager.GetShapeCount()) {
-                points.Add(new List<PointStruct>());
-            }
+        for (int i = firstPointID; i < listOfPoints.Length; i++) {
             points[shapeIndex].Add(new PointStruct(listOfPoints[i], i));
+        }
 
-            var property = new Color(i, 0, 0, 0);
-            st.SetCustom(0, property);
-            st.AddVertex(listOfPoints[i]);
+        if (existingMesh != null) {
+            //Adds the new points as another surface of the mesh that's already displayed
+            occManager.AddMeshSurface(existingMesh, shapeIndex, OccManager.ElementType.Point, firstPointID);
+            return;
         }
 
-        var pointMesh = st.Commit();
+        //The point ID of every point is in CUSTOM0
+        var pointMesh = new ArrayMesh();
+        occManager.AddMeshSurface(pointMesh, shapeIndex, OccManager.ElementType.Point);
 
         MeshInstance3D pointMeshInstance = new MeshInstance3D();
         pointMeshInstance.Mesh = pointMesh;
         pointMeshInstance.MaterialOverride = pointShaderMaterial;
 
+        pointMeshInstance.Visible = pointsVisible;
+
         AddChild(pointMeshInstance);
-        pointMeshes.Add(pointMeshInstance);
+        SetShapeMesh(pointMeshes, shapeIndex, pointMeshInstance);
     }
 
     private void DrawSurfaces(int shapeIndex = 0, bool visualization = false,bool debug = false) {
-        //FaceInfo[0] is a PackedVector3Array with the vertices of the triangles making up the face
-        //FaceInfo[1] is a PackedInt32Array with the IDs per triangle
-        var faceInfo = occManager.GetFaces(shapeIndex);
-        Vector3[] tris = (Vector3[])faceInfo[0];
-        int[] triIDs = (int[])faceInfo[1];
-
-        SurfaceTool st = new SurfaceTool();
-        st.Begin(Mesh.PrimitiveType.Triangles);
-
-        //The R will hold the face ID
-        st.SetCustomFormat(0, SurfaceTool.CustomFormat.RFloat);
-
-        //Clears the appropriate shape in the surfaces list
-        if (shapeIndex < surfaces.Count) {
-            surfaces[shapeIndex].Clear();
-        }
-
-        for (int vertex = 0, triIDIndex = 0; vertex < tris.Length; vertex += 3, triIDIndex++) {
-            //Add this shape (outer list) to the surfaces if not done yet
-            if (surfaces.Count < occManager.GetShapeCount()) {
-                surfaces.Add(new List<SurfaceStruct>());
-            }
-
-            surfaces[shapeIndex].Add(new SurfaceStruct(
-                tris[vertex], tris[vertex + 1], tris[vertex + 2], triIDs[triIDIndex]));
-
-            var property = new Color(triIDs[triIDIndex], 0, 0, 0);
-            st.SetCustom(0, property);
-            st.AddVertex(tris[vertex]);
-            st.AddVertex(tris[vertex + 1]);
-            st.AddVertex(tris[vertex + 2]);
-        }
-
-        var surfaceMesh = st.Commit();
+        //Positions, normals, triangle indices and the face ID of each vertex (CUSTOM0) in a single call
+        var surfaceMesh = new ArrayMesh();
+        occManager.AddMeshSurface(surfaceMesh, shapeIndex, OccManager.ElementType.Face);
         MeshInstance3D surfaceMeshInstance = new MeshInstance3D();
         surfaceMeshInstance.Mesh = surfaceMesh;
 
@@ -259,37 +307,42 @@ public partial class VisualizationManager : Node3D {
             surfaceMeshInstance.MaterialOverride = surfaceShaderMaterial;
         }
 
+        surfaceMeshInstance.Visible = surfacesVisible;
+
         AddChild(surfaceMeshInstance);
-        surfaceMeshes.Add(surfaceMeshInstance);
+        SetShapeMesh(surfaceMeshes, shapeIndex, surfaceMeshInstance);
 
         if (debug) {
             //Prin thte number of surfaces in the shape
-            GD.Print($"Shape {shapeIndex} has {surfaces[shapeIndex].Count} surfaces.");
+            GD.Print($"Shape {shapeIndex} has {surfaceMesh.GetSurfaceCount()} surfaces.");
         }
     }
     
 
+    //Visibility is remembered so that shapes drawn later match the ones already displayed
     public void ToggleMeshesVisibility() {
-        foreach (var mesh in visualizationMeshes) {
-            mesh.Visible = !mesh.Visible;
-        }
+        meshesVisible = !meshesVisible;
+        SetMeshesVisibility(visualizationMeshes, meshesVisible);
     }
     public void ToggleSurfacesVisibility() {
-        foreach (var surface in surfaceMeshes) {
-            surface.Visible = !surface.Visible;
-        }
+        surfacesVisible = !surfacesVisible;
+        SetMeshesVisibility(surfaceMeshes, surfacesVisible);
     }
     public void ToggleEdgesVisibility() {
-
-        foreach (var curve in curveMeshes) {
-            curve.Visible = !curve.Visible;
-        }
+        edgesVisible = !edgesVisible;
+        SetMeshesVisibility(curveMeshes, edgesVisible);
     }
 
     public void TogglePointsVisibility() {
+        pointsVisible = !pointsVisible;
+        SetMeshesVisibility(pointMeshes, pointsVisible);
+    }
 
-        foreach (var pointMesh in pointMeshes) {
-            pointMesh.Visible = !pointMesh.Visible;
+    private static void SetMeshesVisibility(List<MeshInstance3D> meshes, bool visible) {
+        foreach (var mesh in meshes) {
+            if (mesh != null) {
+                mesh.Visible = visible;
+            }
         }
     }
     public void AddSegment(int shapeIndex, int firstPointID, int secondPointID) {
@@ -388,15 +441,19 @@ public partial class VisualizationManager : Node3D {
         //However to add an arc we need the points to exist in that shape
         //So we add the points to the shape
         //We're gonna assume we're visuallizing the first shape cuz for now we only use the first shape, and the seecond shape is onyl for visualizing
-        Vector3 firstPoint = points[0][firstPointID].position;
-        Vector3 centerPoint = points[0][centerPointID].position;
-        Vector3 secondPoint = points[0][secondPointID].position;
-        AddPoint(shapeIndex, firstPoint.X, firstPoint.Y, firstPoint.Z,false);
-        AddPoint(shapeIndex, centerPoint.X, centerPoint.Y, centerPoint.Z,false);
-        AddPoint(shapeIndex, secondPoint.X, secondPoint.Y, secondPoint.Z,false);
+        //All of it is applied as one batch, so the shape is only rebuilt and meshed once and we only draw once
+        Godot.Collections.Array operations = new Godot.Collections.Array();
+        operations.Add(PointOperation(points[0][firstPointID].position));
+        operations.Add(PointOperation(points[0][centerPointID].position));
+        operations.Add(PointOperation(points[0][secondPointID].position));
         //We created 3 points so the IDs are 0, 1, 2
-        AddArc(shapeIndex, 0, 1, 2,false);
+        operations.Add(new Godot.Collections.Dictionary { { "type", "arc" }, { "points", new Godot.Collections.Array { 0, 1, 2 } } });
+        occManager.ApplyOperations(shapeIndex, operations);
+        Draw();
+    }
 
+    private static Godot.Collections.Dictionary PointOperation(Vector3 position) {
+        return new Godot.Collections.Dictionary { { "type", "point" }, { "position", position } };
     }
 
     public void EndArcAddingVisualization() {
@@ -406,15 +463,12 @@ public partial class VisualizationManager : Node3D {
     }
 
     public void AddFace(int shapeIndex, Godot.Collections.Array<int> edgeIDs) {
+        //AddSurface meshes the new face itself, so it can be drawn right away
         occManager.AddSurface(shapeIndex, (Godot.Collections.Array)edgeIDs);
 
-        //This is a very dirty workaround, we will add a dummy point just to trigger the update. I am not sure why we have to do this, but it works, and I need to progress fast, so ya...
-        //The dummy point will be added exactly over the first point of the first shape, since in OCC saving the vertices we don't save duplicate points or points that share the same coordinate.
-        AddPoint(shapeIndex, points[0][0].position.X, points[0][0].position.Y, points[0][0].position.Z,false);
-
         occManager.SaveState("Face added");
         UndoRedoGraphic.Instance.updateStackView();
-        Draw(); // This should now include the face because of the point addition triggering refresh
+        Draw();
 
     }
 
@@ -449,20 +503,23 @@ public partial class VisualizationManager : Node3D {
 
         GD.Print("Visualizing spline with points: ", pointIDs);
 
-        Godot.Collections.Array<int> shapePointIDs = new Godot.Collections.Array<int>();
+        Godot.Collections.Array operations = new Godot.Collections.Array();
+        Godot.Collections.Array shapePointIDs = new Godot.Collections.Array();
         //Now to visualize we'dd add a spline to the empty shape.
         //However to add a spline we need the points to exist in that shape
         //So we add the points to the shape
         int newPointID = 0;
         foreach (var pointID in pointIDs) {
-            Vector3 pointPosition = points[0][pointID].position;
-            AddPoint(shapeIndex, pointPosition.X, pointPosition.Y, pointPosition.Z, false);
+            operations.Add(PointOperation(points[0][pointID].position));
             //We update the pointIDS to reflect the newly created shape's poitns IDs, so 0 -> pointIDs.size()
             shapePointIDs.Add(newPointID);
             newPointID++;
         }
         //We created points so we can now add a spline with those points
-        AddSpline(shapeIndex, shapePointIDs,false);
+        operations.Add(new Godot.Collections.Dictionary { { "type", "spline" }, { "points", shapePointIDs } });
+        //Applied as one batch so the shape is only rebuilt and meshed once
+        occManager.ApplyOperations(shapeIndex, operations);
+        Draw();
     }
 
     public void EndSplineAddingVisualization() {
@@ -543,6 +600,38 @@ public partial class VisualizationManager : Node3D {
         }
     }
 
+    //Returns the element of the given type closest to the ray (within tolerance of it), or -1 for both if there is none
+    //Faces have to be hit by the ray, the first one hit is returned
+    public (int shapeID, int elementID) PickNearest(Vector3 rayOrigin, Vector3 rayDirection, float tolerance, ElementType elementType) {
+        var hit = occManager.PickNearest(rayOrigin, rayDirection, tolerance, (OccManager.ElementType)(int)elementType);
+        return ((int)hit["shape_index"], (int)hit["element_id"]);
+    }
+
+    //Box selection, returns the IDs of the elements of each shape that are entirely inside the volume (planes pointing outwards like Camera3D.GetFrustum())
+    public Godot.Collections.Array SelectInVolume(Godot.Collections.Array<Plane> planes, ElementType elementType) {
+        return occManager.SelectInVolume(planes, (OccManager.ElementType)(int)elementType);
+    }
+
+    //Imports in the background, the shape is drawn once the import is done
+    //Returns the ID of the import, which can be passed to CancelImport
+    public long ImportStep(string path) {
+        return occManager.ImportStepAsync(path);
+    }
+
+    public bool CancelImport(long taskId) {
+        return occManager.CancelImport(taskId);
+    }
+
+    private void OnImportFinished(long taskId, long shapeIndex) {
+        if (shapeIndex == -1) {
+            GD.Print($"Import {taskId} failed or was cancelled");
+            return;
+        }
+        occManager.SaveState("Import");
+        UndoRedoGraphic.Instance.updateStackView();
+        Draw();
+    }
+
     public string[] GetUndoStack() {
         return occManager.GetUndoStack();
     }
@@ -557,6 +646,10 @@ public partial class VisualizationManager : Node3D {
         GD.Print("ShapesAndStuff Ready");
         GD.Print(occManager.GetShapeCount());
 
+        occManager.ImportFinished += OnImportFinished;
+        //Two coarser triangulations for the faces, Godot switches to them when the shapes are small on screen
+        occManager.SetLodLevelCount(2);
+
         var absPath = ProjectSettings.GlobalizePath("res://step/box_output.step");
 
         GD.Print("Before Import");
@@ -587,8 +680,6 @@ public partial class VisualizationManager : Node3D {
         MultiSelectHighlighting(false);
 
         //By default mesh is not visible
-        foreach (var mesh in visualizationMeshes) {
-            mesh.Visible = false;
-        }
+        SetMeshesVisibility(visualizationMeshes, meshesVisible);
     }
 }
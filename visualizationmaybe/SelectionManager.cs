@@ -192,182 +192,50 @@ public partial class SelectionManager : Node3D {
 
     }
 
-    //https://math.stackexchange.com/questions/1905533/find-perpendicular-distance-from-point-to-line-in-3d
-    //Distance of point to ray
-    private float distanceFromSegment(Vector3 rayStart, Vector3 rayEnd, Vector3 point) {
-        Vector3 direction = (rayEnd - rayStart) / rayEnd.DistanceTo(rayStart);
-        Vector3 startToPoint = point - rayStart;
-        float dot = direction.Dot(startToPoint);
-        Vector3 projection = rayStart + dot * direction;
-        return projection.DistanceTo(point);
-    }
+    //The picking itself is done by OCCManager, which keeps a BVH of each shape's points, edges and faces
 
     //Find closest point to cursor
     //Returns the shape ID, point ID, and element type
     //If no point is found within the margin, returns -1 for both shape and point
     private (int shapeID, int pointID, ElementType elementType) findClosestPoint(float margin) {
-        int rayMaker = 500;
         var mousePos = GetViewport().GetMousePosition();
-        var from = camera.ProjectRayOrigin(mousePos);
-        var to = from + camera.ProjectRayNormal(mousePos) * rayMaker;
-
-        float minDistance = float.MaxValue;
-        int closestShapeId = -1;
-        int closestElementId = -1;
-
-        for (int shapeIndex = 0; shapeIndex < VisualizationManager.Instance.points.Count; shapeIndex++) {
-            var shape = VisualizationManager.Instance.points[shapeIndex];
-            foreach (PointStruct point in shape) {
-                float distance = distanceFromSegment(from, to, point.position);
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    closestShapeId = shapeIndex;
-                    closestElementId = point.ElementID;
-                }
-                //Print debug information (Distance and the current element id)
-                // GD.Print($"Distance: {distance}, Element ID: {point.ElementID}");
-            }
-        }
-
-        if (minDistance > margin) {
-            // GD.Print($"No point found within the specified margin: {margin}");
-            // GD.Print($"Closest Point: Shape ID: {closestShapeId}, Element ID: {closestElementId}, Distance: {minDistance}");
-            // Return -1 for both shape and element
+        var hit = VisualizationManager.Instance.PickNearest(
+            camera.ProjectRayOrigin(mousePos), camera.ProjectRayNormal(mousePos), margin, ElementType.Point);
 
+        if (hit.shapeID == -1) {
             return (-1, -1, ElementType.None); // No point found within the specified margin
         }
-
-        // GD.Print($"Closest Point: Shape ID: {closestShapeId}, Element ID: {closestElementId}, Distance: {minDistance}");
-        return (closestShapeId, closestElementId, ElementType.Point);
-
-    }
-    //https://stackoverflow.com/questions/541150/connect-two-line-segments/11427699#11427699
-    private float distanceBetweenSegments(Vector3 A1, Vector3 A2, Vector3 B1, Vector3 B2) {
-        float minDistance = float.MaxValue;
-
-        //Distance of A1 from line B
-        float distance = distanceFromSegment(B1, B2, A1);
-        if (distance < minDistance) {
-            minDistance = distance;
-        }
-        //Distance of A2 from line B
-        distance = distanceFromSegment(B1, B2, A2);
-        if (distance < minDistance) {
-            minDistance = distance;
-        }
-        //Distance of B1 from line A
-        distance = distanceFromSegment(A1, A2, B1);
-        if (distance < minDistance) {
-            minDistance = distance;
-        }
-        //Distance of B2 from line A
-        distance = distanceFromSegment(A1, A2, B2);
-        if (distance < minDistance) {
-            minDistance = distance;
-        }
-
-        return minDistance;
+        return (hit.shapeID, hit.elementID, ElementType.Point);
     }
 
     //Find closest curve to cursor
     //Returns the shape ID, curve ID, and element type
     //If no curve is found within the margin, returns -1 for both shape and curve
     private (int shapeID, int curveID, ElementType elementType) findClosestCurve(float margin) {
-        int rayMaker = 500;
-
         var mousePos = GetViewport().GetMousePosition();
-        var from = camera.ProjectRayOrigin(mousePos);
-        var to = from + camera.ProjectRayNormal(mousePos) * rayMaker;
-
-        float minDistance = float.MaxValue;
-        int closestShapeId = -1;
-        int closestElementId = -1;
-        //Distance between 2 segments is found by finding the smallest distance between every point and the opposing segment
-        for (int shapeIndex = 0; shapeIndex < VisualizationManager.Instance.curves.Count; shapeIndex++) {
-            var shape = VisualizationManager.Instance.curves[shapeIndex];
-            foreach (CurveStruct curve in shape) {
-                float distance = distanceBetweenSegments(from, to, curve.start, curve.end);
-                if (distance < minDistance) {
-                    minDistance = distance;
-                    closestShapeId = shapeIndex;
-                    closestElementId = curve.ElementID;
-                }
-                // //Print debug information (Distance and the current element id)
-                // GD.Print($"Distance: {distance}, Element ID: {curve.ElementID}");
-            }
-        }
-        if (minDistance > margin) {
-            // GD.Print($"No curve found within the specified margin: {margin}");
-            // GD.Print($"Closest Curve: Shape ID: {closestShapeId}, Element ID: {closestElementId}, Distance: {minDistance}");
-            // Return -1 for both shape and element
+        var hit = VisualizationManager.Instance.PickNearest(
+            camera.ProjectRayOrigin(mousePos), camera.ProjectRayNormal(mousePos), margin, ElementType.Curve);
+
+        if (hit.shapeID == -1) {
             return (-1, -1, ElementType.None); // No curve found within the specified margin
         }
-
-        // GD.Print($"Closest Curve: Shape ID: {closestShapeId}, Element ID: {closestElementId}, Distance: {minDistance}");
-        return (closestShapeId, closestElementId, ElementType.Curve);
+        return (hit.shapeID, hit.elementID, ElementType.Curve);
     }
 
     //Find closest Surface to cursor
     //Returns the shape ID, surface ID, and element type
-    //If no surface is found within the margin, returns -1 for both shape and surface
-    //This method works but you can't select surfaces that are behind, only selects the first face 
+    //If no surface is hit, returns -1 for both shape and surface
+    //Only selects the first face hit, you can't select surfaces that are behind it
     private (int shapeID, int surfaceID, ElementType elementType) findClosestSurface(float margin) {
         var mousePos = GetViewport().GetMousePosition();
-        var rayOrigin = camera.ProjectRayOrigin(mousePos);
-        var rayDirection = camera.ProjectRayNormal(mousePos)*500;
-
-        float closestDistance = float.MaxValue;
-        int closestShapeId = -1;
-        int closestElementId = -1;
-
-        for (int shapeIndex = 0; shapeIndex < VisualizationManager.Instance.surfaces.Count; shapeIndex++) {
-            var shape = VisualizationManager.Instance.surfaces[shapeIndex];
-            foreach (SurfaceStruct surface in shape) {
-                // Ray-triangle intersection
-                var intersection = RayTriangleIntersect(rayOrigin, rayDirection, 
-                    surface.vertex1, surface.vertex2, surface.vertex3);
-                
-                if (intersection.hit && intersection.distance < closestDistance) {
-                    closestDistance = intersection.distance;
-                    closestShapeId = shapeIndex;
-                    closestElementId = surface.ElementID;
-                }
-            }
-        }
+        var hit = VisualizationManager.Instance.PickNearest(
+            camera.ProjectRayOrigin(mousePos), camera.ProjectRayNormal(mousePos), margin, ElementType.Surface);
 
-        if (closestDistance == float.MaxValue) {
+        if (hit.shapeID == -1) {
             return (-1, -1, ElementType.None);
         }
 
-        GD.Print($"Closest Surface: Shape ID: {closestShapeId}, Element ID: {closestElementId}, Distance: {closestDistance}");
-        return (closestShapeId, closestElementId, ElementType.Surface);
-    }
-
-    private (bool hit, float distance) RayTriangleIntersect(Vector3 rayOrigin, Vector3 rayDir, 
-        Vector3 v0, Vector3 v1, Vector3 v2) {
-        
-        const float EPSILON = 0.0000001f;
-        Vector3 edge1 = v1 - v0;
-        Vector3 edge2 = v2 - v0;
-        Vector3 h = rayDir.Cross(edge2);
-        float a = edge1.Dot(h);
-        
-        if (a > -EPSILON && a < EPSILON) return (false, 0); // Ray parallel to triangle
-        
-        float f = 1.0f / a;
-        Vector3 s = rayOrigin - v0;
-        float u = f * s.Dot(h);
-        
-        if (u < 0.0f || u > 1.0f) return (false, 0);
-        
-        Vector3 q = s.Cross(edge1);
-        float v = f * rayDir.Dot(q);
-        
-        if (v < 0.0f || u + v > 1.0f) return (false, 0);
-        
-        float t = f * edge2.Dot(q);
-        
-        if (t > EPSILON) return (true, t);
-        return (false, 0);
+        GD.Print($"Closest Surface: Shape ID: {hit.shapeID}, Element ID: {hit.elementID}");
+        return (hit.shapeID, hit.elementID, ElementType.Surface);
     }
 }
\ No newline at end of file